@@ -0,0 +1,65 @@
+project "Benchmark"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++17"
+   targetdir "bin/%{cfg.buildcfg}"
+   staticruntime "off"
+
+   pchheader "rtpch.h"
+   pchsource "../Raytracing/src/rtpch.cpp"
+
+   -- Builds the renderer sources directly, everything except the GUI entry point
+   files {
+      "src/**.h",
+      "src/**.cpp",
+
+      "../Raytracing/src/**.h",
+      "../Raytracing/src/**.cpp"
+   }
+
+   removefiles { "../Raytracing/src/WalnutApp.cpp" }
+
+   includedirs {
+      "src",
+      "../Raytracing/src",
+
+      "../vendor/stb_image",
+
+      "../Walnut/Source",
+      "%{WalnutPlatformDir}",
+
+      "%{IncludeDir.glm}",
+      "%{IncludeDir.spdlog}"
+   }
+
+   links { WalnutProject }
+
+   -- Ray, node and primitive test counters for the scene benchmark
+   defines { "RT_ENABLE_STATISTICS" }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   filter "system:windows"
+      systemversion "latest"
+      defines { "WL_PLATFORM_WINDOWS" }
+
+   filter "system:linux"
+      links { "pthread" }
+
+   filter "configurations:Debug"
+      defines { "WL_DEBUG" }
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "WL_RELEASE" }
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      defines { "WL_DIST" }
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
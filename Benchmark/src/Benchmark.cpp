@@ -0,0 +1,489 @@
+#include "rtpch.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "Core/Statistics.h"
+#include "Core/ThreadPool.h"
+#include "Math/BVH.h"
+#include "Math/Random.h"
+#include "Objects/HittableList.h"
+#include "Objects/Material.h"
+#include "Objects/Sphere.h"
+#include "Rendering/Renderer.h"
+#include "Rendering/Scene.h"
+#include "Rendering/TextureCache.h"
+#include "Rendering/TextureLoader.h"
+
+#include "ResultTable.h"
+
+namespace {
+
+	struct BenchmarkOptions
+	{
+		// bvh
+		std::vector<uint32_t> PrimitiveCounts = { 1000, 10000, 100000, 1000000 };
+		std::vector<uint32_t> ThreadCounts;
+		std::vector<BVHBuildMethod> Methods = { BVHBuildMethod::Median, BVHBuildMethod::SAH };
+
+		// scenes, noise
+		std::vector<uint32_t> Scenes;
+		std::vector<SamplerType> Samplers;
+		RenderSettings Settings;
+		bool SceneArenas = true;
+		size_t TextureCacheMB = 256;
+
+		// noise
+		std::vector<uint32_t> SampleCounts = { 4, 8, 16, 32, 64 };
+		uint32_t ReferenceSamples = 1024;
+
+		uint32_t Repetitions = 3;
+		std::string Format = "json";
+		std::string Output;
+	};
+
+	std::vector<uint32_t> ParseList(const char* text)
+	{
+		std::vector<uint32_t> values;
+		std::stringstream stream(text);
+		std::string value;
+		while (std::getline(stream, value, ','))
+			values.push_back((uint32_t)std::stoul(value));
+
+		return values;
+	}
+
+	std::vector<uint32_t> DefaultThreadCounts()
+	{
+		uint32_t hardwareThreads = ThreadPool::HardwareThreads();
+
+		std::vector<uint32_t> threadCounts;
+		for (uint32_t threadCount = 1; threadCount < hardwareThreads; threadCount *= 2)
+			threadCounts.push_back(threadCount);
+		threadCounts.push_back(hardwareThreads);
+
+		return threadCounts;
+	}
+
+	std::vector<SamplerType> ParseSamplers(const char* text)
+	{
+		std::vector<SamplerType> samplers;
+		std::stringstream stream(text);
+		std::string name;
+		while (std::getline(stream, name, ','))
+		{
+			SamplerType type;
+			if (!Sampler::FindType(name, type))
+				throw std::invalid_argument(name);
+			samplers.push_back(type);
+		}
+
+		return samplers;
+	}
+
+	// Uniformly scattered spheres whose size shrinks with the count, so the density stays comparable
+	HittableList GenerateSpheres(uint32_t count)
+	{
+		auto material = CreateRef<Material::Lambertian>(glm::vec3(0.5f));
+		float radius = 50.0f / std::cbrt((float)count);
+
+		HittableList spheres;
+		RandomStream random(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			glm::vec3 center = random.Vec3(-50.0f, 50.0f);
+			spheres.Add<Sphere>(center, radius * random.Float(0.5f, 1.5f), material);
+		}
+
+		return spheres;
+	}
+
+	float MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	uint64_t ImageChecksum(const uint32_t* pixels, size_t count)
+	{
+		// FNV-1a, only meant to spot when a change alters the rendered image
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < count; i++)
+		{
+			hash ^= pixels[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	void BenchmarkBVHBuild(const BenchmarkOptions& options, ResultTable& results)
+	{
+		for (uint32_t primitiveCount : options.PrimitiveCounts)
+		{
+			HittableList spheres = GenerateSpheres(primitiveCount);
+
+			for (BVHBuildMethod method : options.Methods)
+			{
+				float serialTime = 0.0f;
+				for (uint32_t threadCount : options.ThreadCounts)
+				{
+					BVHNode::SetBuildThreadCount(threadCount);
+
+					float bestTime = INFINITY, totalTime = 0.0f;
+					BVHBuildStats stats;
+					for (uint32_t repetition = 0; repetition < options.Repetitions; repetition++)
+					{
+						BVHNode bvh(spheres, method);
+						stats = bvh.GetBuildStats();
+						bestTime = std::min(bestTime, stats.BuildTime);
+						totalTime += stats.BuildTime;
+					}
+
+					if (serialTime == 0.0f)
+						serialTime = bestTime;
+
+					results.AddRow();
+					results.Set("method", BVHNode::BuildMethodName(method));
+					results.Set("layout", BVHNode::LayoutName(stats.Layout));
+					results.Set("primitives", primitiveCount);
+					results.Set("threads", threadCount);
+					results.Set("nodes", (uint64_t)stats.NodeCount);
+					results.Set("wide_nodes", (uint64_t)stats.WideNodeCount);
+					results.Set("depth", stats.MaxDepth);
+					results.Set("sah_cost", (double)stats.SAHCost);
+					results.Set("best_ms", (double)bestTime);
+					results.Set("average_ms", (double)(totalTime / options.Repetitions));
+					results.Set("speedup", (double)(serialTime / bestTime));
+				}
+			}
+		}
+
+		BVHNode::SetBuildThreadCount(0);
+	}
+
+	void BenchmarkScenes(const BenchmarkOptions& options, ResultTable& results)
+	{
+		const std::vector<SceneInfo>& scenes = SceneList::GetBuiltInScenes();
+
+		Renderer renderer;
+		for (uint32_t sceneIndex : options.Scenes)
+		{
+			// Releasing a scene is timed on a copy built only for that
+			float teardownTime;
+			{
+				Scene discarded = scenes[sceneIndex].Create(options.Settings.Width, options.Settings.Height);
+				TextureLoader::WaitAll();
+				std::chrono::steady_clock::time_point teardownStart = std::chrono::steady_clock::now();
+				discarded = Scene();
+				teardownTime = MillisecondsSince(teardownStart);
+			}
+
+			std::chrono::steady_clock::time_point setupStart = std::chrono::steady_clock::now();
+			Scene scene = scenes[sceneIndex].Create(options.Settings.Width, options.Settings.Height);
+			// Setup ends once the scene's textures have been decoded in the background
+			TextureLoader::WaitAll();
+			float setupTime = MillisecondsSince(setupStart);
+
+			for (SamplerType samplerType : options.Samplers)
+			{
+				RenderSettings settings = options.Settings;
+				settings.Sampling = samplerType;
+
+				// Every repetition renders the same image, only the fastest one is reported.
+				float wallTime = INFINITY;
+				TextureCache::Get().ResetStatistics();
+				for (uint32_t repetition = 0; repetition < options.Repetitions; repetition++)
+				{
+					std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+					renderer.StartRender(settings, &scene);
+					renderer.WaitForRender();
+					wallTime = std::min(wallTime, MillisecondsSince(renderStart));
+				}
+
+				RayStatistics statistics = renderer.GetStatistics();
+				TextureCache::Statistics textures = TextureCache::Get().GetStatistics();
+				WavefrontTimings timings = renderer.GetWavefrontTimings();
+				double seconds = wallTime / 1000.0;
+				double totalRays = (double)std::max<uint64_t>(statistics.TotalRays, 1);
+
+				results.AddRow();
+				results.Set("scene", scene.Name);
+				results.Set("index", sceneIndex);
+				results.Set("sampler", Sampler::TypeName(samplerType));
+				results.Set("width", settings.Width);
+				results.Set("height", settings.Height);
+				results.Set("samples", settings.Samples);
+				results.Set("depth", settings.MaxDepth);
+				results.Set("roulette_depth", settings.RouletteDepth);
+				results.Set("light_sampling", settings.LightSampling ? "on" : "off");
+				results.Set("packets", settings.PacketTracing ? "on" : "off");
+				results.Set("wavefront", settings.Wavefront ? "on" : "off");
+				results.Set("dispatch", settings.StaticDispatch ? "static" : "virtual");
+				results.Set("seed", settings.Seed);
+				results.Set("threads", settings.ThreadCount == 0 ? ThreadPool::HardwareThreads() : settings.ThreadCount);
+				results.Set("scene_arena", scene.Arena ? "on" : "off");
+				results.Set("setup_ms", (double)setupTime);
+				results.Set("teardown_ms", (double)teardownTime);
+				results.Set("compile_ms", (double)scene.CompileStats.BuildTime);
+				results.Set("scene_mb", scene.CompileStats.MemoryBytes / (1024.0 * 1024.0));
+				// Tile misses over every repetition, the first one finds the cache cold
+				results.Set("texture_budget_mb", textures.Budget / (1024.0 * 1024.0));
+				results.Set("texture_resident_mb", textures.ResidentBytes / (1024.0 * 1024.0));
+				results.Set("texture_miss_rate", (double)textures.Misses / std::max<uint64_t>(textures.Hits + textures.Misses, 1));
+				results.Set("wall_ms", (double)wallTime);
+				results.Set("primary_rays", statistics.PrimaryRays);
+				results.Set("total_rays", statistics.TotalRays);
+				results.Set("shadow_rays", statistics.ShadowRays);
+				results.Set("primary_rays_per_sec", statistics.PrimaryRays / seconds);
+				results.Set("total_rays_per_sec", statistics.TotalRays / seconds);
+				results.Set("nodes_per_ray", statistics.NodesVisited / totalRays);
+				results.Set("primitive_tests_per_ray", statistics.PrimitiveTests / totalRays);
+				// Stage times of the last repetition, zero without --wavefront 1
+				results.Set("generate_ms", timings.Generate * 1000.0);
+				results.Set("extend_ms", timings.Extend * 1000.0);
+				results.Set("sort_ms", timings.Sort * 1000.0);
+				results.Set("shade_ms", timings.Shade * 1000.0);
+
+				std::ostringstream checksum;
+				checksum << std::hex << ImageChecksum(renderer.GetImageData(), (size_t)settings.Width * settings.Height);
+				results.Set("image_checksum", checksum.str());
+			}
+		}
+	}
+
+	// Mean radiance per pixel, clamped to the displayable range so a few fireflies do not
+	// dominate the error
+	std::vector<glm::vec3> RenderMeanImage(Renderer& renderer, const RenderSettings& settings, Scene& scene)
+	{
+		renderer.StartRender(settings, &scene);
+		renderer.WaitForRender();
+
+		std::vector<glm::vec3> image((size_t)settings.Width * settings.Height);
+		float scale = 1.0f / std::max(renderer.GetAccumulatedSamples(), 1u);
+		for (size_t i = 0; i < image.size(); i++)
+			image[i] = glm::clamp(renderer.GetAccumulationData()[i] * scale, glm::vec3(0.0f), glm::vec3(1.0f));
+
+		return image;
+	}
+
+	void BenchmarkNoise(const BenchmarkOptions& options, ResultTable& results)
+	{
+		const std::vector<SceneInfo>& scenes = SceneList::GetBuiltInScenes();
+
+		Renderer renderer;
+		for (uint32_t sceneIndex : options.Scenes)
+		{
+			Scene scene = scenes[sceneIndex].Create(options.Settings.Width, options.Settings.Height);
+
+			// The reference uses its own seed, so its remaining error is uncorrelated with every tested sampler.
+			RenderSettings referenceSettings = options.Settings;
+			referenceSettings.Samples = (int)options.ReferenceSamples;
+			referenceSettings.Sampling = SamplerType::Sobol;
+			referenceSettings.LightSampling = true;
+			referenceSettings.Seed = options.Settings.Seed + 1;
+			std::vector<glm::vec3> reference = RenderMeanImage(renderer, referenceSettings, scene);
+
+			for (SamplerType samplerType : options.Samplers)
+			{
+				for (uint32_t samples : options.SampleCounts)
+				{
+					RenderSettings settings = options.Settings;
+					settings.Samples = (int)samples;
+					settings.Sampling = samplerType;
+
+					std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+					std::vector<glm::vec3> image = RenderMeanImage(renderer, settings, scene);
+					float wallTime = MillisecondsSince(renderStart);
+
+					double squaredError = 0.0;
+					for (size_t i = 0; i < image.size(); i++)
+					{
+						glm::vec3 difference = image[i] - reference[i];
+						squaredError += glm::dot(difference, difference) / 3.0f;
+					}
+					double rmse = std::sqrt(squaredError / image.size());
+
+					results.AddRow();
+					results.Set("scene", scene.Name);
+					results.Set("sampler", Sampler::TypeName(samplerType));
+					results.Set("light_sampling", settings.LightSampling ? "on" : "off");
+					results.Set("samples", samples);
+					results.Set("reference_samples", options.ReferenceSamples);
+					results.Set("rmse", rmse);
+					results.Set("wall_ms", (double)wallTime);
+				}
+			}
+		}
+	}
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: Benchmark <bvh|scenes|noise> [options]\n"
+			<< "  bvh      BVH build time against primitive count\n"
+			<< "    --counts <n,n,...>     primitive counts to build (default 1000,10000,100000,1000000)\n"
+			<< "    --threads <n,n,...>    build thread counts (default powers of two up to all hardware threads)\n"
+			<< "    --method <sah|median>  only benchmark one builder (default both)\n"
+			<< "  scenes   render every built-in scene and report rays per second and traversal work\n"
+			<< "    --scenes <n,n,...>     scene indices (default all)\n"
+			<< "    --width <n>            image width (default 320)\n"
+			<< "    --height <n>           image height (default 180)\n"
+			<< "    --samples <n>          samples per pixel (default 16)\n"
+			<< "    --depth <n>            maximum bounces per path (default 20)\n"
+			<< "    --roulette-depth <n>   bounces before Russian roulette may end a path (default 3)\n"
+			<< "    --light-sampling <0|1> sample the lights directly at diffuse bounces (default 1)\n"
+			<< "    --packets <0|1>        trace camera rays in 8x8 packets (default 0)\n"
+			<< "    --wavefront <0|1>      render with the wavefront stages and report their times (default 0)\n"
+			<< "    --static-dispatch <0|1> call materials and textures by type tag, 0 uses virtual calls (default 1)\n"
+			<< "    --seed <n>             render seed (default 0)\n"
+			<< "    --render-threads <n>   render threads, 0 uses every hardware thread (default 0)\n"
+			<< "    --samplers <t,t,...>   independent, stratified, sobol, bluenoise (default sobol)\n"
+			<< "    --scene-arena <0|1>    build each scene's objects into one arena (default 1)\n"
+			<< "    --texture-cache-mb <n> memory for resident texture tiles (default 256)\n"
+			<< "  noise    RMSE against a high sample count reference for each sampler and sample count\n"
+			<< "    --scenes <n,n,...>     scene indices (default the Cornell Box)\n"
+			<< "    --width, --height      image size (default 128x128)\n"
+			<< "    --sample-counts <n,..> samples per pixel to measure (default 4,8,16,32,64)\n"
+			<< "    --reference-samples <n> samples per pixel of the reference (default 1024)\n"
+			<< "    --samplers <t,t,...>   samplers to compare (default all)\n"
+			<< "    --depth, --roulette-depth, --light-sampling, --packets, --wavefront, --static-dispatch, --seed, --render-threads as for scenes\n"
+			<< "  --repeat <n>             runs per configuration, the best time is reported (default 3)\n"
+			<< "  --format <json|csv>      result format (default json)\n"
+			<< "  --output <file>          write the results to a file instead of stdout\n";
+	}
+
+	bool ParseArguments(int argc, char** argv, BenchmarkOptions& options)
+	{
+		bool noiseMode = std::strcmp(argv[1], "noise") == 0;
+		options.Settings.Width = noiseMode ? 128 : 320;
+		options.Settings.Height = noiseMode ? 128 : 180;
+		options.Settings.Samples = 16;
+
+		for (int i = 2; i < argc; i++)
+		{
+			if (i + 1 >= argc)
+				return false;
+
+			const char* argument = argv[i];
+			const char* value = argv[++i];
+
+			if (std::strcmp(argument, "--counts") == 0)                options.PrimitiveCounts = ParseList(value);
+			else if (std::strcmp(argument, "--threads") == 0)          options.ThreadCounts = ParseList(value);
+			else if (std::strcmp(argument, "--method") == 0)
+				options.Methods = { std::strcmp(value, "median") == 0 ? BVHBuildMethod::Median : BVHBuildMethod::SAH };
+			else if (std::strcmp(argument, "--scenes") == 0)           options.Scenes = ParseList(value);
+			else if (std::strcmp(argument, "--width") == 0)            options.Settings.Width = (uint32_t)std::stoul(value);
+			else if (std::strcmp(argument, "--height") == 0)           options.Settings.Height = (uint32_t)std::stoul(value);
+			else if (std::strcmp(argument, "--samples") == 0)          options.Settings.Samples = std::stoi(value);
+			else if (std::strcmp(argument, "--depth") == 0)            options.Settings.MaxDepth = std::stoi(value);
+			else if (std::strcmp(argument, "--roulette-depth") == 0)   options.Settings.RouletteDepth = std::stoi(value);
+			else if (std::strcmp(argument, "--light-sampling") == 0)   options.Settings.LightSampling = std::stoi(value) != 0;
+			else if (std::strcmp(argument, "--packets") == 0)          options.Settings.PacketTracing = std::stoi(value) != 0;
+			else if (std::strcmp(argument, "--wavefront") == 0)        options.Settings.Wavefront = std::stoi(value) != 0;
+			else if (std::strcmp(argument, "--static-dispatch") == 0)  options.Settings.StaticDispatch = std::stoi(value) != 0;
+			else if (std::strcmp(argument, "--seed") == 0)             options.Settings.Seed = (uint32_t)std::stoul(value);
+			else if (std::strcmp(argument, "--render-threads") == 0)   options.Settings.ThreadCount = (uint32_t)std::stoul(value);
+			else if (std::strcmp(argument, "--samplers") == 0)         options.Samplers = ParseSamplers(value);
+			else if (std::strcmp(argument, "--scene-arena") == 0)      options.SceneArenas = std::stoi(value) != 0;
+			else if (std::strcmp(argument, "--texture-cache-mb") == 0) options.TextureCacheMB = std::stoull(value);
+			else if (std::strcmp(argument, "--sample-counts") == 0)    options.SampleCounts = ParseList(value);
+			else if (std::strcmp(argument, "--reference-samples") == 0) options.ReferenceSamples = (uint32_t)std::stoul(value);
+			else if (std::strcmp(argument, "--repeat") == 0)           options.Repetitions = std::max(1u, (uint32_t)std::stoul(value));
+			else if (std::strcmp(argument, "--format") == 0)           options.Format = value;
+			else if (std::strcmp(argument, "--output") == 0)           options.Output = value;
+			else return false;
+		}
+
+		return options.Format == "json" || options.Format == "csv";
+	}
+
+}
+
+int main(int argc, char** argv)
+{
+	bool bvhMode = argc >= 2 && std::strcmp(argv[1], "bvh") == 0;
+	bool scenesMode = argc >= 2 && std::strcmp(argv[1], "scenes") == 0;
+	bool noiseMode = argc >= 2 && std::strcmp(argv[1], "noise") == 0;
+
+	BenchmarkOptions options;
+	bool parsed = false;
+	try
+	{
+		parsed = (bvhMode || scenesMode || noiseMode) && ParseArguments(argc, argv, options);
+	}
+	catch (const std::exception&)
+	{
+	}
+
+	if (!parsed)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (options.ThreadCounts.empty())
+		options.ThreadCounts = DefaultThreadCounts();
+
+	if (options.Samplers.empty())
+	{
+		if (noiseMode)
+			options.Samplers = { SamplerType::Independent, SamplerType::Stratified, SamplerType::Sobol, SamplerType::BlueNoise };
+		else
+			options.Samplers = { options.Settings.Sampling };
+	}
+
+	const size_t sceneCount = SceneList::GetBuiltInScenes().size();
+	if (options.Scenes.empty() && noiseMode)
+		options.Scenes.push_back((uint32_t)SceneList::FindBuiltInScene("Cornell Box"));
+	else if (options.Scenes.empty())
+	{
+		for (uint32_t i = 0; i < sceneCount; i++)
+			options.Scenes.push_back(i);
+	}
+
+	for (uint32_t sceneIndex : options.Scenes)
+	{
+		if (sceneIndex >= sceneCount)
+		{
+			std::cerr << "ERROR: There is no built-in scene " << sceneIndex << ".\n";
+			return 1;
+		}
+	}
+
+	// Only the results go to stdout, so they can be piped straight into a file.
+	BVHNode::SetBuildLogging(false);
+	Renderer::SetLogging(false);
+	SceneArena::SetEnabled(options.SceneArenas);
+	TextureCache::Get().SetBudget(options.TextureCacheMB * 1024 * 1024);
+
+	ResultTable results;
+	results.SetInfo("benchmark", argv[1]);
+	results.SetInfo("hardware_threads", ThreadPool::HardwareThreads());
+	results.SetInfo("bvh_layout", BVHNode::LayoutName(BVHNode::ResolveLayout(BVHNode::GetDefaultLayout())));
+	results.SetInfo("statistics", Statistics::Enabled ? "enabled" : "disabled");
+
+	if (bvhMode)
+		BenchmarkBVHBuild(options, results);
+	else if (scenesMode)
+		BenchmarkScenes(options, results);
+	else
+		BenchmarkNoise(options, results);
+
+	std::ofstream file;
+	if (!options.Output.empty())
+	{
+		file.open(options.Output);
+		if (!file)
+		{
+			std::cerr << "ERROR: Could not open '" << options.Output << "' for writing.\n";
+			return 1;
+		}
+	}
+
+	std::ostream& stream = options.Output.empty() ? std::cout : file;
+	if (options.Format == "csv")
+		results.WriteCSV(stream);
+	else
+		results.WriteJSON(stream);
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include "rtpch.h"
+#include "ResultTable.h"
+
+#include <iomanip>
+
+void ResultTable::AddRow()
+{
+	m_Rows.emplace_back();
+}
+
+void ResultTable::Set(const std::string& column, const std::string& value)
+{
+	SetCell(column, { value, true });
+}
+
+void ResultTable::Set(const std::string& column, double value)
+{
+	std::ostringstream text;
+	text << std::setprecision(9) << value;
+	SetCell(column, { text.str(), false });
+}
+
+void ResultTable::Set(const std::string& column, uint64_t value)
+{
+	SetCell(column, { std::to_string(value), false });
+}
+
+void ResultTable::SetInfo(const std::string& key, const std::string& value)
+{
+	m_Info.emplace_back(key, Cell{ value, true });
+}
+
+void ResultTable::SetInfo(const std::string& key, uint64_t value)
+{
+	m_Info.emplace_back(key, Cell{ std::to_string(value), false });
+}
+
+void ResultTable::WriteCSV(std::ostream& stream) const
+{
+	for (size_t i = 0; i < m_Columns.size(); i++)
+		stream << (i > 0 ? "," : "") << m_Columns[i];
+	stream << "\n";
+
+	for (const auto& row : m_Rows)
+	{
+		for (size_t i = 0; i < m_Columns.size(); i++)
+		{
+			auto cell = row.find(m_Columns[i]);
+			if (i > 0) stream << ",";
+			if (cell != row.end())
+				stream << (cell->second.IsString ? QuoteCSV(cell->second.Text) : cell->second.Text);
+		}
+		stream << "\n";
+	}
+}
+
+void ResultTable::WriteJSON(std::ostream& stream) const
+{
+	stream << "{\n";
+	for (const auto& [key, cell] : m_Info)
+		stream << "  " << QuoteJSON(key) << ": " << (cell.IsString ? QuoteJSON(cell.Text) : cell.Text) << ",\n";
+
+	stream << "  \"results\": [";
+	for (size_t r = 0; r < m_Rows.size(); r++)
+	{
+		stream << (r > 0 ? ",\n    {" : "\n    {");
+
+		bool first = true;
+		for (const std::string& column : m_Columns)
+		{
+			auto cell = m_Rows[r].find(column);
+			if (cell == m_Rows[r].end()) continue;
+
+			stream << (first ? " " : ", ") << QuoteJSON(column) << ": " << (cell->second.IsString ? QuoteJSON(cell->second.Text) : cell->second.Text);
+			first = false;
+		}
+		stream << " }";
+	}
+	stream << "\n  ]\n}\n";
+}
+
+void ResultTable::SetCell(const std::string& column, Cell cell)
+{
+	if (m_Rows.empty())
+		AddRow();
+
+	if (std::find(m_Columns.begin(), m_Columns.end(), column) == m_Columns.end())
+		m_Columns.push_back(column);
+
+	m_Rows.back()[column] = std::move(cell);
+}
+
+std::string ResultTable::QuoteCSV(const std::string& text)
+{
+	std::string quoted = "\"";
+	for (char c : text)
+	{
+		if (c == '"')
+			quoted += '"';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+std::string ResultTable::QuoteJSON(const std::string& text)
+{
+	std::string quoted = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Rows of named values, written as CSV or JSON so benchmark runs of different commits can be
+// compared by scripts. Columns keep the order in which they were first set.
+class ResultTable
+{
+public:
+	void AddRow();
+
+	void Set(const std::string& column, const std::string& value);
+	void Set(const std::string& column, const char* value) { Set(column, std::string(value)); }
+	void Set(const std::string& column, double value);
+	void Set(const std::string& column, uint64_t value);
+	void Set(const std::string& column, uint32_t value) { Set(column, (uint64_t)value); }
+	void Set(const std::string& column, int value) { Set(column, (uint64_t)value); }
+
+	// Extra top level fields of the JSON output, ignored by CSV.
+	void SetInfo(const std::string& key, const std::string& value);
+	void SetInfo(const std::string& key, uint64_t value);
+
+	void WriteCSV(std::ostream& stream) const;
+	void WriteJSON(std::ostream& stream) const;
+
+private:
+	struct Cell
+	{
+		std::string Text;
+		bool IsString = false;
+	};
+
+	void SetCell(const std::string& column, Cell cell);
+	static std::string QuoteCSV(const std::string& text);
+	static std::string QuoteJSON(const std::string& text);
+
+private:
+	std::vector<std::string> m_Columns;
+	std::vector<std::unordered_map<std::string, Cell>> m_Rows;
+	std::vector<std::pair<std::string, Cell>> m_Info;
+};
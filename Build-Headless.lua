@@ -0,0 +1,23 @@
+-- premake5.lua
+-- Command line tools only, builds on machines without a display or the Vulkan SDK
+workspace "Raytracing-Headless"
+   architecture "x64"
+   configurations { "Debug", "Release", "Dist" }
+   startproject "RaytracingCLI"
+
+   -- Headless Walnut does not compile stb_image, the renderer has to bring its own
+   defines { "RT_HEADLESS" }
+
+   -- Workspace-wide build options for MSVC
+   filter "system:windows"
+      buildoptions { "/EHsc", "/Zc:preprocessor", "/Zc:__cplusplus" }
+
+outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
+
+WalnutProject = "Walnut-Headless"
+WalnutPlatformDir = "../Walnut/Platform/Headless"
+
+include "HeadlessDependencies.lua"
+include "RaytracingCLI/Build-RaytracingCLI.lua"
+include "Benchmark/Build-Benchmark.lua"
+include "Tests/Build-Tests.lua"
@@ -10,5 +10,12 @@ workspace "Raytracing"
 
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
+-- Walnut build the command line tools link against, Build-Headless.lua swaps in the headless one
+WalnutProject = "Walnut"
+WalnutPlatformDir = "../Walnut/Platform/GUI"
+
 include "Dependencies.lua"
-include "Raytracing/Build.lua"
\ No newline at end of file
+include "Raytracing/Build.lua"
+include "Benchmark/Build-Benchmark.lua"
+include "Tests/Build-Tests.lua"
+include "RaytracingCLI/Build-RaytracingCLI.lua"
\ No newline at end of file
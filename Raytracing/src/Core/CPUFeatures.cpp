@@ -0,0 +1,75 @@
+#include "rtpch.h"
+#include "Core/CPUFeatures.h"
+
+#if RT_SIMD_X86
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+namespace {
+
+#if RT_SIMD_X86
+	void CPUID(int leaf, int subleaf, uint32_t registers[4])
+	{
+	#ifdef _MSC_VER
+		__cpuidex((int*)registers, leaf, subleaf);
+	#else
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+	#endif
+	}
+
+	// The CPU supporting AVX is not enough, the OS also has to save the YMM registers on context switches.
+	bool OSSavesYMM()
+	{
+	#ifdef _MSC_VER
+		return (_xgetbv(0) & 0x6) == 0x6;
+	#else
+		uint32_t eax, edx;
+		__asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (eax & 0x6) == 0x6;
+	#endif
+	}
+
+	CPUFeatures Detect()
+	{
+		CPUFeatures features;
+
+		uint32_t registers[4] = {};
+		CPUID(0, 0, registers);
+		uint32_t maxLeaf = registers[0];
+		if (maxLeaf < 1)
+			return features;
+
+		CPUID(1, 0, registers);
+		features.SSE2 = (registers[3] >> 26) & 1;
+		features.SSE41 = (registers[2] >> 19) & 1;
+
+		bool osxsave = (registers[2] >> 27) & 1;
+		bool avx = (registers[2] >> 28) & 1;
+		features.AVX = avx && osxsave && OSSavesYMM();
+
+		if (maxLeaf >= 7)
+		{
+			CPUID(7, 0, registers);
+			features.AVX2 = features.AVX && ((registers[1] >> 5) & 1);
+		}
+
+		return features;
+	}
+#else
+	CPUFeatures Detect()
+	{
+		return {};
+	}
+#endif
+
+}
+
+const CPUFeatures& CPUFeatures::Get()
+{
+	static const CPUFeatures features = Detect();
+	return features;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// Instruction sets the SIMD code paths can pick from at runtime. The binary itself only
+// assumes the x64 baseline (SSE2), wider paths are compiled per function and only entered
+// when the running CPU and operating system support them.
+struct CPUFeatures
+{
+	bool SSE2 = false;
+	bool SSE41 = false;
+	bool AVX = false;
+	bool AVX2 = false;
+
+	static const CPUFeatures& Get();
+};
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+	#define RT_SIMD_X86 1
+#else
+	#define RT_SIMD_X86 0
+#endif
+
+// MSVC accepts AVX intrinsics in any function, GCC and Clang need them enabled per function.
+#if RT_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+	#define RT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+	#define RT_TARGET_AVX2
+#endif
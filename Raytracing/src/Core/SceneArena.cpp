@@ -0,0 +1,42 @@
+#include "rtpch.h"
+#include "Core/SceneArena.h"
+
+void* SceneArena::Allocate(size_t bytes, size_t alignment, uint32_t pool)
+{
+	if (pool >= m_Pools.size())
+		m_Pools.resize(pool + 1);
+	Pool& target = m_Pools[pool];
+
+	auto aligned = [alignment](std::byte* pointer)
+	{
+		uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+		return reinterpret_cast<std::byte*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	};
+
+	std::byte* start = target.Next ? aligned(target.Next) : nullptr;
+	if (!start || start + bytes > target.End)
+	{
+		// Anything larger than a block gets a block of its own
+		size_t blockSize = std::max(target.NextBlockSize, bytes + alignment);
+		target.NextBlockSize = std::min(target.NextBlockSize * 2, s_LargestBlockSize);
+
+		target.Blocks.push_back(std::unique_ptr<std::byte[]>(new std::byte[blockSize]));
+		target.Next = target.Blocks.back().get();
+		target.End = target.Next + blockSize;
+		m_BytesReserved += blockSize;
+
+		start = aligned(target.Next);
+	}
+
+	target.Next = start + bytes;
+	m_BytesAllocated += bytes;
+	return start;
+}
+
+size_t SceneArena::BlockCount() const
+{
+	size_t count = 0;
+	for (const Pool& pool : m_Pools)
+		count += pool.Blocks.size();
+	return count;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Owns the memory of the objects of one scene. Objects are packed into large blocks with one
+// pool of blocks per type, so the spheres, quads or triangles a traversal visits one after
+// another sit next to each other rather than wherever the heap put them. Releasing an object
+// runs its destructor and returns nothing, the blocks are all freed when the arena is destroyed.
+// Objects must not outlive their arena, the Scene that holds it releases its objects first.
+//
+// While an arena is bound to a thread, CreateRef allocates from it. Allocating is not thread
+// safe, a scene is built on one thread.
+class SceneArena
+{
+public:
+	// Standard allocator over the arena. shared_ptr keeps a copy next to each object's reference
+	// counts, a plain pointer keeps that copy small and free of reference counting.
+	template<typename T>
+	class Allocator
+	{
+	public:
+		using value_type = T;
+
+		Allocator(SceneArena* arena)
+			: m_Arena(arena)
+		{}
+
+		template<typename U>
+		Allocator(const Allocator<U>& other)
+			: m_Arena(other.m_Arena)
+		{}
+
+		T* allocate(size_t count) { return static_cast<T*>(m_Arena->Allocate(count * sizeof(T), alignof(T), PoolIndex<T>())); }
+		void deallocate(T*, size_t) {}
+
+		template<typename U>
+		bool operator==(const Allocator<U>& other) const { return m_Arena == other.m_Arena; }
+		template<typename U>
+		bool operator!=(const Allocator<U>& other) const { return m_Arena != other.m_Arena; }
+
+	private:
+		SceneArena* m_Arena;
+
+		template<typename U>
+		friend class Allocator;
+	};
+
+	// Makes an arena the target of CreateRef on this thread until the binding goes out of scope.
+	// A null arena unbinds, objects then come from the heap.
+	class Binding
+	{
+	public:
+		Binding(SceneArena* arena)
+			: m_Previous(s_Current)
+		{
+			s_Current = arena;
+		}
+
+		~Binding() { s_Current = m_Previous; }
+
+		Binding(const Binding&) = delete;
+		Binding& operator=(const Binding&) = delete;
+
+	private:
+		SceneArena* m_Previous;
+	};
+
+public:
+	SceneArena() = default;
+
+	SceneArena(const SceneArena&) = delete;
+	SceneArena& operator=(const SceneArena&) = delete;
+
+	void* Allocate(size_t bytes, size_t alignment, uint32_t pool);
+
+	// Bytes handed out to objects, and bytes of the blocks they were taken from
+	size_t BytesAllocated() const { return m_BytesAllocated; }
+	size_t BytesReserved() const { return m_BytesReserved; }
+	size_t BlockCount() const;
+
+	static SceneArena* Current() { return s_Current; }
+
+	// Scenes are built without arenas when disabled, to compare against
+	static void SetEnabled(bool enabled) { s_Enabled = enabled; }
+	static bool IsEnabled() { return s_Enabled; }
+
+private:
+	// Numbers the types on first use, each type has its own pool in every arena
+	template<typename T>
+	static uint32_t PoolIndex()
+	{
+		static const uint32_t index = s_NextPoolIndex++;
+		return index;
+	}
+
+private:
+	struct Pool
+	{
+		std::vector<std::unique_ptr<std::byte[]>> Blocks;
+		std::byte* Next = nullptr;
+		std::byte* End = nullptr;
+		size_t NextBlockSize = s_FirstBlockSize;
+	};
+
+	std::vector<Pool> m_Pools;
+	size_t m_BytesAllocated = 0;
+	size_t m_BytesReserved = 0;
+
+	// Blocks of a pool double in size from the first up to the largest
+	static constexpr size_t s_FirstBlockSize = 16 * 1024;
+	static constexpr size_t s_LargestBlockSize = 1024 * 1024;
+
+	static inline std::atomic<uint32_t> s_NextPoolIndex = 0;
+	static inline thread_local SceneArena* s_Current = nullptr;
+	static inline bool s_Enabled = true;
+};
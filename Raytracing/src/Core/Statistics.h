@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// Per thread counters of the tracing work, summed up by the Renderer after every dispatch.
+// Counting costs a little in the hot loops, so the counters are only compiled in when
+// RT_ENABLE_STATISTICS is defined (the Benchmark project does); otherwise they stay zero.
+struct RayStatistics
+{
+	uint64_t PrimaryRays = 0;
+	uint64_t TotalRays = 0;        // Every ray traced against the world, primary ones included
+	uint64_t ShadowRays = 0;       // Occlusion queries towards sampled lights, included in TotalRays
+	uint64_t NodesVisited = 0;     // BVH nodes whose children or primitives were looked at
+	uint64_t PrimitiveTests = 0;   // Ray/sphere and ray/quad intersection tests
+
+	RayStatistics& operator+=(const RayStatistics& other)
+	{
+		PrimaryRays += other.PrimaryRays;
+		TotalRays += other.TotalRays;
+		ShadowRays += other.ShadowRays;
+		NodesVisited += other.NodesVisited;
+		PrimitiveTests += other.PrimitiveTests;
+		return *this;
+	}
+};
+
+class Statistics
+{
+public:
+#ifdef RT_ENABLE_STATISTICS
+	static constexpr bool Enabled = true;
+#else
+	static constexpr bool Enabled = false;
+#endif
+
+	static RayStatistics& Local() { return s_Local; }
+	static void ResetLocal() { s_Local = RayStatistics(); }
+
+private:
+	static inline thread_local RayStatistics s_Local;
+};
+
+#ifdef RT_ENABLE_STATISTICS
+	#define RT_COUNT(counter) (++Statistics::Local().counter)
+	#define RT_COUNT_ADD(counter, amount) (Statistics::Local().counter += (amount))
+#else
+	#define RT_COUNT(counter) ((void)0)
+	#define RT_COUNT_ADD(counter, amount) ((void)0)
+#endif
@@ -0,0 +1,96 @@
+#include "rtpch.h"
+#include "Core/ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t workerCount)
+{
+	m_Workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++)
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_ShuttingDown = true;
+	}
+	m_Condition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+void ThreadPool::Run(TaskGroup& group, std::function<void()> task)
+{
+	group.m_Pending.fetch_add(1, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push_back({ std::move(task), &group });
+	}
+	// Waiters sleep on the same condition and may want to help with the new task.
+	m_Condition.notify_all();
+}
+
+void ThreadPool::Wait(TaskGroup& group)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (!group.Done())
+	{
+		if (m_Tasks.empty())
+		{
+			m_Condition.wait(lock);
+			continue;
+		}
+
+		Task task = std::move(m_Tasks.front());
+		m_Tasks.pop_front();
+
+		lock.unlock();
+		Execute(task);
+		lock.lock();
+	}
+}
+
+void ThreadPool::Dispatch(const std::function<void(uint32_t)>& job)
+{
+	TaskGroup group;
+	for (uint32_t i = 0; i < Concurrency(); i++)
+		Run(group, [&job, i]() { job(i); });
+
+	Wait(group);
+}
+
+uint32_t ThreadPool::HardwareThreads()
+{
+	// hardware_concurrency is allowed to return 0 when it cannot tell.
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (true)
+	{
+		m_Condition.wait(lock, [this]() { return m_ShuttingDown || !m_Tasks.empty(); });
+		if (m_Tasks.empty()) return;
+
+		Task task = std::move(m_Tasks.front());
+		m_Tasks.pop_front();
+
+		lock.unlock();
+		Execute(task);
+		lock.lock();
+	}
+}
+
+void ThreadPool::Execute(Task& task)
+{
+	task.Function();
+
+	if (task.Group->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		// Notify under the lock, so a waiter cannot check the group and go to sleep in between.
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Condition.notify_all();
+	}
+}
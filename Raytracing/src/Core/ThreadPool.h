@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// Tracks a set of tasks that can be waited on together.
+	class TaskGroup
+	{
+	public:
+		bool Done() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		std::atomic<uint32_t> m_Pending = 0;
+
+		friend class ThreadPool;
+	};
+
+public:
+	// Threads that wait on the pool help out, so a pool of N - 1 workers keeps N threads busy.
+	ThreadPool(uint32_t workerCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Queues a task for any worker to pick up.
+	void Run(TaskGroup& group, std::function<void()> task);
+
+	// Blocks until every task of the group has finished. The calling thread runs queued tasks
+	// in the meantime, so tasks can spawn and wait for subtasks without starving the pool.
+	void Wait(TaskGroup& group);
+
+	// Runs job(index) for every index in [0, Concurrency()) and blocks until all of them have returned.
+	void Dispatch(const std::function<void(uint32_t)>& job);
+
+	uint32_t Size() const { return (uint32_t)m_Workers.size(); }
+	// Number of threads working on the pool's tasks while the calling thread waits on them.
+	uint32_t Concurrency() const { return Size() + 1; }
+
+	static uint32_t HardwareThreads();
+
+private:
+	struct Task
+	{
+		std::function<void()> Function;
+		TaskGroup* Group;
+	};
+
+	void WorkerLoop();
+	void Execute(Task& task);
+
+private:
+	std::vector<std::thread> m_Workers;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	std::deque<Task> m_Tasks;
+	bool m_ShuttingDown = false;
+};
@@ -2,15 +2,17 @@
 #include "Math/AABB.h"
 #include "Math/MathUtil.h"
 
-const AABB AABB::Empty      =   AABB(Interval::Empty, Interval::Empty, Interval::Empty);
-const AABB AABB::Universe   =   AABB(Interval::Universe, Interval::Universe, Interval::Universe);
+// Spelled out instead of built from Interval::Empty/Universe, the initialization order of
+// statics across translation units is unspecified.
+const AABB AABB::Empty      =   AABB();
+const AABB AABB::Universe   =   AABB(Interval(-INFINITY, INFINITY), Interval(-INFINITY, INFINITY), Interval(-INFINITY, INFINITY));
 
 AABB::AABB(const Interval& x, const Interval& y, const Interval& z)
-    : m_Min(std::numeric_limits<float>::max()), m_Max(std::numeric_limits<float>::min())
+    : m_Min(x.min(), y.min(), z.min()), m_Max(x.max(), y.max(), z.max())
 {}
 
-AABB::AABB(const glm::vec3& min, glm::vec3& max)
-    : m_Min(min), m_Max(max)
+AABB::AABB(const glm::vec3& a, const glm::vec3& b)
+    : m_Min(glm::min(a, b)), m_Max(glm::max(a, b))
 {}
     
 
@@ -20,9 +22,8 @@ AABB::AABB(const AABB& left, const AABB& right)
 
 bool AABB::Hit(const Ray& ray, Interval rayInterval) const
 {
-    const glm::vec3 invDirection = 1.0f / ray.Direction();
-    const glm::vec3 t0 = (m_Min - ray.Origin()) * invDirection;
-    const glm::vec3 t1 = (m_Max - ray.Origin()) * invDirection;
+    const glm::vec3 t0 = (m_Min - ray.Origin()) * ray.InverseDirection();
+    const glm::vec3 t1 = (m_Max - ray.Origin()) * ray.InverseDirection();
 
     float tMin = std::max(rayInterval.min(), MathUtil::Max(glm::min(t0, t1)));
     float tMax = std::min(rayInterval.max(), MathUtil::Min(glm::max(t0, t1)));
@@ -30,6 +31,25 @@ bool AABB::Hit(const Ray& ray, Interval rayInterval) const
     return tMax > tMin;
 }
 
+void AABB::PadToMinimums(float delta)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (m_Max[axis] - m_Min[axis] < delta)
+        {
+            m_Min[axis] -= 0.5f * delta;
+            m_Max[axis] += 0.5f * delta;
+        }
+    }
+}
+
+float AABB::SurfaceArea() const
+{
+    // Empty boxes have min > max, clamping the extent keeps their area at zero.
+    glm::vec3 extent = glm::max(m_Max - m_Min, glm::vec3(0.0f));
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
 int AABB::LongestAxis() const
 {
     // Returns the index of the longest axis of the bounding box.
@@ -7,14 +7,25 @@
 
 class AABB {
 public:
-	AABB() = default;
+	// A default box is empty, so it can seed a union of boxes.
+	AABB()
+		: m_Min(INFINITY), m_Max(-INFINITY)
+	{}
+
 	AABB(const Interval& x, const Interval& y, const Interval& z);
-	AABB(const glm::vec3& min, glm::vec3& max);
+	// Box spanned by two opposite corners, in any order
+	AABB(const glm::vec3& a, const glm::vec3& b);
 	AABB(const AABB& left, const AABB& right);
 
 	bool Hit(const Ray& ray, Interval rayInterval) const;
 
+	// Widens every axis thinner than delta, flat boxes would never pass the strict slab tests.
+	void PadToMinimums(float delta = 0.0001f);
+
 	int LongestAxis() const;
+	float SurfaceArea() const;
+
+	glm::vec3 Centroid() const { return 0.5f * (m_Min + m_Max); }
 
 	inline glm::vec3 min() const { return m_Min; }
 	inline glm::vec3 max() const { return m_Max; }
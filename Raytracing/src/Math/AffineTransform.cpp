@@ -0,0 +1,67 @@
+#include "rtpch.h"
+#include "Math/AffineTransform.h"
+
+#include "Math/MathUtil.h"
+
+AffineTransform AffineTransform::FromTranslation(const glm::vec3& offset)
+{
+	return AffineTransform(glm::mat3(1.0f), offset);
+}
+
+AffineTransform AffineTransform::FromRotationY(float degrees)
+{
+	float radians = MathUtil::DegreeToRadians(degrees);
+	float sinTheta = std::sin(radians), cosTheta = std::cos(radians);
+	glm::mat3 linear(glm::vec3(cosTheta, 0.0f, -sinTheta), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(sinTheta, 0.0f, cosTheta));
+	return AffineTransform(linear, glm::vec3(0.0f));
+}
+
+AffineTransform AffineTransform::FromRotation(float degrees, const glm::vec3& axis)
+{
+	// Rodrigues' formula, one column per rotated basis vector
+	float radians = MathUtil::DegreeToRadians(degrees);
+	float sinTheta = std::sin(radians), cosTheta = std::cos(radians);
+	glm::vec3 a = glm::normalize(axis);
+	glm::mat3 linear;
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec3 basis(0.0f);
+		basis[i] = 1.0f;
+		linear[i] = basis * cosTheta + glm::cross(a, basis) * sinTheta + a * glm::dot(a, basis) * (1.0f - cosTheta);
+	}
+	return AffineTransform(linear, glm::vec3(0.0f));
+}
+
+AffineTransform AffineTransform::FromScale(const glm::vec3& factors)
+{
+	glm::mat3 linear(glm::vec3(factors.x, 0.0f, 0.0f), glm::vec3(0.0f, factors.y, 0.0f), glm::vec3(0.0f, 0.0f, factors.z));
+	return AffineTransform(linear, glm::vec3(0.0f));
+}
+
+AffineTransform AffineTransform::operator*(const AffineTransform& other) const
+{
+	return AffineTransform(m_Linear * other.m_Linear, m_Linear * other.m_Translation + m_Translation);
+}
+
+AffineTransform AffineTransform::Inverse() const
+{
+	glm::mat3 inverseLinear = glm::inverse(m_Linear);
+	return AffineTransform(inverseLinear, -(inverseLinear * m_Translation));
+}
+
+AABB AffineTransform::TransformBox(const AABB& box) const
+{
+	// An empty box stays empty, its infinities would turn into NaNs
+	if (box.min().x > box.max().x)
+		return box;
+
+	glm::vec3 min = m_Translation, max = m_Translation;
+	for (int column = 0; column < 3; column++)
+	{
+		glm::vec3 a = m_Linear[column] * box.min()[column];
+		glm::vec3 b = m_Linear[column] * box.max()[column];
+		min += glm::min(a, b);
+		max += glm::max(a, b);
+	}
+	return AABB(min, max);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Math/AABB.h"
+
+// Affine transform stored as a 3x4 matrix, a linear part followed by a translation.
+class AffineTransform
+{
+public:
+	AffineTransform() = default;
+	AffineTransform(const glm::mat3& linear, const glm::vec3& translation)
+		: m_Linear(linear), m_Translation(translation)
+	{}
+
+	static AffineTransform FromTranslation(const glm::vec3& offset);
+	// Same sense of rotation as RotateY
+	static AffineTransform FromRotationY(float degrees);
+	static AffineTransform FromRotation(float degrees, const glm::vec3& axis);
+	static AffineTransform FromScale(const glm::vec3& factors);
+
+	// Applies other first, then this transform
+	AffineTransform operator*(const AffineTransform& other) const;
+	AffineTransform Inverse() const;
+
+	glm::vec3 TransformPoint(const glm::vec3& point) const { return m_Linear * point + m_Translation; }
+	glm::vec3 TransformVector(const glm::vec3& vector) const { return m_Linear * vector; }
+	// Tight box around the transformed box (Arvo, "Transforming Axis-Aligned Bounding Boxes")
+	AABB TransformBox(const AABB& box) const;
+
+	const glm::mat3& Linear() const { return m_Linear; }
+	const glm::vec3& Translation() const { return m_Translation; }
+
+private:
+	glm::mat3 m_Linear = glm::mat3(1.0f);
+	glm::vec3 m_Translation = glm::vec3(0.0f);
+};
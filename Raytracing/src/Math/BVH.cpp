@@ -1,64 +1,1111 @@
 #include "rtpch.h"
 #include "Math/BVH.h"
-
-#include <Walnut/Random.h>
+#include "Math/MathUtil.h"
+#include "Core/Statistics.h"
+#include "Objects/TriangleMesh.h"
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
 
-BVHNode::BVHNode(HittableList list)
-	: BVHNode(list.Objects(), 0, list.Objects().size())
+#if RT_SIMD_X86
+	#include <immintrin.h>
+#endif
+
+namespace {
+
+	inline bool HitNodeBounds(const LinearBVHNode& node, const glm::vec3& origin, const glm::vec3& invDirection, const Interval& rayInterval)
+	{
+		const glm::vec3 t0 = (node.Min - origin) * invDirection;
+		const glm::vec3 t1 = (node.Max - origin) * invDirection;
+
+		float tMin = std::max(rayInterval.min(), MathUtil::Max(glm::min(t0, t1)));
+		float tMax = std::min(rayInterval.max(), MathUtil::Min(glm::max(t0, t1)));
+
+		return tMax > tMin;
+	}
+
+	inline float NodeSurfaceArea(const LinearBVHNode& node)
+	{
+		return AABB(node.Min, node.Max).SurfaceArea();
+	}
+
+	// Slab tests against all children of a wide node. Every intersector picks the near and far
+	// plane per axis from the ray's direction signs up front, so a child's entry and exit distances
+	// need no min/max of their own and inverted (unused) slots can never be hit. Bits of the
+	// returned mask are set for every child the ray enters before it leaves, distances receives
+	// the entry distances.
+	template<uint32_t Width>
+	struct ScalarIntersector
+	{
+		glm::vec3 Origin, InverseDirection;
+		int Near[3], Far[3];
+
+		ScalarIntersector() = default;
+		ScalarIntersector(const Ray& ray)
+			: Origin(ray.Origin()), InverseDirection(ray.InverseDirection())
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				Near[axis] = InverseDirection[axis] < 0.0f ? axis + 3 : axis;
+				Far[axis] = InverseDirection[axis] < 0.0f ? axis : axis + 3;
+			}
+		}
+
+		uint32_t operator()(const WideBVHNode<Width>& node, float tMin, float tMax, float* distances) const
+		{
+			uint32_t mask = 0;
+			for (uint32_t i = 0; i < Width; i++)
+			{
+				float tNear = tMin, tFar = tMax;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float tNearAxis = (node.Bounds[Near[axis]][i] - Origin[axis]) * InverseDirection[axis];
+					float tFarAxis = (node.Bounds[Far[axis]][i] - Origin[axis]) * InverseDirection[axis];
+					// Written so a NaN from a ray lying in a slab plane leaves the interval untouched, like the SIMD paths
+					tNear = tNearAxis > tNear ? tNearAxis : tNear;
+					tFar = tFarAxis < tFar ? tFarAxis : tFar;
+				}
+
+				distances[i] = tNear;
+				mask |= (uint32_t)(tNear < tFar) << i;
+			}
+			return mask;
+		}
+	};
+
+#if RT_SIMD_X86
+	struct SSEIntersector
+	{
+		__m128 Origin[3], InverseDirection[3];
+		int Near[3], Far[3];
+
+		SSEIntersector() = default;
+		SSEIntersector(const Ray& ray)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				Origin[axis] = _mm_set1_ps(ray.Origin()[axis]);
+				InverseDirection[axis] = _mm_set1_ps(ray.InverseDirection()[axis]);
+				Near[axis] = ray.InverseDirection()[axis] < 0.0f ? axis + 3 : axis;
+				Far[axis] = ray.InverseDirection()[axis] < 0.0f ? axis : axis + 3;
+			}
+		}
+
+		uint32_t operator()(const WideBVHNode<4>& node, float tMin, float tMax, float* distances) const
+		{
+			__m128 tNear = _mm_set1_ps(tMin);
+			__m128 tFar = _mm_set1_ps(tMax);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				__m128 tNearAxis = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.Bounds[Near[axis]]), Origin[axis]), InverseDirection[axis]);
+				__m128 tFarAxis = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.Bounds[Far[axis]]), Origin[axis]), InverseDirection[axis]);
+				// max/min return their second operand for NaN, which keeps the running interval
+				tNear = _mm_max_ps(tNearAxis, tNear);
+				tFar = _mm_min_ps(tFarAxis, tFar);
+			}
+
+			_mm_storeu_ps(distances, tNear);
+			return (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(tNear, tFar));
+		}
+	};
+
+	struct AVX2Intersector
+	{
+		__m256 Origin[3], InverseDirection[3];
+		int Near[3], Far[3];
+
+		AVX2Intersector() = default;
+		RT_TARGET_AVX2 AVX2Intersector(const Ray& ray)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				Origin[axis] = _mm256_set1_ps(ray.Origin()[axis]);
+				InverseDirection[axis] = _mm256_set1_ps(ray.InverseDirection()[axis]);
+				Near[axis] = ray.InverseDirection()[axis] < 0.0f ? axis + 3 : axis;
+				Far[axis] = ray.InverseDirection()[axis] < 0.0f ? axis : axis + 3;
+			}
+		}
+
+		RT_TARGET_AVX2 uint32_t operator()(const WideBVHNode<8>& node, float tMin, float tMax, float* distances) const
+		{
+			__m256 tNear = _mm256_set1_ps(tMin);
+			__m256 tFar = _mm256_set1_ps(tMax);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				__m256 tNearAxis = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.Bounds[Near[axis]]), Origin[axis]), InverseDirection[axis]);
+				__m256 tFarAxis = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.Bounds[Far[axis]]), Origin[axis]), InverseDirection[axis]);
+				tNear = _mm256_max_ps(tNearAxis, tNear);
+				tFar = _mm256_min_ps(tFarAxis, tFar);
+			}
+
+			_mm256_storeu_ps(distances, tNear);
+			return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LT_OQ));
+		}
+	};
+#endif
+
+	template<uint32_t Width, typename Intersector>
+	inline bool TraverseWide(const std::vector<WideBVHNode<Width>>& nodes, const PrimitiveArrays& primitives,
+		const Ray& ray, Interval rayInterval, HitRecord& record, const Intersector& intersect)
+	{
+		struct StackEntry
+		{
+			uint32_t Index;
+			uint16_t PrimitiveCount;
+			float Distance;
+		};
+
+		// Every level of the collapsed tree is at most as deep as the binary one and pushes fewer than Width entries.
+		StackEntry stack[64 * Width];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, 0, rayInterval.min() };
+		bool hitAnything = false;
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			// The closest hit may have moved in front of this entry since it was pushed.
+			if (entry.Distance >= rayInterval.max())
+				continue;
+
+			if (entry.PrimitiveCount > 0)
+			{
+				if (primitives.Hit(entry.Index, entry.PrimitiveCount, ray, rayInterval, record))
+				{
+					hitAnything = true;
+					rayInterval.max(record.Intersection);
+				}
+				continue;
+			}
+
+			const WideBVHNode<Width>& node = nodes[entry.Index];
+			RT_COUNT(NodesVisited);
+			alignas(32) float distances[Width];
+			uint32_t mask = intersect(node, rayInterval.min(), rayInterval.max(), distances);
+
+			// Push the children far to near, so the nearest one is popped first.
+			uint32_t pushStart = stackSize;
+			for (uint32_t i = 0; i < Width; i++)
+			{
+				if (!(mask & (1u << i))) continue;
+
+				StackEntry child = { node.Child[i], node.PrimitiveCount[i], distances[i] };
+				uint32_t j = stackSize++;
+				for (; j > pushStart && stack[j - 1].Distance < child.Distance; j--)
+					stack[j] = stack[j - 1];
+				stack[j] = child;
+			}
+		}
+
+		return hitAnything;
+	}
+
+	// Any hit version of TraverseWide. The interval never shrinks, so children are pushed
+	// unsorted and the first primitive that reports a hit ends the traversal.
+	template<uint32_t Width, typename Intersector>
+	inline bool OccludedWide(const std::vector<WideBVHNode<Width>>& nodes, const PrimitiveArrays& primitives,
+		const Ray& ray, Interval rayInterval, const Intersector& intersect)
+	{
+		struct StackEntry
+		{
+			uint32_t Index;
+			uint16_t PrimitiveCount;
+		};
+
+		StackEntry stack[64 * Width];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, 0 };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			if (entry.PrimitiveCount > 0)
+			{
+				if (primitives.Occluded(entry.Index, entry.PrimitiveCount, ray, rayInterval))
+					return true;
+				continue;
+			}
+
+			const WideBVHNode<Width>& node = nodes[entry.Index];
+			RT_COUNT(NodesVisited);
+			alignas(32) float distances[Width];
+			uint32_t mask = intersect(node, rayInterval.min(), rayInterval.max(), distances);
+
+			for (uint32_t i = 0; i < Width; i++)
+			{
+				if (mask & (1u << i))
+					stack[stackSize++] = { node.Child[i], node.PrimitiveCount[i] };
+			}
+		}
+
+		return false;
+	}
+
+	// Interval arithmetic bounds of (plane - origin) * inverse direction over all rays of a packet
+	inline void PacketSlabBounds(float plane, float originMin, float originMax, float inverseMin, float inverseMax, float& low, float& high)
+	{
+		float a = (plane - originMax) * inverseMin, b = (plane - originMax) * inverseMax;
+		float c = (plane - originMin) * inverseMin, d = (plane - originMin) * inverseMax;
+		low = std::min(std::min(a, b), std::min(c, d));
+		high = std::max(std::max(a, b), std::max(c, d));
+	}
+
+	// Children of a wide node that some ray of the packet may enter, without testing the rays one
+	// by one. Rounding is monotonic, so the bounds contain every ray's own slab distances and no
+	// child a ray hits gets culled. Unused slots have inverted bounds and are always culled. Needs
+	// a packet whose rays all point into the same octant.
+	template<uint32_t Width>
+	inline uint32_t PacketCull(const WideBVHNode<Width>& node, const RayPacket& packet, float tMin)
+	{
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < Width; i++)
+		{
+			float entry = tMin, exit = INFINITY;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				bool negative = packet.InverseMin[axis] < 0.0f;
+				float nearPlane = node.Bounds[negative ? axis + 3 : axis][i];
+				float farPlane = node.Bounds[negative ? axis : axis + 3][i];
+
+				float low, high;
+				PacketSlabBounds(nearPlane, packet.OriginMin[axis], packet.OriginMax[axis], packet.InverseMin[axis], packet.InverseMax[axis], low, high);
+				entry = std::max(entry, low);
+				PacketSlabBounds(farPlane, packet.OriginMin[axis], packet.OriginMax[axis], packet.InverseMin[axis], packet.InverseMax[axis], low, high);
+				exit = std::min(exit, high);
+			}
+			mask |= (uint32_t)(entry < exit) << i;
+		}
+		return mask;
+	}
+
+	// PacketCull costs about as much as a few rays' own box tests, so nodes entered by fewer rays
+	// than this test them one by one.
+	constexpr uint32_t s_MinCullRays = 16;
+
+	// Packet version of TraverseWide. Every entry carries the mask of rays that entered its node,
+	// only those rays slab test the node's children (all of them at once, like TraverseWide), so
+	// each ray does the box tests it would do on its own while the node is fetched once per packet.
+	template<uint32_t Width, typename Intersector>
+	inline RayMask TraversePacketWide(const std::vector<WideBVHNode<Width>>& nodes, const PrimitiveArrays& primitives,
+		const RayPacket& packet, float tMin, float* closest, HitRecord* records, const Intersector* intersect)
+	{
+		struct StackEntry
+		{
+			uint32_t Index;
+			uint16_t PrimitiveCount;
+			float Distance;   // Nearest entry distance of its rays, orders the children
+			RayMask Rays;
+		};
+
+		StackEntry stack[64 * Width];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, 0, tMin, packet.Size == RayPacket::MaxSize ? ~(RayMask)0 : ((RayMask)1 << packet.Size) - 1 };
+		RayMask hitMask = 0;
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+
+			if (entry.PrimitiveCount > 0)
+			{
+				for (RayMask rays = entry.Rays; rays; rays &= rays - 1)
+				{
+					uint32_t k = LowestRay(rays);
+					if (primitives.Hit(entry.Index, entry.PrimitiveCount, packet.Rays[k], Interval(tMin, closest[k]), records[k]))
+					{
+						hitMask |= (RayMask)1 << k;
+						closest[k] = records[k].Intersection;
+					}
+				}
+				continue;
+			}
+
+			const WideBVHNode<Width>& node = nodes[entry.Index];
+			RT_COUNT(NodesVisited);
+
+			uint32_t candidates = (1u << Width) - 1;
+			if (packet.SameOctant && CountRays(entry.Rays) >= s_MinCullRays)
+			{
+				candidates = PacketCull(node, packet, tMin);
+				if (!candidates) continue;
+			}
+
+			RayMask childRays[Width] = {};
+			float childDistance[Width];
+			for (uint32_t i = 0; i < Width; i++)
+				childDistance[i] = INFINITY;
+
+			for (RayMask rays = entry.Rays; rays; rays &= rays - 1)
+			{
+				uint32_t k = LowestRay(rays);
+				alignas(32) float distances[Width];
+				uint32_t mask = intersect[k](node, tMin, closest[k], distances) & candidates;
+				for (uint32_t i = 0; i < Width; i++)
+				{
+					if (!(mask & (1u << i))) continue;
+					childRays[i] |= (RayMask)1 << k;
+					childDistance[i] = std::min(childDistance[i], distances[i]);
+				}
+			}
+
+			// Push the children far to near, so the nearest one is popped first.
+			uint32_t pushStart = stackSize;
+			for (uint32_t i = 0; i < Width; i++)
+			{
+				if (!childRays[i]) continue;
+
+				StackEntry child = { node.Child[i], node.PrimitiveCount[i], childDistance[i], childRays[i] };
+				uint32_t j = stackSize++;
+				for (; j > pushStart && stack[j - 1].Distance < child.Distance; j--)
+					stack[j] = stack[j - 1];
+				stack[j] = child;
+			}
+		}
+
+		return hitMask;
+	}
+
+#if RT_SIMD_X86
+	// Compiled for AVX2 as a whole, so the intersector gets inlined into the traversal loop.
+	RT_TARGET_AVX2 bool HitAVX2(const std::vector<WideBVHNode<8>>& nodes, const PrimitiveArrays& primitives,
+		const Ray& ray, Interval rayInterval, HitRecord& record)
+	{
+		return TraverseWide(nodes, primitives, ray, rayInterval, record, AVX2Intersector(ray));
+	}
+
+	RT_TARGET_AVX2 bool OccludedAVX2(const std::vector<WideBVHNode<8>>& nodes, const PrimitiveArrays& primitives,
+		const Ray& ray, Interval rayInterval)
+	{
+		return OccludedWide(nodes, primitives, ray, rayInterval, AVX2Intersector(ray));
+	}
+
+	RT_TARGET_AVX2 RayMask HitPacketAVX2(const std::vector<WideBVHNode<8>>& nodes, const PrimitiveArrays& primitives,
+		const RayPacket& packet, float tMin, float* closest, HitRecord* records)
+	{
+		AVX2Intersector intersectors[RayPacket::MaxSize];
+		for (uint32_t k = 0; k < packet.Size; k++)
+			intersectors[k] = AVX2Intersector(packet.Rays[k]);
+		return TraversePacketWide(nodes, primitives, packet, tMin, closest, records, intersectors);
+	}
+#endif
+
+	template<uint32_t Width, typename Intersector>
+	RayMask HitPacketWide(const std::vector<WideBVHNode<Width>>& nodes, const PrimitiveArrays& primitives,
+		const RayPacket& packet, float tMin, float* closest, HitRecord* records)
+	{
+		Intersector intersectors[RayPacket::MaxSize];
+		for (uint32_t k = 0; k < packet.Size; k++)
+			intersectors[k] = Intersector(packet.Rays[k]);
+		return TraversePacketWide(nodes, primitives, packet, tMin, closest, records, intersectors);
+	}
+
+	constexpr size_t s_MinParallelChunk = 16384;
+
+	// Splits [start, end) into one chunk per thread, reduces every chunk on its own and merges the results.
+	template<typename Result, typename ChunkFunction, typename MergeFunction>
+	Result ParallelReduce(ThreadPool* pool, size_t start, size_t end, const ChunkFunction& reduceChunk, const MergeFunction& merge)
+	{
+		size_t span = end - start;
+		size_t chunkCount = pool ? std::min<size_t>(pool->Concurrency(), span / s_MinParallelChunk) : 1;
+		if (chunkCount <= 1)
+			return reduceChunk(start, end);
+
+		std::vector<Result> results(chunkCount);
+		ThreadPool::TaskGroup group;
+		for (size_t chunk = 1; chunk < chunkCount; chunk++)
+		{
+			pool->Run(group, [&, chunk]()
+				{
+					results[chunk] = reduceChunk(start + span * chunk / chunkCount, start + span * (chunk + 1) / chunkCount);
+				});
+		}
+		results[0] = reduceChunk(start, start + span / chunkCount);
+		pool->Wait(group);
+
+		for (size_t chunk = 1; chunk < chunkCount; chunk++)
+			merge(results[0], results[chunk]);
+
+		return results[0];
+	}
+
+	template<typename Function>
+	void ParallelFor(ThreadPool* pool, size_t start, size_t end, const Function& function)
+	{
+		ParallelReduce<char>(pool, start, end,
+			[&](size_t chunkStart, size_t chunkEnd)
+			{
+				for (size_t i = chunkStart; i < chunkEnd; i++)
+					function(i);
+				return char(0);
+			},
+			[](char&, char) {});
+	}
+
+}
+
+BVHNode::BVHNode(const HittableList& list, BVHBuildMethod method)
+{
+	Build(list.Objects(), 0, list.Objects().size(), method);
+}
+
+BVHNode::BVHNode(const std::vector<std::shared_ptr<Hittable>>& objects, size_t start, size_t end, BVHBuildMethod method)
+{
+	Build(objects, start, end, method);
+}
+
+BVHNode::BVHNode(MeshData& mesh, const Material::Blank* material, BVHBuildMethod method)
+{
+	std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+	std::vector<uint32_t> order = BuildTree(mesh.TriangleCount(), [&](uint32_t i) { return mesh.TriangleBounds(i); }, method);
+
+	// Put the triangles in leaf order, a leaf's range of primitives is then its range of triangles
+	std::vector<uint32_t> indices(mesh.Indices.size());
+	for (size_t i = 0; i < order.size(); i++)
+		std::copy_n(mesh.Indices.begin() + 3 * (size_t)order[i], 3, indices.begin() + 3 * i);
+	mesh.Indices.swap(indices);
+
+	m_Arrays.Build(mesh, material);
+	FinishBuild(buildStart);
+}
+
+const char* BVHNode::BuildMethodName(BVHBuildMethod method)
+{
+	switch (method)
+	{
+	case BVHBuildMethod::Median: return "Median";
+	case BVHBuildMethod::SAH:    return "SAH";
+	}
+	return "Unknown";
+}
+
+BVHLayout BVHNode::ResolveLayout(BVHLayout layout)
+{
+	if (layout != BVHLayout::Auto)
+		return layout;
+
+	return CPUFeatures::Get().AVX2 ? BVHLayout::Wide8 : BVHLayout::Wide4;
+}
+
+const char* BVHNode::LayoutName(BVHLayout layout)
+{
+	switch (layout)
+	{
+	case BVHLayout::Auto:   return "Auto";
+	case BVHLayout::Binary: return "Binary";
+	case BVHLayout::Wide4:  return "4-wide";
+	case BVHLayout::Wide8:  return "8-wide";
+	}
+	return "Unknown";
+}
+
+void BVHNode::SetBuildThreadCount(uint32_t threadCount)
+{
+	s_BuildThreadCount = threadCount;
+	s_BuildThreadPool.reset();
+}
+
+ThreadPool* BVHNode::GetBuildThreadPool()
+{
+	uint32_t threadCount = s_BuildThreadCount == 0 ? ThreadPool::HardwareThreads() : s_BuildThreadCount;
+	if (threadCount <= 1)
+		return nullptr;
+
+	// The building thread helps out while it waits, so the pool needs one worker less.
+	if (!s_BuildThreadPool)
+		s_BuildThreadPool = CreateScope<ThreadPool>(threadCount - 1);
+
+	return s_BuildThreadPool.get();
+}
+
+void BVHNode::Build(const std::vector<std::shared_ptr<Hittable>>& objects, size_t start, size_t end, BVHBuildMethod method)
 {
-	// There's a C++ subtlety here. This constructor (without span indices) creates an
-	// implicit copy of the hittable list, which we will modify. The lifetime of the copied
-	// list only extends until this constructor exits. That's OK, because we only need to
-	// persist the resulting bounding volume hierarchy.
+	std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+	std::vector<uint32_t> order = BuildTree(end - start, [&](uint32_t i) { return objects[start + i]->BoundingBox(); }, method);
+
+	m_Primitives.resize(order.size());
+	for (size_t i = 0; i < order.size(); i++)
+		m_Primitives[i] = objects[start + order[i]];
+
+	// Group every leaf's spheres and quads, so each kind is intersected in one batch.
+	for (const LinearBVHNode& node : m_Nodes)
+	{
+		if (node.IsLeaf())
+			PrimitiveArrays::OrderLeaf(m_Primitives, node.Offset, node.PrimitiveCount);
+	}
+	m_Arrays.Build(m_Primitives);
+
+	FinishBuild(buildStart);
 }
 
-BVHNode::BVHNode(std::vector<std::shared_ptr<Hittable>>& objects, size_t start, size_t end)
+std::vector<uint32_t> BVHNode::BuildTree(size_t count, const std::function<AABB(uint32_t)>& bounds, BVHBuildMethod method)
+{
+	m_Method = method;
+	m_Layout = ResolveLayout(s_DefaultLayout);
+	m_Stats.PrimitiveCount = count;
+
+	std::vector<uint32_t> order(count);
+	if (count == 0)
+		return order;
+
+	BuildContext context;
+	context.Method = method;
+	context.Pool = GetBuildThreadPool();
+
+	// Query every bounding box once up front, the builders look at them many times.
+	context.Primitives.resize(count);
+	ParallelFor(context.Pool, 0, count, [&](size_t i)
+		{
+			AABB box = bounds((uint32_t)i);
+			context.Primitives[i] = { box, box.Centroid(), (uint32_t)i };
+		});
+
+	// A binary tree with at least one primitive per leaf never needs more than 2n - 1 nodes.
+	context.Nodes.resize(2 * count - 1);
+	BuildRecursive(context, 0, 0, count, 0);
+
+	// The builders only reorder primitives within their own span, so every leaf ends up
+	// referring to a contiguous range of the final primitive order.
+	for (size_t i = 0; i < count; i++)
+		order[i] = context.Primitives[i].Index;
+
+	m_Nodes.reserve(context.NodeCount);
+	Flatten(context, 0);
+	m_BoundingBox = AABB(m_Nodes[0].Min, m_Nodes[0].Max);
+	return order;
+}
+
+void BVHNode::FinishBuild(std::chrono::steady_clock::time_point buildStart)
+{
+	if (m_Layout == BVHLayout::Wide4 && !m_Nodes.empty())
+		Collapse(m_Wide4Nodes, 0);
+	else if (m_Layout == BVHLayout::Wide8 && !m_Nodes.empty())
+		Collapse(m_Wide8Nodes, 0);
+
+	std::chrono::steady_clock::time_point buildEnd = std::chrono::steady_clock::now();
+	m_Stats.BuildTime = std::chrono::duration<float, std::milli>(buildEnd - buildStart).count();
+	ComputeStats();
+
+	// The wide nodes are self contained, the binary tree was only needed to collapse them.
+	if (m_Layout != BVHLayout::Binary)
+	{
+		m_Nodes.clear();
+		m_Nodes.shrink_to_fit();
+	}
+
+	if (s_BuildLogging)
+	{
+		std::cout << "BVH (" << BuildMethodName(m_Method) << ", " << LayoutName(m_Layout) << "): " << m_Stats.PrimitiveCount << " primitives, "
+			<< m_Stats.NodeCount << " nodes (" << m_Stats.WideNodeCount << " wide), depth " << m_Stats.MaxDepth << ", SAH cost " << m_Stats.SAHCost << ", built in " << m_Stats.BuildTime << "ms\n";
+	}
+}
+
+void BVHNode::BuildRecursive(BuildContext& context, uint32_t nodeIndex, size_t start, size_t end, uint32_t depth)
 {
 	// Build the bounding box of the span of source objects.
-	m_BoundingBox = AABB::Empty;
-	for (size_t objectIndex = start; objectIndex < end; objectIndex++)
-		m_BoundingBox = AABB(m_BoundingBox, objects[objectIndex]->BoundingBox());
+	struct SpanBounds
+	{
+		AABB Bounds, CentroidBounds;
+	};
+
+	SpanBounds spanBounds = ParallelReduce<SpanBounds>(context.Pool, start, end,
+		[&](size_t chunkStart, size_t chunkEnd)
+		{
+			SpanBounds result;
+			for (size_t i = chunkStart; i < chunkEnd; i++)
+			{
+				result.Bounds = AABB(result.Bounds, context.Primitives[i].Bounds);
+				result.CentroidBounds = AABB(result.CentroidBounds, AABB(context.Primitives[i].Centroid, context.Primitives[i].Centroid));
+			}
+			return result;
+		},
+		[](SpanBounds& total, const SpanBounds& chunk)
+		{
+			total.Bounds = AABB(total.Bounds, chunk.Bounds);
+			total.CentroidBounds = AABB(total.CentroidBounds, chunk.CentroidBounds);
+		});
+
+	const AABB& bounds = spanBounds.Bounds;
+	int axis = bounds.LongestAxis();
+	size_t objectSpan = end - start;
+
+	size_t mid = start;
+	if (context.Method == BVHBuildMethod::SAH && depth < s_MaxSAHDepth)
+	{
+		if (objectSpan > 1)
+			mid = SplitSAH(context, start, end, bounds, spanBounds.CentroidBounds, axis);
+		if (mid == start && objectSpan > s_MaxSAHPrimitivesPerLeaf)
+			mid = SplitMedian(context, start, end, axis);
+	}
+	else if (objectSpan > s_MaxPrimitivesPerLeaf)
+	{
+		mid = SplitMedian(context, start, end, axis);
+	}
+
+	BuildNode& node = context.Nodes[nodeIndex];
+	node.Bounds = bounds;
+	node.Axis = (uint8_t)axis;
+
+	if (mid == start)
+	{
+		node.FirstChild = 0;
+		node.Start = (uint32_t)start;
+		node.Count = (uint32_t)objectSpan;
+		return;
+	}
+
+	uint32_t firstChild = context.NodeCount.fetch_add(2, std::memory_order_relaxed);
+	node.FirstChild = firstChild;
+	node.Start = 0;
+	node.Count = 0;
+
+	// Both halves own disjoint ranges of the primitive array, so large ones can be built concurrently.
+	if (context.Pool && objectSpan >= s_ParallelSubtreeThreshold)
+	{
+		ThreadPool::TaskGroup group;
+		context.Pool->Run(group, [&context, firstChild, mid, end, depth]() { BuildRecursive(context, firstChild + 1, mid, end, depth + 1); });
+		BuildRecursive(context, firstChild, start, mid, depth + 1);
+		context.Pool->Wait(group);
+	}
+	else
+	{
+		BuildRecursive(context, firstChild, start, mid, depth + 1);
+		BuildRecursive(context, firstChild + 1, mid, end, depth + 1);
+	}
+}
+
+uint32_t BVHNode::Flatten(const BuildContext& context, uint32_t buildNodeIndex)
+{
+	const BuildNode& buildNode = context.Nodes[buildNodeIndex];
+
+	uint32_t nodeIndex = (uint32_t)m_Nodes.size();
+	m_Nodes.emplace_back();
+
+	LinearBVHNode node = {};
+	node.Min = buildNode.Bounds.min();
+	node.Max = buildNode.Bounds.max();
+	node.Axis = buildNode.Axis;
+
+	if (buildNode.Count > 0)
+	{
+		node.Offset = buildNode.Start;
+		node.PrimitiveCount = (uint16_t)buildNode.Count;
+	}
+	else
+	{
+		// The first child always directly follows its parent, only the second one needs an offset.
+		Flatten(context, buildNode.FirstChild);
+		node.Offset = Flatten(context, buildNode.FirstChild + 1);
+	}
+
+	m_Nodes[nodeIndex] = node;
+	return nodeIndex;
+}
+
+size_t BVHNode::SplitMedian(BuildContext& context, size_t start, size_t end, int axis)
+{
+	// Only the median has to be in place, a full sort of the span is not needed.
+	size_t mid = start + (end - start) / 2;
+	std::nth_element(context.Primitives.begin() + start, context.Primitives.begin() + mid, context.Primitives.begin() + end,
+		[axis](const BuildPrimitive& a, const BuildPrimitive& b)
+		{
+			return a.Bounds.min()[axis] < b.Bounds.min()[axis];
+		});
+
+	return mid;
+}
+
+size_t BVHNode::SplitSAH(BuildContext& context, size_t start, size_t end, const AABB& bounds, const AABB& centroidBounds, int& splitAxis)
+{
+	struct Bin
+	{
+		AABB Bounds;
+		uint32_t Count = 0;
+	};
+
+	struct Bins
+	{
+		Bin Axes[3][s_SAHBinCount];
+	};
+
+	glm::vec3 centroidMin = centroidBounds.min();
+	glm::vec3 scale;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroidBounds.max()[axis] - centroidMin[axis];
+		scale[axis] = extent > 0.0f ? s_SAHBinCount / extent : 0.0f;
+	}
+
+	// Drop every centroid into one of the bins along each axis
+	Bins bins = ParallelReduce<Bins>(context.Pool, start, end,
+		[&](size_t chunkStart, size_t chunkEnd)
+		{
+			Bins result;
+			for (size_t i = chunkStart; i < chunkEnd; i++)
+			{
+				const BuildPrimitive& primitive = context.Primitives[i];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					int binIndex = std::min(s_SAHBinCount - 1, (int)((primitive.Centroid[axis] - centroidMin[axis]) * scale[axis]));
+					result.Axes[axis][binIndex].Count++;
+					result.Axes[axis][binIndex].Bounds = AABB(result.Axes[axis][binIndex].Bounds, primitive.Bounds);
+				}
+			}
+			return result;
+		},
+		[](Bins& total, const Bins& chunk)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				for (int i = 0; i < s_SAHBinCount; i++)
+				{
+					total.Axes[axis][i].Count += chunk.Axes[axis][i].Count;
+					total.Axes[axis][i].Bounds = AABB(total.Axes[axis][i].Bounds, chunk.Axes[axis][i].Bounds);
+				}
+			}
+		});
+
+	const float parentArea = bounds.SurfaceArea();
+	float bestCost = INFINITY;
+	int bestAxis = -1, bestSplit = -1;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (scale[axis] <= 0.0f) continue;
+		const Bin* axisBins = bins.Axes[axis];
+
+		// Sweep from both sides to get the area and count on either side of every bin boundary
+		float leftArea[s_SAHBinCount - 1], rightArea[s_SAHBinCount - 1];
+		uint32_t leftCount[s_SAHBinCount - 1], rightCount[s_SAHBinCount - 1];
+
+		AABB leftBounds, rightBounds;
+		uint32_t leftSum = 0, rightSum = 0;
+		for (int i = 0; i < s_SAHBinCount - 1; i++)
+		{
+			leftBounds = AABB(leftBounds, axisBins[i].Bounds);
+			leftSum += axisBins[i].Count;
+			leftArea[i] = leftBounds.SurfaceArea();
+			leftCount[i] = leftSum;
+
+			rightBounds = AABB(rightBounds, axisBins[s_SAHBinCount - 1 - i].Bounds);
+			rightSum += axisBins[s_SAHBinCount - 1 - i].Count;
+			rightArea[s_SAHBinCount - 2 - i] = rightBounds.SurfaceArea();
+			rightCount[s_SAHBinCount - 2 - i] = rightSum;
+		}
+
+		for (int i = 0; i < s_SAHBinCount - 1; i++)
+		{
+			if (leftCount[i] == 0 || rightCount[i] == 0) continue;
+
+			float cost = s_TraversalCost + s_IntersectionCost * (leftArea[i] * leftCount[i] + rightArea[i] * rightCount[i]) / parentArea;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
 
-	uint32_t axis = m_BoundingBox.LongestAxis();
 	size_t objectSpan = end - start;
+	if (bestAxis < 0)
+		return start;
+	if (objectSpan <= s_MaxSAHPrimitivesPerLeaf && s_IntersectionCost * objectSpan <= bestCost)
+		return start;
+
+	splitAxis = bestAxis;
+	float axisMin = centroidMin[bestAxis];
+	float axisScale = scale[bestAxis];
+	auto midIterator = std::partition(context.Primitives.begin() + start, context.Primitives.begin() + end, [=](const BuildPrimitive& primitive)
+		{
+			int binIndex = std::min(s_SAHBinCount - 1, (int)((primitive.Centroid[bestAxis] - axisMin) * axisScale));
+			return binIndex <= bestSplit;
+		});
+
+	return midIterator - context.Primitives.begin();
+}
+
+void BVHNode::ComputeStats()
+{
+	m_Stats.Method = m_Method;
+	m_Stats.Layout = m_Layout;
+	m_Stats.WideNodeCount = m_Layout == BVHLayout::Wide4 ? m_Wide4Nodes.size() : m_Wide8Nodes.size();
+	m_Stats.NodeCount = m_Nodes.size();
+	m_Stats.LeafCount = 0;
+	m_Stats.MaxDepth = 0;
+	m_Stats.SAHCost = 0.0f;
+
+	if (m_Nodes.empty()) return;
+
+	// Walk the tree once, weighting every node by the chance that a random ray hitting the root also hits it.
+	const float rootArea = std::max(NodeSurfaceArea(m_Nodes[0]), std::numeric_limits<float>::min());
+	std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 1 } };
+	while (!stack.empty())
+	{
+		auto [nodeIndex, depth] = stack.back();
+		stack.pop_back();
+
+		const LinearBVHNode& node = m_Nodes[nodeIndex];
+		float probability = NodeSurfaceArea(node) / rootArea;
+		m_Stats.MaxDepth = std::max(m_Stats.MaxDepth, depth);
 
-	bool(*comparator)(const std::shared_ptr<Hittable>&, const std::shared_ptr<Hittable>&) = 
-		(axis == 0) ? BoxCompareX : (axis == 1) ? BoxCompareY : BoxCompareZ;
+		if (node.IsLeaf())
+		{
+			m_Stats.LeafCount++;
+			m_Stats.SAHCost += probability * s_IntersectionCost * node.PrimitiveCount;
+		}
+		else
+		{
+			m_Stats.SAHCost += probability * s_TraversalCost;
+			stack.push_back({ nodeIndex + 1, depth + 1 });
+			stack.push_back({ node.Offset, depth + 1 });
+		}
+	}
+}
+
+template<uint32_t Width>
+uint32_t BVHNode::Collapse(std::vector<WideBVHNode<Width>>& wideNodes, uint32_t binaryIndex) const
+{
+	uint32_t wideIndex = (uint32_t)wideNodes.size();
+	wideNodes.emplace_back();
 
-	if (objectSpan == 1) 
+	// Keep opening the largest interior child until all slots are used, large boxes are the
+	// ones most rays would otherwise have to descend into anyway.
+	uint32_t children[Width] = { binaryIndex };
+	uint32_t childCount = 1;
+	while (childCount < Width)
 	{
-		m_Left = m_Right = objects[start];
+		int largest = -1;
+		float largestArea = -1.0f;
+		for (uint32_t i = 0; i < childCount; i++)
+		{
+			const LinearBVHNode& child = m_Nodes[children[i]];
+			float area = NodeSurfaceArea(child);
+			if (!child.IsLeaf() && area > largestArea)
+			{
+				largest = (int)i;
+				largestArea = area;
+			}
+		}
+
+		if (largest < 0) break;
+
+		uint32_t opened = children[largest];
+		children[largest] = opened + 1;
+		children[childCount++] = m_Nodes[opened].Offset;
 	}
-	else if (objectSpan == 2) 
+
+	WideBVHNode<Width> node;
+	for (uint32_t i = 0; i < Width; i++)
 	{
-		m_Left = objects[start];
-		m_Right = objects[start + 1];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			node.Bounds[axis][i] = INFINITY;
+			node.Bounds[axis + 3][i] = -INFINITY;
+		}
+		node.Child[i] = 0;
+		node.PrimitiveCount[i] = 0;
 	}
-	else 
+
+	for (uint32_t i = 0; i < childCount; i++)
 	{
-		std::sort(objects.begin() + start, objects.begin() + end, comparator);
+		const LinearBVHNode& child = m_Nodes[children[i]];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			node.Bounds[axis][i] = child.Min[axis];
+			node.Bounds[axis + 3][i] = child.Max[axis];
+		}
 
-		size_t mid = start + objectSpan / 2;
-		m_Left = std::make_shared<BVHNode>(objects, start, mid);
-		m_Right = std::make_shared<BVHNode>(objects, mid, end);
+		node.PrimitiveCount[i] = child.PrimitiveCount;
+		node.Child[i] = child.IsLeaf() ? child.Offset : Collapse(wideNodes, children[i]);
 	}
+
+	// The recursion may have grown the vector, so the node is only written at the end.
+	wideNodes[wideIndex] = node;
+	return wideIndex;
+}
+
+void BVHNode::CollectLights(std::vector<Ref<Hittable>>& lights) const
+{
+	for (const std::shared_ptr<Hittable>& primitive : m_Primitives)
+	{
+		if (primitive->IsLight())
+			lights.push_back(primitive);
+		else
+			primitive->CollectLights(lights);
+	}
+}
+
+void BVHNode::CollectMemory(SceneMemory& memory) const
+{
+	size_t bytes = sizeof(*this) + m_Nodes.capacity() * sizeof(LinearBVHNode) + m_Wide4Nodes.capacity() * sizeof(WideBVHNode<4>)
+		+ m_Wide8Nodes.capacity() * sizeof(WideBVHNode<8>) + m_Primitives.capacity() * sizeof(Ref<Hittable>) + m_Arrays.MemoryUsage();
+	if (!memory.Add(this, bytes))
+		return;
+
+	for (const std::shared_ptr<Hittable>& primitive : m_Primitives)
+		primitive->CollectMemory(memory);
 }
 
 bool BVHNode::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
 {
-	if (!m_BoundingBox.Hit(ray, rayInterval))
+	switch (m_Layout)
+	{
+	case BVHLayout::Wide4:
+		if (m_Wide4Nodes.empty()) return false;
+	#if RT_SIMD_X86
+		return TraverseWide(m_Wide4Nodes, m_Arrays, ray, rayInterval, record, SSEIntersector(ray));
+	#else
+		return TraverseWide(m_Wide4Nodes, m_Arrays, ray, rayInterval, record, ScalarIntersector<4>(ray));
+	#endif
+	case BVHLayout::Wide8:
+		if (m_Wide8Nodes.empty()) return false;
+	#if RT_SIMD_X86
+		if (CPUFeatures::Get().AVX2)
+			return HitAVX2(m_Wide8Nodes, m_Arrays, ray, rayInterval, record);
+	#endif
+		return TraverseWide(m_Wide8Nodes, m_Arrays, ray, rayInterval, record, ScalarIntersector<8>(ray));
+	default:
+		return HitBinary(ray, rayInterval, record);
+	}
+}
+
+RayMask BVHNode::HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const
+{
+	switch (m_Layout)
+	{
+	case BVHLayout::Wide4:
+		if (m_Wide4Nodes.empty()) return 0;
+	#if RT_SIMD_X86
+		return HitPacketWide<4, SSEIntersector>(m_Wide4Nodes, m_Arrays, packet, tMin, closest, records);
+	#else
+		return HitPacketWide<4, ScalarIntersector<4>>(m_Wide4Nodes, m_Arrays, packet, tMin, closest, records);
+	#endif
+	case BVHLayout::Wide8:
+		if (m_Wide8Nodes.empty()) return 0;
+	#if RT_SIMD_X86
+		if (CPUFeatures::Get().AVX2)
+			return HitPacketAVX2(m_Wide8Nodes, m_Arrays, packet, tMin, closest, records);
+	#endif
+		return HitPacketWide<8, ScalarIntersector<8>>(m_Wide8Nodes, m_Arrays, packet, tMin, closest, records);
+	default:
+		// The binary layout has no packet traversal of its own
+		return Hittable::HitPacket(packet, tMin, closest, records);
+	}
+}
+
+bool BVHNode::HitBinary(const Ray& ray, Interval rayInterval, HitRecord& record) const
+{
+	if (m_Nodes.empty())
 		return false;
 
-	bool hitLeft = m_Left->Hit(ray, rayInterval, record);
-	bool hitRight = m_Right->Hit(ray, Interval(rayInterval.min(), hitLeft ? record.Intersection : rayInterval.max()), record);
+	const glm::vec3 origin = ray.Origin();
+	const glm::vec3& invDirection = ray.InverseDirection();
+	const bool directionIsNegative[3] = { invDirection.x < 0.0f, invDirection.y < 0.0f, invDirection.z < 0.0f };
+
+	uint32_t stack[s_MaxDepth];
+	uint32_t stackSize = 0;
+	uint32_t current = 0;
+	bool hitAnything = false;
+
+	while (true)
+	{
+		const LinearBVHNode& node = m_Nodes[current];
+		RT_COUNT(NodesVisited);
+
+		if (HitNodeBounds(node, origin, invDirection, rayInterval))
+		{
+			if (node.IsLeaf())
+			{
+				if (m_Arrays.Hit(node.Offset, node.PrimitiveCount, ray, rayInterval, record))
+				{
+					hitAnything = true;
+					rayInterval.max(record.Intersection);
+				}
+			}
+			else
+			{
+				// Visit the child on the near side of the split first, so later boxes get culled
+				// against an already shortened ray.
+				if (directionIsNegative[node.Axis])
+				{
+					stack[stackSize++] = current + 1;
+					current = node.Offset;
+				}
+				else
+				{
+					stack[stackSize++] = node.Offset;
+					current = current + 1;
+				}
+				continue;
+			}
+		}
 
-	return hitLeft || hitRight;
+		if (stackSize == 0) break;
+		current = stack[--stackSize];
+	}
+
+	return hitAnything;
+}
+
+bool BVHNode::Occluded(const Ray& ray, Interval rayInterval) const
+{
+	switch (m_Layout)
+	{
+	case BVHLayout::Wide4:
+		if (m_Wide4Nodes.empty()) return false;
+	#if RT_SIMD_X86
+		return OccludedWide(m_Wide4Nodes, m_Arrays, ray, rayInterval, SSEIntersector(ray));
+	#else
+		return OccludedWide(m_Wide4Nodes, m_Arrays, ray, rayInterval, ScalarIntersector<4>(ray));
+	#endif
+	case BVHLayout::Wide8:
+		if (m_Wide8Nodes.empty()) return false;
+	#if RT_SIMD_X86
+		if (CPUFeatures::Get().AVX2)
+			return OccludedAVX2(m_Wide8Nodes, m_Arrays, ray, rayInterval);
+	#endif
+		return OccludedWide(m_Wide8Nodes, m_Arrays, ray, rayInterval, ScalarIntersector<8>(ray));
+	default:
+		return OccludedBinary(ray, rayInterval);
+	}
 }
 
-bool BVHNode::BoxCompare(const std::shared_ptr<Hittable>& a, const std::shared_ptr<Hittable>& b, int axisIndex)
+bool BVHNode::OccludedBinary(const Ray& ray, Interval rayInterval) const
 {
-	return a->BoundingBox().min()[axisIndex] < b->BoundingBox().min()[axisIndex];
+	if (m_Nodes.empty())
+		return false;
+
+	const glm::vec3 origin = ray.Origin();
+	const glm::vec3& invDirection = ray.InverseDirection();
+
+	uint32_t stack[s_MaxDepth];
+	uint32_t stackSize = 0;
+	uint32_t current = 0;
+
+	while (true)
+	{
+		const LinearBVHNode& node = m_Nodes[current];
+		RT_COUNT(NodesVisited);
+
+		if (HitNodeBounds(node, origin, invDirection, rayInterval))
+		{
+			if (node.IsLeaf())
+			{
+				if (m_Arrays.Occluded(node.Offset, node.PrimitiveCount, ray, rayInterval))
+					return true;
+			}
+			else
+			{
+				stack[stackSize++] = node.Offset;
+				current = current + 1;
+				continue;
+			}
+		}
+
+		if (stackSize == 0) break;
+		current = stack[--stackSize];
+	}
+
+	return false;
 }
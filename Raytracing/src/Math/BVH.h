@@ -1,26 +1,183 @@
 #pragma once
 
+#include <chrono>
+
+#include "Core/CPUFeatures.h"
+#include "Core/ThreadPool.h"
+
 #include "Math/AABB.h"
 #include "Objects/Hittable.h"
 #include "Objects/HittableList.h"
+#include "Objects/PrimitiveArrays.h"
+
+struct MeshData;
+
+// One node of the flattened hierarchy. Interior nodes store their first child directly after
+// themselves and the index of the second child in Offset, leaves store the range of their
+// primitives, so the whole tree lives in one contiguous array without any pointers.
+struct alignas(32) LinearBVHNode
+{
+	glm::vec3 Min;
+	uint32_t Offset;          // Leaf: first primitive, interior: second child
+	glm::vec3 Max;
+	uint16_t PrimitiveCount;  // 0 for interior nodes
+	uint8_t Axis;             // Split axis, used to visit the nearer child first
+	uint8_t Padding;
+
+	bool IsLeaf() const { return PrimitiveCount > 0; }
+};
+
+static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode should fill exactly one 32 byte slot");
+
+// Collapsed node of a 4 or 8 wide hierarchy. The bounds of all children are stored per
+// coordinate (SoA), so one traversal step can slab test every child with a single SIMD
+// instruction per plane. Unused slots carry inverted bounds that no ray can hit.
+template<uint32_t Width>
+struct alignas(Width * sizeof(float)) WideBVHNode
+{
+	float Bounds[6][Width];           // MinX, MinY, MinZ, MaxX, MaxY, MaxZ
+	uint32_t Child[Width];            // Leaf: first primitive, interior: index of the child node
+	uint16_t PrimitiveCount[Width];   // 0 for interior children and unused slots
+};
+
+enum class BVHLayout
+{
+	Auto,     // Widest layout the running CPU has a SIMD path for
+	Binary,   // Two children per node, scalar traversal
+	Wide4,    // Four children per node, SSE traversal
+	Wide8     // Eight children per node, AVX2 traversal
+};
+
+enum class BVHBuildMethod
+{
+	Median,   // Sort along the longest axis and split the span in half
+	SAH       // Binned surface area heuristic
+};
+
+struct BVHBuildStats
+{
+	BVHBuildMethod Method = BVHBuildMethod::Median;
+	BVHLayout Layout = BVHLayout::Binary;
+	size_t PrimitiveCount = 0;
+	size_t NodeCount = 0;       // Binary nodes, before collapsing into a wide layout
+	size_t WideNodeCount = 0;
+	size_t LeafCount = 0;
+	uint32_t MaxDepth = 0;
+	float BuildTime = 0.0f;   // Milliseconds
+	float SAHCost = 0.0f;     // Expected cost of a random ray, relative to one primitive test
+};
 
 class BVHNode : public Hittable {
 public:
-	BVHNode(HittableList list);
-	BVHNode(std::vector<std::shared_ptr<Hittable>>& objects, size_t start, size_t end);
+	BVHNode(const HittableList& list, BVHBuildMethod method = s_DefaultBuildMethod);
+	BVHNode(const std::vector<std::shared_ptr<Hittable>>& objects, size_t start, size_t end, BVHBuildMethod method = s_DefaultBuildMethod);
+	// Hierarchy over the triangles of a mesh, without an object per triangle. Reorders the
+	// mesh's triangles so every leaf refers to a contiguous range of them.
+	BVHNode(MeshData& mesh, const Material::Blank* material, BVHBuildMethod method = s_DefaultBuildMethod);
 
 	bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const override;
+	bool Occluded(const Ray& ray, Interval rayInterval) const override;
+	RayMask HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const override;
+	void CollectLights(std::vector<Ref<Hittable>>& lights) const override;
+	void CollectMemory(SceneMemory& memory) const override;
 
 	AABB BoundingBox() const override { return m_BoundingBox; }
 
+	size_t NodeCount() const { return m_Stats.NodeCount; }
+	const BVHBuildStats& GetBuildStats() const { return m_Stats; }
+
+	// Builder used by every BVHNode that does not ask for one explicitly.
+	static void SetDefaultBuildMethod(BVHBuildMethod method) { s_DefaultBuildMethod = method; }
+	static BVHBuildMethod GetDefaultBuildMethod() { return s_DefaultBuildMethod; }
+	static const char* BuildMethodName(BVHBuildMethod method);
+
+	// Node layout of every BVHNode built after the call. Auto picks 8 wide nodes when the CPU
+	// supports AVX2 and 4 wide nodes otherwise.
+	static void SetDefaultLayout(BVHLayout layout) { s_DefaultLayout = layout; }
+	static BVHLayout GetDefaultLayout() { return s_DefaultLayout; }
+	static BVHLayout ResolveLayout(BVHLayout layout);
+	static const char* LayoutName(BVHLayout layout);
+
+	// Threads used to build large hierarchies, 0 uses every hardware thread and 1 builds serially.
+	static void SetBuildThreadCount(uint32_t threadCount);
+	static void SetBuildLogging(bool enabled) { s_BuildLogging = enabled; }
+
 private:
-	static bool BoxCompare(const std::shared_ptr<Hittable>& a, const std::shared_ptr<Hittable>& b, int axisIndex);
-	static bool BoxCompareX(const std::shared_ptr<Hittable>& a, const std::shared_ptr<Hittable>& b) { return BoxCompare(a, b, 0); }
-	static bool BoxCompareY(const std::shared_ptr<Hittable>& a, const std::shared_ptr<Hittable>& b) { return BoxCompare(a, b, 1); }
-	static bool BoxCompareZ(const std::shared_ptr<Hittable>& a, const std::shared_ptr<Hittable>& b) { return BoxCompare(a, b, 2); }
+	struct BuildPrimitive
+	{
+		AABB Bounds;
+		glm::vec3 Centroid;
+		uint32_t Index;
+	};
+
+	// Intermediate node of the parallel build. Tasks allocate the two children of a node as
+	// one pair, the tree is only flattened into depth first order once every task has finished.
+	struct BuildNode
+	{
+		AABB Bounds;
+		uint32_t FirstChild;
+		uint32_t Start, Count;  // Primitive range of a leaf, Count is 0 for interior nodes
+		uint8_t Axis;
+	};
+
+	struct BuildContext
+	{
+		std::vector<BuildPrimitive> Primitives;
+		std::vector<BuildNode> Nodes;
+		std::atomic<uint32_t> NodeCount = 1;
+		BVHBuildMethod Method;
+		ThreadPool* Pool;
+	};
+
+	void Build(const std::vector<std::shared_ptr<Hittable>>& objects, size_t start, size_t end, BVHBuildMethod method);
+	// Builds the binary tree over count primitives and returns their order, leaves refer to ranges of it
+	std::vector<uint32_t> BuildTree(size_t count, const std::function<AABB(uint32_t)>& bounds, BVHBuildMethod method);
+	// Collapses the tree into the wide layout and reports the build started at buildStart
+	void FinishBuild(std::chrono::steady_clock::time_point buildStart);
+	static void BuildRecursive(BuildContext& context, uint32_t nodeIndex, size_t start, size_t end, uint32_t depth);
+	uint32_t Flatten(const BuildContext& context, uint32_t buildNodeIndex);
+
+	static size_t SplitMedian(BuildContext& context, size_t start, size_t end, int axis);
+	// Returns the index the span was partitioned at and sets splitAxis, or returns start when a leaf is cheaper than any split.
+	static size_t SplitSAH(BuildContext& context, size_t start, size_t end, const AABB& bounds, const AABB& centroidBounds, int& splitAxis);
+
+	void ComputeStats();
+
+	// Collapses the binary subtree below binaryIndex into wide nodes, returns the index of its root.
+	template<uint32_t Width>
+	uint32_t Collapse(std::vector<WideBVHNode<Width>>& wideNodes, uint32_t binaryIndex) const;
+
+	bool HitBinary(const Ray& ray, Interval rayInterval, HitRecord& record) const;
+	bool OccludedBinary(const Ray& ray, Interval rayInterval) const;
+
+	static ThreadPool* GetBuildThreadPool();
 
 private:
-	std::shared_ptr<Hittable> m_Left;
-	std::shared_ptr<Hittable> m_Right;
+	static constexpr size_t s_MaxPrimitivesPerLeaf = 2;
+	static constexpr size_t s_MaxSAHPrimitivesPerLeaf = 4;
+	static constexpr size_t s_MaxDepth = 64;
+	// Past this depth SAH gives way to median splits, which bound the remaining depth by log2(n).
+	static constexpr uint32_t s_MaxSAHDepth = 40;
+	static constexpr int s_SAHBinCount = 16;
+	static constexpr float s_TraversalCost = 1.0f;
+	static constexpr float s_IntersectionCost = 1.0f;
+	// Spans smaller than these are not worth handing to another thread.
+	static constexpr size_t s_ParallelSubtreeThreshold = 4096;
+
+	static inline BVHBuildMethod s_DefaultBuildMethod = BVHBuildMethod::SAH;
+	static inline BVHLayout s_DefaultLayout = BVHLayout::Auto;
+	static inline uint32_t s_BuildThreadCount = 0;
+	static inline Scope<ThreadPool> s_BuildThreadPool;
+	static inline bool s_BuildLogging = true;
+
+	std::vector<LinearBVHNode> m_Nodes;         // Only kept for the binary layout
+	std::vector<WideBVHNode<4>> m_Wide4Nodes;
+	std::vector<WideBVHNode<8>> m_Wide8Nodes;
+	std::vector<std::shared_ptr<Hittable>> m_Primitives;   // Empty for the hierarchy of a mesh
+	PrimitiveArrays m_Arrays;    // What the leaves intersect, in the order of m_Primitives or the mesh's triangles
 	AABB m_BoundingBox;
-};
\ No newline at end of file
+
+	BVHBuildMethod m_Method;
+	BVHLayout m_Layout = BVHLayout::Binary;
+	BVHBuildStats m_Stats;
+};
@@ -1,22 +1,72 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <Walnut/Random.h>
 
 #define PI 3.1415926535897932385f
 
-class MathUtil 
+// The Sample* functions warp uniform numbers from a Sampler onto a domain. They are
+// bijective, so well distributed inputs stay well distributed on the domain.
+class MathUtil
 {
 public:
-    static glm::vec3 SampleSquare() 
+    // Offset in [-0.5, 0.5)^2 around a pixel center
+    static glm::vec3 SampleSquare(const glm::vec2& u)
     {
-        return glm::vec3(Walnut::Random::Float() - 0.5f, Walnut::Random::Float() - 0.5f, 0.0f);
+        return glm::vec3(u.x - 0.5f, u.y - 0.5f, 0.0f);
     }
 
-    static glm::vec3 SampleDisk(float radius) 
+    // Concentric mapping (Shirley and Chiu) onto the unit disk
+    static glm::vec2 SampleDisk(const glm::vec2& u)
     {
-        glm::vec2 p = radius * Walnut::Random::InUnitDisk();
-        return glm::vec3(p.x, p.y, 0.0f);
+        glm::vec2 offset = 2.0f * u - glm::vec2(1.0f);
+        if (offset.x == 0.0f && offset.y == 0.0f)
+            return glm::vec2(0.0f);
+
+        float radius, theta;
+        if (std::abs(offset.x) > std::abs(offset.y))
+        {
+            radius = offset.x;
+            theta = 0.25f * PI * (offset.y / offset.x);
+        }
+        else
+        {
+            radius = offset.y;
+            theta = 0.5f * PI - 0.25f * PI * (offset.x / offset.y);
+        }
+
+        return radius * glm::vec2(std::cos(theta), std::sin(theta));
+    }
+
+    // Uniform direction on the unit sphere
+    static glm::vec3 SampleSphere(const glm::vec2& u)
+    {
+        float z = 1.0f - 2.0f * u.x;
+        float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        float phi = 2.0f * PI * u.y;
+        return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+    }
+
+    // Uniform point inside the unit ball
+    static glm::vec3 SampleBall(const glm::vec2& u, float w)
+    {
+        return std::cbrt(w) * SampleSphere(u);
+    }
+
+    // Two unit vectors completing n to a right handed orthonormal basis (Duff et al.)
+    static void OrthonormalBasis(const glm::vec3& n, glm::vec3& t, glm::vec3& b)
+    {
+        float sign = std::copysign(1.0f, n.z);
+        float a = -1.0f / (sign + n.z);
+        float c = n.x * n.y * a;
+        t = glm::vec3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+        b = glm::vec3(c, sign + n.y * n.y * a, -n.y);
+    }
+
+    // Multiple importance sampling weight of a sample drawn with pdfA that strategy B could have drawn with pdfB
+    static float PowerHeuristic(float pdfA, float pdfB)
+    {
+        float a = pdfA * pdfA, b = pdfB * pdfB;
+        return a + b > 0.0f ? a / (a + b) : 0.0f;
     }
 
     static float DegreeToRadians(float degrees) 
@@ -2,20 +2,22 @@
 #include "Math/Perlin.h"
 
 #include "Math/MathUtil.h"
-#include "Walnut/Random.h"
+#include "Math/Random.h"
 
 #define POINT_COUNT 256
 
-Perlin::Perlin()
+Perlin::Perlin(uint32_t seed)
 {
+	RandomStream random(seed);
+
 	m_RandVec = new glm::vec3[POINT_COUNT];
 	for (int i = 0; i < POINT_COUNT; i++) {
-		m_RandVec[i] = glm::normalize(Walnut::Random::Vec3());
+		m_RandVec[i] = glm::normalize(random.Vec3());
 	}
 
-	m_PermutationX = PerlinGeneratePermutation();
-	m_PermutationY = PerlinGeneratePermutation();
-	m_PermutationZ = PerlinGeneratePermutation();
+	m_PermutationX = PerlinGeneratePermutation(random);
+	m_PermutationY = PerlinGeneratePermutation(random);
+	m_PermutationZ = PerlinGeneratePermutation(random);
 }
 
 Perlin::~Perlin()
@@ -71,20 +73,20 @@ float Perlin::Turbulence(const glm::vec3& point, int depth) const
 	return std::fabs(accumulation);
 }
 
-int* Perlin::PerlinGeneratePermutation()
+int* Perlin::PerlinGeneratePermutation(RandomStream& random)
 {
 	int* permutation = new int[POINT_COUNT];
 	for (int i = 0; i < POINT_COUNT; i++)
 		permutation[i] = i;
 
-	Permute(permutation, POINT_COUNT);
+	Permute(permutation, POINT_COUNT, random);
 	return permutation;
 }
 
-void Perlin::Permute(int* permutation, int n)
+void Perlin::Permute(int* permutation, int n, RandomStream& random)
 {
 	for (int i = n - 1; i > 0; i--) {
-		int target = Walnut::Random::UInt(0, i);
+		int target = random.UInt(0, i);
 		int tmp = permutation[i];
 		permutation[i] = permutation[target];
 		permutation[target] = tmp;
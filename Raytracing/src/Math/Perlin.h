@@ -2,17 +2,19 @@
 
 #include <glm/glm.hpp>
 
+class RandomStream;
+
 class Perlin {
 public:
-	Perlin();
+	Perlin(uint32_t seed = 0);
 	~Perlin();
 
 	float Noise(const glm::vec3& point) const;
 	float Turbulence(const glm::vec3& point, int depth) const;
 
 private:
-	static int* PerlinGeneratePermutation();
-	static void Permute(int* perm, int n);
+	static int* PerlinGeneratePermutation(RandomStream& random);
+	static void Permute(int* perm, int n, RandomStream& random);
 
 private:
 	glm::vec3* m_RandVec;
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+// Counter based random numbers. Every value is a pure function of a key and a counter, so
+// results never depend on which thread asks for them or in which order, and no generator
+// state has to be shared or reseeded.
+class Random
+{
+public:
+	// PCG4D (Jarzynski and Olano, "Hash Functions for GPU Rendering"), every output word
+	// depends on all four input words.
+	static void Hash(uint32_t v[4])
+	{
+		for (int i = 0; i < 4; i++)
+			v[i] = v[i] * 1664525u + 1013904223u;
+
+		v[0] += v[1] * v[3]; v[1] += v[2] * v[0]; v[2] += v[0] * v[1]; v[3] += v[1] * v[2];
+		for (int i = 0; i < 4; i++)
+			v[i] ^= v[i] >> 16u;
+		v[0] += v[1] * v[3]; v[1] += v[2] * v[0]; v[2] += v[0] * v[1]; v[3] += v[1] * v[2];
+	}
+
+	static uint32_t Hash(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+	{
+		uint32_t v[4] = { a, b, c, d };
+		Hash(v);
+		return v[0];
+	}
+
+	// Uniform in [0, 1)
+	static float ToFloat(uint32_t value)
+	{
+		return (float)(value >> 8) * (1.0f / 16777216.0f);
+	}
+
+	static uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+};
+
+// Sequential random values for scene setup. The n-th value of a stream is the hash of its
+// seed and n, so a scene generated twice with the same seed is identical.
+class RandomStream
+{
+public:
+	explicit RandomStream(uint32_t seed)
+		: m_Seed(seed)
+	{}
+
+	uint32_t UInt()
+	{
+		return Random::Hash(m_Seed, m_Counter++, 0x5eed5eedu, 0u);
+	}
+
+	// Uniform in [min, max]
+	uint32_t UInt(uint32_t min, uint32_t max)
+	{
+		return min + (uint32_t)(((uint64_t)UInt() * ((uint64_t)max - min + 1)) >> 32);
+	}
+
+	// Uniform in [0, 1)
+	float Float()
+	{
+		return Random::ToFloat(UInt());
+	}
+
+	float Float(float min, float max)
+	{
+		return min + (max - min) * Float();
+	}
+
+	glm::vec3 Vec3()
+	{
+		float x = Float(), y = Float();
+		return glm::vec3(x, y, Float());
+	}
+
+	glm::vec3 Vec3(float min, float max)
+	{
+		float x = Float(min, max), y = Float(min, max);
+		return glm::vec3(x, y, Float(min, max));
+	}
+
+private:
+	uint32_t m_Seed;
+	uint32_t m_Counter = 0;
+};
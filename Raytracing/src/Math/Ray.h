@@ -8,21 +8,24 @@ public:
 	Ray() = default;
 
 	Ray(const glm::vec3& origin, const glm::vec3& direction)
-		: m_Origin(origin), m_Direction(direction), m_Time(0.0f)
+		: m_Origin(origin), m_Direction(direction), m_InverseDirection(1.0f / direction), m_Time(0.0f)
 	{}
 
 	Ray(const glm::vec3& origin, const glm::vec3& direction, float time)
-		: m_Origin(origin), m_Direction(direction), m_Time(time)
+		: m_Origin(origin), m_Direction(direction), m_InverseDirection(1.0f / direction), m_Time(time)
 	{}
 
 	glm::vec3 At(float t) const { return m_Origin + t * m_Direction; }
 
 	const glm::vec3& Direction() const { return m_Direction; }
 	const glm::vec3& Origin() const { return m_Origin; }
+	// Computed once per ray for the slab tests of every bounding box along its way
+	const glm::vec3& InverseDirection() const { return m_InverseDirection; }
 	float time() const { return m_Time; }
 
 private:
 	glm::vec3 m_Origin;
 	glm::vec3 m_Direction;
+	glm::vec3 m_InverseDirection;
 	float m_Time;
 };
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "rtpch.h"
+#include "Math/RayPacket.h"
+
+void RayPacket::ComputeBounds()
+{
+	OriginMin = InverseMin = glm::vec3(INFINITY);
+	OriginMax = InverseMax = glm::vec3(-INFINITY);
+	uint32_t octant = Size > 0 ? Octant(Rays[0].Direction()) : 0;
+	SameOctant = Size > 0 && octant < 8;
+
+	for (uint32_t i = 0; i < Size; i++)
+	{
+		OriginMin = glm::min(OriginMin, Rays[i].Origin());
+		OriginMax = glm::max(OriginMax, Rays[i].Origin());
+		InverseMin = glm::min(InverseMin, Rays[i].InverseDirection());
+		InverseMax = glm::max(InverseMax, Rays[i].InverseDirection());
+		SameOctant = SameOctant && Octant(Rays[i].Direction()) == octant;
+	}
+}
+
+uint32_t RayPacket::Octant(const glm::vec3& direction)
+{
+	if (direction.x == 0.0f || direction.y == 0.0f || direction.z == 0.0f)
+		return 8;
+	return (direction.x < 0.0f ? 1 : 0) | (direction.y < 0.0f ? 2 : 0) | (direction.z < 0.0f ? 4 : 0);
+}
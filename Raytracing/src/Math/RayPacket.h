@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Math/Ray.h"
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+// Bit k stands for ray k of a packet
+using RayMask = uint64_t;
+
+// Index of the lowest ray in a mask, which must not be empty
+inline uint32_t LowestRay(RayMask mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return (uint32_t)index;
+#else
+	return (uint32_t)__builtin_ctzll(mask);
+#endif
+}
+
+// Number of rays in a mask
+inline uint32_t CountRays(RayMask mask)
+{
+#ifdef _MSC_VER
+	return (uint32_t)__popcnt64(mask);
+#else
+	return (uint32_t)__builtin_popcountll(mask);
+#endif
+}
+
+// Up to 64 rays traced through a hierarchy together, so each node is fetched once for the whole
+// packet instead of once per ray.
+struct RayPacket
+{
+	static constexpr uint32_t MaxSize = 64;
+
+	Ray Rays[MaxSize];
+	uint32_t Size = 0;
+
+	// Bounds over every ray of the packet, set by ComputeBounds. Interval arithmetic on them bounds
+	// the slab distances of all rays at once, which is only valid while every direction has the
+	// same nonzero signs; SameOctant tells if they do.
+	glm::vec3 OriginMin, OriginMax;
+	glm::vec3 InverseMin, InverseMax;
+	bool SameOctant = false;
+
+	void Add(const Ray& ray) { Rays[Size++] = ray; }
+	void ComputeBounds();
+
+	// One bit per negative component, directions with a zero component are assigned to octant 8
+	static uint32_t Octant(const glm::vec3& direction);
+	static constexpr uint32_t OctantCount = 9;
+};
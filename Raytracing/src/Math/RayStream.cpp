@@ -0,0 +1,49 @@
+#include "rtpch.h"
+#include "Math/RayStream.h"
+
+#include <vector>
+
+void RayStream::Trace(const Hittable& world, const Ray* rays, uint32_t count, float tMin, HitRecord* records, bool* hits)
+{
+	// Counting sort of the ray indices by octant, kept per thread so streams allocate nothing once warm
+	static thread_local std::vector<uint32_t> order;
+	order.resize(count);
+
+	uint32_t octantStart[RayPacket::OctantCount + 1] = {};
+	for (uint32_t i = 0; i < count; i++)
+		octantStart[RayPacket::Octant(rays[i].Direction()) + 1]++;
+	for (uint32_t octant = 0; octant < RayPacket::OctantCount; octant++)
+		octantStart[octant + 1] += octantStart[octant];
+
+	uint32_t next[RayPacket::OctantCount];
+	std::copy(octantStart, octantStart + RayPacket::OctantCount, next);
+	for (uint32_t i = 0; i < count; i++)
+		order[next[RayPacket::Octant(rays[i].Direction())]++] = i;
+
+	RayPacket packet;
+	float closest[RayPacket::MaxSize];
+	HitRecord packetRecords[RayPacket::MaxSize];
+	for (uint32_t octant = 0; octant < RayPacket::OctantCount; octant++)
+	{
+		for (uint32_t start = octantStart[octant]; start < octantStart[octant + 1]; start += RayPacket::MaxSize)
+		{
+			uint32_t size = std::min(octantStart[octant + 1] - start, RayPacket::MaxSize);
+			packet.Size = 0;
+			for (uint32_t k = 0; k < size; k++)
+			{
+				packet.Add(rays[order[start + k]]);
+				closest[k] = INFINITY;
+			}
+			packet.ComputeBounds();
+
+			RayMask hitMask = world.HitPacket(packet, tMin, closest, packetRecords);
+			for (uint32_t k = 0; k < size; k++)
+			{
+				uint32_t index = order[start + k];
+				hits[index] = (hitMask >> k) & 1;
+				if (hits[index])
+					records[index] = packetRecords[k];
+			}
+		}
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Math/RayPacket.h"
+#include "Objects/Hittable.h"
+
+// Traces a batch of independent rays in packets. The rays are sorted by the octant of their
+// direction first, so the rays of a packet tend to visit the same nodes and the packet's
+// interval culling stays valid. Within an octant the rays keep their order, callers that
+// know which rays are coherent (neighbouring pixels) should pass them next to each other.
+class RayStream
+{
+public:
+	// Closest hit of every ray within (tMin, infinity): hits[i] tells if rays[i] hit anything,
+	// records[i] is only filled in if it did.
+	static void Trace(const Hittable& world, const Ray* rays, uint32_t count, float tMin, HitRecord* records, bool* hits);
+};
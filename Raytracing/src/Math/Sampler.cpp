@@ -0,0 +1,279 @@
+#include "rtpch.h"
+#include "Math/Sampler.h"
+
+#include <cctype>
+#include <cmath>
+
+namespace {
+
+	uint32_t ReverseBits(uint32_t x)
+	{
+		x = (x << 16) | (x >> 16);
+		x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+		x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+		x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+		x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+		return x;
+	}
+
+	// Every bit only depends on itself and the bits below it
+	uint32_t LaineKarrasPermutation(uint32_t x, uint32_t seed)
+	{
+		x ^= x * 0x3d20adeau;
+		x += seed;
+		x *= (seed >> 16) | 1u;
+		x ^= x * 0x05526c56u;
+		x ^= x * 0x53a22864u;
+		return x;
+	}
+
+	// Owen scrambling: every bit is flipped depending on the bits above it, so aligned
+	// power of two blocks of values stay aligned blocks
+	uint32_t NestedUniformScramble(uint32_t x, uint32_t seed)
+	{
+		return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+	}
+
+	// Bit reversed second Sobol dimension, the first one is the bit reversed index itself. The
+	// generator matrix is applied a byte at a time through tables of XORed direction numbers.
+	struct SobolTables
+	{
+		uint32_t Bytes[4][256];
+
+		SobolTables()
+		{
+			uint32_t directions[32];
+			directions[0] = 1u << 31;
+			for (int i = 1; i < 32; i++)
+				directions[i] = directions[i - 1] ^ (directions[i - 1] >> 1);
+
+			for (int byte = 0; byte < 4; byte++)
+			{
+				for (uint32_t value = 0; value < 256; value++)
+				{
+					uint32_t result = 0;
+					for (int bit = 0; bit < 8; bit++)
+					{
+						if (value & (1u << bit))
+							result ^= directions[byte * 8 + bit];
+					}
+					Bytes[byte][value] = ReverseBits(result);
+				}
+			}
+		}
+	};
+
+	uint32_t ReversedSobolSecondDimension(uint32_t index)
+	{
+		static const SobolTables tables;
+		return tables.Bytes[0][index & 0xff] ^ tables.Bytes[1][(index >> 8) & 0xff]
+			^ tables.Bytes[2][(index >> 16) & 0xff] ^ tables.Bytes[3][index >> 24];
+	}
+
+	// Element i of a pseudo random permutation of [0, length) (Kensler, "Correlated Multi-Jittered Sampling")
+	uint32_t Permute(uint32_t i, uint32_t length, uint32_t p)
+	{
+		uint32_t w = length - 1;
+		w |= w >> 1; w |= w >> 2; w |= w >> 4; w |= w >> 8; w |= w >> 16;
+		do
+		{
+			i ^= p; i *= 0xe170893du; i ^= p >> 16; i ^= (i & w) >> 4;
+			i ^= p >> 8; i *= 0x0929eb3fu; i ^= p >> 23; i ^= (i & w) >> 1;
+			i *= 1u | p >> 27; i *= 0x6935fa69u; i ^= (i & w) >> 11; i *= 0x74dcb303u;
+			i ^= (i & w) >> 2; i *= 0x9e501cc3u; i ^= (i & w) >> 2; i *= 0xc860a3dfu;
+			i &= w; i ^= i >> 5;
+		} while (i >= length);
+		return (i + p) % length;
+	}
+
+	uint32_t SpreadBits(uint32_t x)
+	{
+		x &= 0x0000ffffu;
+		x = (x | (x << 8)) & 0x00ff00ffu;
+		x = (x | (x << 4)) & 0x0f0f0f0fu;
+		x = (x | (x << 2)) & 0x33333333u;
+		x = (x | (x << 1)) & 0x55555555u;
+		return x;
+	}
+
+	uint32_t MortonCode(uint32_t x, uint32_t y)
+	{
+		return SpreadBits(x) | (SpreadBits(y) << 1);
+	}
+
+	uint32_t CeilLog2(uint32_t value)
+	{
+		uint32_t bits = 0;
+		while (bits < 32 && (1ull << bits) < value)
+			bits++;
+		return bits;
+	}
+
+}
+
+Scope<Sampler> Sampler::Create(SamplerType type, uint32_t width, uint32_t height, uint32_t samplesPerPixel, uint32_t seed)
+{
+	switch (type)
+	{
+	case SamplerType::Stratified: return CreateScope<StratifiedSampler>(width, samplesPerPixel, seed);
+	case SamplerType::Sobol:      return CreateScope<SobolSampler>(width, seed);
+	case SamplerType::BlueNoise:  return CreateScope<BlueNoiseSampler>(width, height, samplesPerPixel, seed);
+	default:                      return CreateScope<IndependentSampler>(width, seed);
+	}
+}
+
+const char* Sampler::TypeName(SamplerType type)
+{
+	switch (type)
+	{
+	case SamplerType::Stratified: return "Stratified";
+	case SamplerType::Sobol:      return "Sobol";
+	case SamplerType::BlueNoise:  return "Blue Noise";
+	default:                      return "Independent";
+	}
+}
+
+bool Sampler::FindType(const std::string& name, SamplerType& type)
+{
+	std::string lowerName;
+	for (char c : name)
+		lowerName += (char)std::tolower((unsigned char)c);
+
+	for (SamplerType candidate : { SamplerType::Independent, SamplerType::Stratified, SamplerType::Sobol, SamplerType::BlueNoise })
+	{
+		std::string candidateName;
+		for (const char* c = TypeName(candidate); *c; c++)
+		{
+			if (*c != ' ')
+				candidateName += (char)std::tolower((unsigned char)*c);
+		}
+
+		if (lowerName == candidateName)
+		{
+			type = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+void IndependentSampler::StartPixelSample(uint32_t x, uint32_t y, uint32_t sample)
+{
+	m_Pixel = x + y * m_Width;
+	m_Sample = sample;
+	m_Dimension = 0;
+}
+
+float IndependentSampler::Get1D()
+{
+	return Random::ToFloat(Random::Hash(m_Pixel, m_Sample, m_Dimension++, m_Seed));
+}
+
+glm::vec2 IndependentSampler::Get2D()
+{
+	uint32_t v[4] = { m_Pixel, m_Sample, m_Dimension, m_Seed };
+	Random::Hash(v);
+	m_Dimension += 2;
+	return glm::vec2(Random::ToFloat(v[0]), Random::ToFloat(v[1]));
+}
+
+StratifiedSampler::StratifiedSampler(uint32_t width, uint32_t samplesPerPixel, uint32_t seed)
+	: m_Width(width), m_Seed(seed), m_SamplesPerPixel(std::max(samplesPerPixel, 1u))
+{
+	m_GridSize = (uint32_t)std::ceil(std::sqrt((float)m_SamplesPerPixel));
+}
+
+void StratifiedSampler::StartPixelSample(uint32_t x, uint32_t y, uint32_t sample)
+{
+	m_Pixel = x + y * m_Width;
+	m_Sample = sample;
+	m_Dimension = 0;
+}
+
+float StratifiedSampler::Get1D()
+{
+	uint32_t order = Random::Hash(m_Pixel, m_Dimension, m_Seed, ~0u);
+	uint32_t stratum = Permute(m_Sample % m_SamplesPerPixel, m_SamplesPerPixel, order);
+	float jitter = Random::ToFloat(Random::Hash(m_Pixel, m_Sample, m_Dimension, m_Seed));
+
+	m_Dimension++;
+	return (stratum + jitter) / m_SamplesPerPixel;
+}
+
+glm::vec2 StratifiedSampler::Get2D()
+{
+	uint32_t cellCount = m_GridSize * m_GridSize;
+	uint32_t order = Random::Hash(m_Pixel, m_Dimension, m_Seed, ~0u);
+	uint32_t cell = Permute(m_Sample % cellCount, cellCount, order);
+
+	uint32_t v[4] = { m_Pixel, m_Sample, m_Dimension, m_Seed };
+	Random::Hash(v);
+
+	m_Dimension += 2;
+	return glm::vec2(cell % m_GridSize + Random::ToFloat(v[0]), cell / m_GridSize + Random::ToFloat(v[1])) / (float)m_GridSize;
+}
+
+void SobolSampler::StartPixelSample(uint32_t x, uint32_t y, uint32_t sample)
+{
+	m_ReversedIndex = ReverseBits(sample);
+	m_PixelSeed = Random::Hash(x + y * m_Width, m_Seed, 0u, 0u);
+	m_Dimension = 0;
+}
+
+// NestedUniformScramble(ReverseBits(i)) is ReverseBits(LaineKarrasPermutation(i)), so the index
+// is kept bit reversed and the values only need reversing once at the end.
+float SobolSampler::Get1D()
+{
+	uint32_t seeds[4] = { m_PixelSeed, m_Dimension, 0u, 0u };
+	Random::Hash(seeds);
+
+	uint32_t index = ReverseBits(LaineKarrasPermutation(m_ReversedIndex, seeds[0]));
+	uint32_t x = ReverseBits(LaineKarrasPermutation(index, seeds[1]));
+
+	m_Dimension++;
+	return Random::ToFloat(x);
+}
+
+glm::vec2 SobolSampler::Get2D()
+{
+	uint32_t seeds[4] = { m_PixelSeed, m_Dimension, 0u, 0u };
+	Random::Hash(seeds);
+
+	uint32_t index = ReverseBits(LaineKarrasPermutation(m_ReversedIndex, seeds[0]));
+	uint32_t x = ReverseBits(LaineKarrasPermutation(index, seeds[1]));
+	uint32_t y = ReverseBits(LaineKarrasPermutation(ReversedSobolSecondDimension(index), seeds[2]));
+
+	m_Dimension += 2;
+	return glm::vec2(Random::ToFloat(x), Random::ToFloat(y));
+}
+
+BlueNoiseSampler::BlueNoiseSampler(uint32_t width, uint32_t height, uint32_t samplesPerPixel, uint32_t seed)
+	: SobolSampler(width, seed)
+{
+	m_CodeBits = std::min(2 * CeilLog2(std::max(width, height)), 32u);
+	m_SampleBits = 32 - m_CodeBits;
+	if (samplesPerPixel > 0)
+		m_SampleBits = std::min(CeilLog2(samplesPerPixel), m_SampleBits);
+}
+
+void BlueNoiseSampler::StartPixelSample(uint32_t x, uint32_t y, uint32_t sample)
+{
+	if ((uint64_t)sample >= (1ull << m_SampleBits))
+	{
+		SobolSampler::StartPixelSample(x, y, sample);
+		return;
+	}
+
+	// Reflecting the quadrants at every level of the curve keeps each aligned block of pixels
+	// a contiguous range of indices, but hides the regular pattern of a plain Morton order.
+	uint32_t code = 0;
+	if (m_CodeBits > 0)
+	{
+		uint32_t shift = 32 - m_CodeBits;
+		code = NestedUniformScramble(MortonCode(x, y) << shift, Random::Hash(m_Seed, 1u, 0u, 0u)) >> shift;
+	}
+
+	m_ReversedIndex = ReverseBits((uint32_t)(((uint64_t)code << m_SampleBits) | sample));
+	m_PixelSeed = Random::Hash(m_Seed, 2u, 0u, 0u);
+	m_Dimension = 0;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Math/Random.h"
+
+enum class SamplerType
+{
+	Independent,  // Uniform random numbers, converges at 1/sqrt(N)
+	Stratified,   // Jittered strata per dimension, needs the sample count up front
+	Sobol,        // Owen scrambled Sobol, every prefix of the samples is well distributed
+	BlueNoise     // Sobol indexed along a scrambled Morton curve, neighbouring pixels' errors cancel out
+};
+
+// Source of the random numbers of one camera sample. Every dimension of the sample's path
+// (pixel offset, lens position, time, each bounce's scattering) is one call to Get1D or two
+// dimensions of Get2D. Values only depend on the pixel, the sample index, the dimension and
+// the seed, so any split of the image over tiles and threads renders bit-identical images.
+class Sampler
+{
+public:
+	virtual ~Sampler() = default;
+
+	// Restarts the dimensions at 0 for the given sample of a pixel
+	virtual void StartPixelSample(uint32_t x, uint32_t y, uint32_t sample) = 0;
+
+	// Uniform in [0, 1), consumes one dimension
+	virtual float Get1D() = 0;
+	// Uniform in [0, 1)^2, consumes two dimensions
+	virtual glm::vec2 Get2D() = 0;
+
+	uint32_t GetDimension() const { return m_Dimension; }
+	// Continues the current sample at the given dimension. Values do not depend on the order they
+	// are drawn in, so a path can be picked up again after StartPixelSample.
+	void SetDimension(uint32_t dimension) { m_Dimension = dimension; }
+
+	// samplesPerPixel is 0 when the sample count is not known in advance (time budgeted renders)
+	static Scope<Sampler> Create(SamplerType type, uint32_t width, uint32_t height, uint32_t samplesPerPixel, uint32_t seed);
+	static const char* TypeName(SamplerType type);
+	// Matches the type names case insensitively and without spaces, e.g. "bluenoise"
+	static bool FindType(const std::string& name, SamplerType& type);
+
+protected:
+	uint32_t m_Dimension = 0;
+};
+
+class IndependentSampler : public Sampler
+{
+public:
+	IndependentSampler(uint32_t width, uint32_t seed)
+		: m_Width(width), m_Seed(seed)
+	{}
+
+	virtual void StartPixelSample(uint32_t x, uint32_t y, uint32_t sample) override;
+	virtual float Get1D() override;
+	virtual glm::vec2 Get2D() override;
+
+private:
+	uint32_t m_Width, m_Seed;
+	uint32_t m_Pixel = 0, m_Sample = 0;
+};
+
+// Splits every dimension into samplesPerPixel strata and every dimension pair into a
+// ceil(sqrt(n))^2 grid. Each pixel and dimension visits the strata in its own pseudo random
+// order, so the dimensions stay uncorrelated. Without a known sample count there is only a
+// single stratum, which makes it an independent sampler.
+class StratifiedSampler : public Sampler
+{
+public:
+	StratifiedSampler(uint32_t width, uint32_t samplesPerPixel, uint32_t seed);
+
+	virtual void StartPixelSample(uint32_t x, uint32_t y, uint32_t sample) override;
+	virtual float Get1D() override;
+	virtual glm::vec2 Get2D() override;
+
+private:
+	uint32_t m_Width, m_Seed;
+	uint32_t m_SamplesPerPixel, m_GridSize;
+	uint32_t m_Pixel = 0, m_Sample = 0;
+};
+
+// The first two Sobol dimensions with hash based Owen scrambling (Burley, "Practical Hash-based
+// Owen Scrambling"). Each Get1D/Get2D call shuffles the sample index and scrambles the values
+// with seeds of its own, which pads the 2D sequence out to any number of dimensions.
+class SobolSampler : public Sampler
+{
+public:
+	SobolSampler(uint32_t width, uint32_t seed)
+		: m_Width(width), m_Seed(seed)
+	{}
+
+	virtual void StartPixelSample(uint32_t x, uint32_t y, uint32_t sample) override;
+	virtual float Get1D() override;
+	virtual glm::vec2 Get2D() override;
+
+protected:
+	uint32_t m_Width, m_Seed;
+	uint32_t m_ReversedIndex = 0, m_PixelSeed = 0;
+};
+
+// Screen space blue noise error (Ahmed and Wonka, "Screen-Space Blue-Noise Diffusion of Monte
+// Carlo Sampling Error via Hierarchical Ordering of Pixels"). All pixels share one scrambled
+// Sobol sequence, pixel p taking the samples [p * n, p * n + n) with p its position along a
+// randomly reflected Morton curve. Every aligned block of pixels then holds a well stratified
+// part of the sequence. Samples beyond what fits into 32 bit indices fall back to per pixel
+// Sobol.
+class BlueNoiseSampler : public SobolSampler
+{
+public:
+	BlueNoiseSampler(uint32_t width, uint32_t height, uint32_t samplesPerPixel, uint32_t seed);
+
+	virtual void StartPixelSample(uint32_t x, uint32_t y, uint32_t sample) override;
+
+private:
+	uint32_t m_CodeBits, m_SampleBits;
+};
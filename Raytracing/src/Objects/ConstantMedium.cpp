@@ -1,20 +1,38 @@
 #include "rtpch.h"
 #include "ConstantMedium.h"
 
+#include "Objects/Instance.h"
 #include "Objects/Material.h"
+#include "Math/Random.h"
+
+namespace {
+
+    // Hit is not handed a Sampler, so the medium draws from a hash of the ray instead. Rays
+    // come from the sampler's values, which keeps the result just as reproducible.
+    float RayRandom(const Ray& ray, uint32_t key)
+    {
+        const glm::vec3& origin = ray.Origin();
+        const glm::vec3& direction = ray.Direction();
+
+        uint32_t h = Random::Hash(Random::FloatBits(origin.x), Random::FloatBits(origin.y), Random::FloatBits(origin.z), key);
+        return Random::ToFloat(Random::Hash(Random::FloatBits(direction.x), Random::FloatBits(direction.y),
+            Random::FloatBits(direction.z), h ^ Random::FloatBits(ray.time())));
+    }
+
+}
 
 ConstantMedium::ConstantMedium(Ref<Hittable> boundary, float density, Ref<Texture> texture)
-    : m_Boundary(boundary), m_NegativeInverseDensity(-1.0f / density), m_PhaseFunction(CreateRef<Material::Isotropic>(texture))
+    : m_Boundary(Instance::Collapse(boundary)), m_NegativeInverseDensity(-1.0f / density), m_PhaseFunction(CreateRef<Material::Isotropic>(texture))
 {}
 
 ConstantMedium::ConstantMedium(Ref<Hittable> boundary, float density, const glm::vec3& albedo)
-    : m_Boundary(boundary), m_NegativeInverseDensity(-1.0f / density), m_PhaseFunction(CreateRef<Material::Isotropic>(albedo))
+    : m_Boundary(Instance::Collapse(boundary)), m_NegativeInverseDensity(-1.0f / density), m_PhaseFunction(CreateRef<Material::Isotropic>(albedo))
 {}
 
 bool ConstantMedium::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
 {
     const bool enableDebug = false;
-    const bool debugging = enableDebug && Walnut::Random::Float() < 0.00001f;
+    const bool debugging = enableDebug && RayRandom(ray, 0) < 0.00001f;
 
     HitRecord record1, record2;
 
@@ -30,7 +48,7 @@ bool ConstantMedium::Hit(const Ray& ray, Interval rayInterval, HitRecord& record
 
     float rayLength = glm::length(ray.Direction());
     float distanceInsideBoundary = (record2.Intersection - record1.Intersection) * rayLength;
-    float hitDistance = m_NegativeInverseDensity * std::log(Walnut::Random::Float());
+    float hitDistance = m_NegativeInverseDensity * std::log(1.0f - RayRandom(ray, Random::FloatBits(m_NegativeInverseDensity)));
 
     if (hitDistance > distanceInsideBoundary) return false;
 
@@ -46,7 +64,32 @@ bool ConstantMedium::Hit(const Ray& ray, Interval rayInterval, HitRecord& record
 
     record.Normal = glm::vec3(1.0f, 0.0f, 0.0f);
     record.FrontFace = true;
-    record.MaterialPtr = m_PhaseFunction;
+    record.UVScale = 0.0f;
+    record.MaterialPtr = m_PhaseFunction.get();
 
     return true;
 }
+
+bool ConstantMedium::Occluded(const Ray& ray, Interval rayInterval) const
+{
+    // The boundary's entry and exit distances are needed, so it still takes two full queries
+    HitRecord record1, record2;
+
+    if (!m_Boundary->Hit(ray, Interval::Universe, record1)) return false;
+    if (!m_Boundary->Hit(ray, Interval(record1.Intersection + 0.0001f, INFINITY), record2)) return false;
+
+    float tMin = std::max(record1.Intersection, rayInterval.min());
+    float tMax = std::min(record2.Intersection, rayInterval.max());
+    if (tMin >= tMax) return false;
+
+    float rayLength = glm::length(ray.Direction());
+    float hitDistance = m_NegativeInverseDensity * std::log(1.0f - RayRandom(ray, Random::FloatBits(m_NegativeInverseDensity)));
+
+    return hitDistance <= (tMax - tMin) * rayLength;
+}
+
+void ConstantMedium::CollectMemory(SceneMemory& memory) const
+{
+    if (memory.Add(this, sizeof(*this)))
+        m_Boundary->CollectMemory(memory);
+}
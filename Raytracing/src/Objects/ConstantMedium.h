@@ -12,8 +12,11 @@ public:
 	ConstantMedium(Ref<Hittable> boundary, float density, const glm::vec3& albedo);
 
 	virtual bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const override;
+	// Scatters exactly where Hit would, the free path is drawn from the same hash of the ray
+	virtual bool Occluded(const Ray& ray, Interval rayInterval) const override;
 
 	virtual AABB BoundingBox() const override { return m_Boundary->BoundingBox(); }
+	virtual void CollectMemory(SceneMemory& memory) const override;
 
 private:
 	Ref<Hittable> m_Boundary;
@@ -3,6 +3,20 @@
 
 #include "Math/MathUtil.h"
 
+RayMask Hittable::HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const
+{
+    RayMask hitMask = 0;
+    for (uint32_t k = 0; k < packet.Size; k++)
+    {
+        if (Hit(packet.Rays[k], Interval(tMin, closest[k]), records[k]))
+        {
+            hitMask |= (RayMask)1 << k;
+            closest[k] = records[k].Intersection;
+        }
+    }
+    return hitMask;
+}
+
 Translate::Translate(Ref<Hittable> object, const glm::vec3& offset)
     : m_Object(object), m_Offset(offset)
 {
@@ -24,6 +38,18 @@ bool Translate::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) con
     return true;
 }
 
+bool Translate::Occluded(const Ray& ray, Interval rayInterval) const
+{
+    Ray offsetRay(ray.Origin() - m_Offset, ray.Direction(), ray.time());
+    return m_Object->Occluded(offsetRay, rayInterval);
+}
+
+void Translate::CollectMemory(SceneMemory& memory) const
+{
+    if (memory.Add(this, sizeof(*this)))
+        m_Object->CollectMemory(memory);
+}
+
 RotateY::RotateY(Ref<Hittable> object, float angle)
     : m_Object(object)
 {
@@ -62,9 +88,13 @@ RotateY::RotateY(Ref<Hittable> object, float angle)
     m_BoundingBox = AABB(min, max);
 }
 
-bool RotateY::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
+glm::mat3 RotateY::GetRotation() const
+{
+    return glm::mat3(glm::vec3(m_CosTheta, 0.0f, -m_SinTheta), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(m_SinTheta, 0.0f, m_CosTheta));
+}
+
+Ray RotateY::ToObjectSpace(const Ray& ray) const
 {
-    // Change the ray from world space to object space
     glm::vec3 origin = ray.Origin();
     glm::vec3 direction = ray.Direction();
 
@@ -74,10 +104,13 @@ bool RotateY::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
     direction.x = m_CosTheta * ray.Direction().x - m_SinTheta * ray.Direction().z;
     direction.z = m_SinTheta * ray.Direction().x + m_CosTheta * ray.Direction().z;
 
-    Ray rotatedRay(origin, direction, ray.time());
+    return Ray(origin, direction, ray.time());
+}
 
+bool RotateY::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
+{
     // Determine whether an intersection exists in object space (and if so, where)
-    if (!m_Object->Hit(rotatedRay, rayInterval, record)) return false;
+    if (!m_Object->Hit(ToObjectSpace(ray), rayInterval, record)) return false;
 
     // Change the intersection point from object space to world space
     glm::vec3 point = record.Point;
@@ -87,10 +120,21 @@ bool RotateY::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
     // Change the normal from object space to world space
     glm::vec3 normal = record.Normal;
     normal.x = m_CosTheta * record.Normal.x + m_SinTheta * record.Normal.z;
-    normal.x = -m_SinTheta * record.Normal.x + m_CosTheta * record.Normal.z;
+    normal.z = -m_SinTheta * record.Normal.x + m_CosTheta * record.Normal.z;
 
     record.Point = point;
     record.Normal = normal;
 
     return true;
 }
+
+bool RotateY::Occluded(const Ray& ray, Interval rayInterval) const
+{
+    return m_Object->Occluded(ToObjectSpace(ray), rayInterval);
+}
+
+void RotateY::CollectMemory(SceneMemory& memory) const
+{
+    if (memory.Add(this, sizeof(*this)))
+        m_Object->CollectMemory(memory);
+}
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <memory>
+#include <unordered_set>
+#include <vector>
 
 #include "glm/glm.hpp"
 
 #include "Math/Ray.h"
+#include "Math/RayPacket.h"
 #include "Math/Interval.h"
 #include "Math/AABB.h"
 
@@ -17,9 +20,16 @@ struct HitRecord
 {
     glm::vec3 Point;
     glm::vec3 Normal;
-    std::shared_ptr<Material::Blank> MaterialPtr;
+    // Non-owning, the material is kept alive by the hittable that was hit. Copying a record
+    // therefore touches no reference counts shared between the render threads.
+    const Material::Blank* MaterialPtr = nullptr;
     float Intersection;
     float U, V;
+    // UV units per world unit around the hit, the square root of UV area over surface area.
+    // Set by the shape, 0 if its UVs have no scale.
+    float UVScale = 0.0f;
+    // Width of the ray's footprint at the hit in UV units, set by the renderer for texture filtering
+    float Footprint = 0.0f;
     bool FrontFace;
 
     inline void SetFaceNormal(const Ray& ray, const glm::vec3& outwardNormal) 
@@ -29,14 +39,53 @@ struct HitRecord
     }
 };
 
+// Bytes taken by the geometry of a scene, hierarchies included. Objects reached through several
+// parents, like the object of many instances, are only counted once.
+struct SceneMemory
+{
+    size_t Bytes = 0;
+    std::unordered_set<const void*> Counted;
+
+    // Returns false, and adds nothing, if the object was counted before
+    bool Add(const void* object, size_t bytes)
+    {
+        if (!Counted.insert(object).second)
+            return false;
+        Bytes += bytes;
+        return true;
+    }
+};
+
 class Hittable 
 {
 public:
     virtual ~Hittable() = default;
 
     virtual bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const = 0;
+    // Any hit query for shadow and visibility rays: stops at the first intersection within the
+    // interval, no matter which, and fills in no record.
+    virtual bool Occluded(const Ray& ray, Interval rayInterval) const = 0;
+    // Closest hits of a packet: ray k is tested within (tMin, closest[k]), every hit lowers closest[k]
+    // and fills records[k]. Returns the mask of rays that hit. Tests the rays one at a time unless a
+    // hierarchy overrides it.
+    virtual RayMask HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const;
 
     virtual AABB BoundingBox() const = 0;
+
+    // Direct light sampling. Emissive shapes that can be sampled report IsLight, aggregates add
+    // the lights among their children to the list. Lights below a Translate, RotateY or Instance are not
+    // collected, they are still found when a scattered ray hits them.
+    virtual bool IsLight() const { return false; }
+    virtual void CollectLights(std::vector<Ref<Hittable>>& lights) const {}
+
+    // Adds the object and everything below it, materials and textures are not counted
+    virtual void CollectMemory(SceneMemory& memory) const = 0;
+
+    // Solid angle density of SampleDirection picking the ray's direction from its origin, 0 if the
+    // ray does not hit the shape within the interval
+    virtual float PDFValue(const Ray& ray, Interval rayInterval) const { return 0.0f; }
+    // Direction from origin towards a point on the shape, not normalized
+    virtual glm::vec3 SampleDirection(const glm::vec3& origin, float time, const glm::vec2& u) const { return glm::vec3(1.0f, 0.0f, 0.0f); }
 };
 
 class Translate : public Hittable
@@ -45,8 +94,13 @@ public:
     Translate(Ref<Hittable> object, const glm::vec3& offset);
 
     virtual bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const override;
+    virtual bool Occluded(const Ray& ray, Interval rayInterval) const override;
 
     virtual AABB BoundingBox() const override { return m_BoundingBox; }
+    virtual void CollectMemory(SceneMemory& memory) const override;
+
+    const Ref<Hittable>& GetObject() const { return m_Object; }
+    const glm::vec3& GetOffset() const { return m_Offset; }
 
 private:
     Ref<Hittable> m_Object;
@@ -60,8 +114,18 @@ public:
     RotateY(Ref<Hittable> object, float angle);
 
     virtual bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const override;
+    virtual bool Occluded(const Ray& ray, Interval rayInterval) const override;
 
     virtual AABB BoundingBox() const override { return m_BoundingBox; }
+    virtual void CollectMemory(SceneMemory& memory) const override;
+
+    const Ref<Hittable>& GetObject() const { return m_Object; }
+    // Object to world rotation
+    glm::mat3 GetRotation() const;
+
+private:
+    // Rotates a world space ray into object space
+    Ray ToObjectSpace(const Ray& ray) const;
 
 private:
     Ref<Hittable> m_Object;
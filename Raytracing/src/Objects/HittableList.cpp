@@ -1,13 +1,13 @@
 #include "rtpch.h"
 #include "Objects/HittableList.h"
-
-#include <Walnut/Random.h>
+#include "Objects/Instance.h"
 
 #include <memory>
 #include <vector>
 
 void HittableList::Add(Ref<Hittable> object)
 {
+	object = Instance::Collapse(object);
 	m_Objects.push_back(object); 
 	m_BoundingBox = AABB(m_BoundingBox, object->BoundingBox());
 }
@@ -28,4 +28,43 @@ bool HittableList::Hit(const Ray& ray, Interval rayInterval, HitRecord& record)
 	}
 
 	return hitAnything;
-}
\ No newline at end of file
+}
+
+RayMask HittableList::HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const
+{
+	RayMask hitMask = 0;
+	for (const Ref<Hittable>& object : m_Objects)
+		hitMask |= object->HitPacket(packet, tMin, closest, records);
+	return hitMask;
+}
+
+bool HittableList::Occluded(const Ray& ray, Interval rayInterval) const
+{
+	for (const Ref<Hittable>& object : m_Objects)
+	{
+		if (object->Occluded(ray, rayInterval))
+			return true;
+	}
+
+	return false;
+}
+
+void HittableList::CollectLights(std::vector<Ref<Hittable>>& lights) const
+{
+	for (const Ref<Hittable>& object : m_Objects)
+	{
+		if (object->IsLight())
+			lights.push_back(object);
+		else
+			object->CollectLights(lights);
+	}
+}
+
+void HittableList::CollectMemory(SceneMemory& memory) const
+{
+	if (!memory.Add(this, sizeof(*this) + m_Objects.capacity() * sizeof(Ref<Hittable>)))
+		return;
+
+	for (const Ref<Hittable>& object : m_Objects)
+		object->CollectMemory(memory);
+}
@@ -25,8 +25,12 @@ public:
 	void Add(Ref<Hittable> object);
 
 	virtual bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const override;
+	virtual bool Occluded(const Ray& ray, Interval rayInterval) const override;
+	virtual RayMask HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const override;
+	virtual void CollectLights(std::vector<Ref<Hittable>>& lights) const override;
+	virtual void CollectMemory(SceneMemory& memory) const override;
 
-	std::vector<Ref<Hittable>> Objects() const { return m_Objects; }
+	const std::vector<Ref<Hittable>>& Objects() const { return m_Objects; }
 	AABB BoundingBox() const override { return m_BoundingBox; }
 
 private:
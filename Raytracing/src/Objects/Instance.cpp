@@ -0,0 +1,97 @@
+#include "rtpch.h"
+#include "Objects/Instance.h"
+
+Instance::Instance(Ref<Hittable> object, const AffineTransform& objectToWorld)
+	: m_Object(object), m_WorldToObject(objectToWorld.Inverse())
+{
+	// Normals transform with the inverse transpose, so they stay perpendicular under scaling and shearing
+	m_NormalToWorld = glm::transpose(m_WorldToObject.Linear());
+
+	// UV units per unit of surface length shrink by the scale of the instance. Transforms that
+	// scale each axis differently use the cube root of their change in volume.
+	const glm::mat3& linear = m_WorldToObject.Linear();
+	m_UVScale = std::cbrt(std::fabs(glm::dot(linear[0], glm::cross(linear[1], linear[2]))));
+	m_BoundingBox = objectToWorld.TransformBox(m_Object->BoundingBox());
+}
+
+Ref<Instance> Instance::WithObject(Ref<Hittable> object) const
+{
+	// Copying keeps the cached transforms exact, inverting the inverse again would not
+	Ref<Instance> instance = CreateRef<Instance>(*this);
+	instance->m_Object = object;
+	return instance;
+}
+
+bool Instance::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
+{
+	if (!m_Object->Hit(ToObjectSpace(ray), rayInterval, record))
+		return false;
+
+	// FrontFace carries over, the transforms of direction and normal keep the sign of their dot product
+	record.Point = ray.At(record.Intersection);
+	record.Normal = glm::normalize(m_NormalToWorld * record.Normal);
+	record.UVScale *= m_UVScale;
+	return true;
+}
+
+bool Instance::Occluded(const Ray& ray, Interval rayInterval) const
+{
+	return m_Object->Occluded(ToObjectSpace(ray), rayInterval);
+}
+
+RayMask Instance::HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const
+{
+	RayPacket objectPacket;
+	for (uint32_t k = 0; k < packet.Size; k++)
+		objectPacket.Add(ToObjectSpace(packet.Rays[k]));
+	objectPacket.ComputeBounds();
+
+	RayMask hitMask = m_Object->HitPacket(objectPacket, tMin, closest, records);
+	for (RayMask rays = hitMask; rays; rays &= rays - 1)
+	{
+		uint32_t k = LowestRay(rays);
+		records[k].Point = packet.Rays[k].At(records[k].Intersection);
+		records[k].Normal = glm::normalize(m_NormalToWorld * records[k].Normal);
+		records[k].UVScale *= m_UVScale;
+	}
+	return hitMask;
+}
+
+Ref<Hittable> Instance::Collapse(const Ref<Hittable>& object)
+{
+	AffineTransform objectToWorld;
+	Ref<Hittable> current = object;
+	int wrappers = 0;
+	while (true)
+	{
+		if (const Translate* translate = dynamic_cast<const Translate*>(current.get()))
+		{
+			objectToWorld = objectToWorld * AffineTransform::FromTranslation(translate->GetOffset());
+			current = translate->GetObject();
+		}
+		else if (const RotateY* rotate = dynamic_cast<const RotateY*>(current.get()))
+		{
+			objectToWorld = objectToWorld * AffineTransform(rotate->GetRotation(), glm::vec3(0.0f));
+			current = rotate->GetObject();
+		}
+		else if (const Instance* instance = dynamic_cast<const Instance*>(current.get()))
+		{
+			objectToWorld = objectToWorld * instance->GetObjectToWorld();
+			current = instance->GetObject();
+		}
+		else
+			break;
+		wrappers++;
+	}
+
+	// A single wrapper already transforms the ray once
+	if (wrappers < 2)
+		return object;
+	return CreateRef<Instance>(current, objectToWorld);
+}
+
+void Instance::CollectMemory(SceneMemory& memory) const
+{
+	if (memory.Add(this, sizeof(*this)))
+		m_Object->CollectMemory(memory);
+}
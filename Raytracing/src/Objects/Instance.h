@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Objects/Hittable.h"
+#include "Math/AffineTransform.h"
+
+// One placement of a shared object, usually a BVHNode or TriangleMesh, under a full affine
+// transform. The object is only referenced, so any number of instances share one copy of its
+// geometry and hierarchy (the bottom level). A BVHNode over the instances forms the top level.
+//
+// Rays are moved into object space without normalizing their direction, which keeps t the same
+// in both spaces.
+class Instance : public Hittable
+{
+public:
+	Instance(Ref<Hittable> object, const AffineTransform& objectToWorld);
+
+	bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const override;
+	bool Occluded(const Ray& ray, Interval rayInterval) const override;
+	// Moves the whole packet into object space, an affine transform keeps coherent rays coherent
+	RayMask HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const override;
+
+	AABB BoundingBox() const override { return m_BoundingBox; }
+	void CollectMemory(SceneMemory& memory) const override;
+
+	const Ref<Hittable>& GetObject() const { return m_Object; }
+	AffineTransform GetObjectToWorld() const { return m_WorldToObject.Inverse(); }
+	// The same placement of another object with the same bounds, e.g. a hierarchy over this one's object
+	Ref<Instance> WithObject(Ref<Hittable> object) const;
+
+	// Merges a chain of nested Translate, RotateY and Instance wrappers into one Instance, so a
+	// ray is transformed once instead of once per wrapper. Anything else is returned as it is.
+	static Ref<Hittable> Collapse(const Ref<Hittable>& object);
+
+private:
+	Ray ToObjectSpace(const Ray& ray) const
+	{
+		return Ray(m_WorldToObject.TransformPoint(ray.Origin()), m_WorldToObject.TransformVector(ray.Direction()), ray.time());
+	}
+
+private:
+	Ref<Hittable> m_Object;
+	// Cached inverses, object to world is only needed for the bounding box and normals
+	AffineTransform m_WorldToObject;
+	glm::mat3 m_NormalToWorld;
+	float m_UVScale;   // Factor taking an object space HitRecord::UVScale to world space
+	AABB m_BoundingBox;
+};
@@ -1,31 +1,47 @@
 #include "rtpch.h"
 #include "Objects/Material.h"
-#include <Walnut/Random.h>
 
 namespace Material {
 	
-	bool Lambertian::Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const 
+	bool Lambertian::Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const 
 	{
-		glm::vec3 scatterDirection = record.Normal + glm::normalize(Walnut::Random::InUnitSphere());
+		glm::vec3 scatterDirection = record.Normal + MathUtil::SampleSphere(sampler.Get2D());
 
 		if (MathUtil::NearZero(scatterDirection))
 			scatterDirection = record.Normal;
 
 		scattered = Ray(record.Point, scatterDirection, rayIn.time());
-		attenuation = m_Texture->Value(record.U, record.V, record.Point);
+		attenuation = m_Texture->Lookup(record.U, record.V, record.Point, record.Footprint);
 		return true;
 	}
 
 
-	bool Metal::Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const 
+	// Scatter's direction is cosine distributed around the normal, so the attenuation it returns
+	// is Evaluate / ScatteringPDF.
+	glm::vec3 Lambertian::Evaluate(const Ray& rayIn, const HitRecord& record, const glm::vec3& direction) const
 	{
+		return m_Texture->Lookup(record.U, record.V, record.Point, record.Footprint) * ScatteringPDF(rayIn, record, direction);
+	}
+
+	float Lambertian::ScatteringPDF(const Ray& rayIn, const HitRecord& record, const glm::vec3& direction) const
+	{
+		float cosine = glm::dot(record.Normal, glm::normalize(direction));
+		return cosine > 0.0f ? cosine / PI : 0.0f;
+	}
+
+
+	bool Metal::Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const 
+	{
+		glm::vec2 u = sampler.Get2D();
+		glm::vec3 fuzz = m_Fuzz * MathUtil::SampleBall(u, sampler.Get1D());
+
 		glm::vec3 reflected = glm::reflect(rayIn.Direction(), record.Normal);
-		scattered = Ray(record.Point, glm::normalize(reflected) + m_Fuzz * Walnut::Random::InUnitSphere(), rayIn.time());
+		scattered = Ray(record.Point, glm::normalize(reflected) + fuzz, rayIn.time());
 		attenuation = m_Albedo;
 		return glm::dot(scattered.Direction(), record.Normal) > 0;
 	}
 
-	bool Dielectric::Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const 
+	bool Dielectric::Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const 
 	{
 		attenuation = glm::vec3(1.0, 1.0, 1.0);
 		float refractionRatio = record.FrontFace ? m_InverseRefractionIndex : m_RefractionIndex;
@@ -35,9 +51,10 @@ namespace Material {
 		float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
 
 		bool cannotRefract = refractionRatio * sinTheta > 1.0f;
+		float u = sampler.Get1D();
 		glm::vec3 direction;
 
-		if (cannotRefract || Reflectance(cosTheta, refractionRatio) > Walnut::Random::Float())
+		if (cannotRefract || Reflectance(cosTheta, refractionRatio) > u)
 			direction = glm::reflect(unitDirection, record.Normal);
 		else
 			direction = glm::refract(unitDirection, record.Normal, refractionRatio);
@@ -48,14 +65,18 @@ namespace Material {
 	
 	glm::vec3 DiffuseLight::Emitted(float u, float v, const glm::vec3& point) const
 	{
-		return m_Texture->Value(u, v, point);
+		return m_Texture->Lookup(u, v, point, 0.0f);
 	}
 
-	bool Isotropic::Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const
+	bool Isotropic::Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const
 	{
-		scattered = Ray(record.Point, glm::normalize(Walnut::Random::InUnitSphere()), rayIn.time());
-		attenuation = m_Texture->Value(record.U, record.V, record.Point);
+		scattered = Ray(record.Point, MathUtil::SampleSphere(sampler.Get2D()), rayIn.time());
+		attenuation = m_Texture->Lookup(record.U, record.V, record.Point, record.Footprint);
 		return true;
 	}
-};
 
+	glm::vec3 Isotropic::Evaluate(const Ray& rayIn, const HitRecord& record, const glm::vec3& direction) const
+	{
+		return m_Texture->Lookup(record.U, record.V, record.Point, record.Footprint) / (4.0f * PI);
+	}
+};
\ No newline at end of file
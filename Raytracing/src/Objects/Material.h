@@ -6,49 +6,86 @@
 
 #include "Math/MathUtil.h"
 #include "Math/Ray.h"
+#include "Math/Sampler.h"
 
 #include "Objects/Hittable.h"
 
 namespace Material {
 
+	// Concrete class of a material, so work can be grouped by how it is shaded
+	enum class Type : uint8_t
+	{
+		Lambertian,
+		Metal,
+		Dielectric,
+		DiffuseLight,
+		Isotropic
+	};
+	static constexpr uint32_t TypeCount = 5;
+
 	class Blank 
 	{
 	public:
 		virtual ~Blank() = default;
 
+		Type GetType() const { return m_Type; }
+
 		virtual glm::vec3 Emitted(float u, float v, const glm::vec3& point) const = 0;
 
-		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const = 0;
+		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const = 0;
+
+		// Materials with a scattering density can be lit by sampling the lights directly, specular
+		// ones (the default) only through the direction Scatter picks.
+		virtual bool IsSpecular() const { return true; }
+		virtual bool IsEmissive() const { return false; }
+
+		// Fraction of the light arriving from direction that leaves towards the incoming ray, per
+		// unit solid angle and including the cosine term
+		virtual glm::vec3 Evaluate(const Ray& rayIn, const HitRecord& record, const glm::vec3& direction) const { return glm::vec3(0.0f); }
+		// Solid angle density of Scatter picking direction
+		virtual float ScatteringPDF(const Ray& rayIn, const HitRecord& record, const glm::vec3& direction) const { return 0.0f; }
+
+	protected:
+		Blank(Type type)
+			: m_Type(type)
+		{}
+
+	private:
+		Type m_Type;
 	};
 
 
-	class Lambertian : public Blank 
+	class Lambertian final : public Blank 
 	{
 	public:
 		Lambertian(const glm::vec3& albedo) 
-			: m_Texture(CreateRef<SolidColor>(albedo)) 
+			: Blank(Type::Lambertian), m_Texture(CreateRef<SolidColor>(albedo)) 
 		{}
 
 		Lambertian(Ref<Texture> texture)
-			: m_Texture(texture)
+			: Blank(Type::Lambertian), m_Texture(texture)
 		{}
 
-		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const override;
+		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const override;
 		virtual glm::vec3 Emitted(float u, float v, const glm::vec3& point) const override { return glm::vec3(0.0f); }
 
+		virtual bool IsSpecular() const override { return false; }
+		virtual glm::vec3 Evaluate(const Ray& rayIn, const HitRecord& record, const glm::vec3& direction) const override;
+		virtual float ScatteringPDF(const Ray& rayIn, const HitRecord& record, const glm::vec3& direction) const override;
+
 	public:
 		Ref<Texture> m_Texture;
 	};
 
 
-	class Metal : public Blank 
+	class Metal final : public Blank 
 	{
 	public:
 		Metal(const glm::vec3& a, float f) 
-			: m_Albedo(a), m_Fuzz(f < 1 ? f : 1) 
+			: Blank(Type::Metal), m_Albedo(a), m_Fuzz(f < 1 ? f : 1) 
 		{}
 
-		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const override;
+		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const override;
 		virtual glm::vec3 Emitted(float u, float v, const glm::vec3& point) const override { return glm::vec3(0.0f); }
 
 	public:
@@ -57,14 +94,14 @@ namespace Material {
 	};
 
 
-	class Dielectric : public Blank 
+	class Dielectric final : public Blank 
 	{
 	public:
 		Dielectric(float refractionIndex) 
-			: m_RefractionIndex(refractionIndex), m_InverseRefractionIndex(1.0f / refractionIndex)
+			: Blank(Type::Dielectric), m_RefractionIndex(refractionIndex), m_InverseRefractionIndex(1.0f / refractionIndex)
 		{}
 
-		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const override;
+		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const override;
 		virtual glm::vec3 Emitted(float u, float v, const glm::vec3& point) const override { return glm::vec3(0.0f); }
 
 	private:
@@ -78,40 +115,63 @@ namespace Material {
 		float m_RefractionIndex, m_InverseRefractionIndex;
 	};
 
-	class DiffuseLight : public Blank 
+	class DiffuseLight final : public Blank 
 	{
 	public:
 		DiffuseLight(const glm::vec3& emitted)
-			: m_Texture(CreateRef<SolidColor>(emitted))
+			: Blank(Type::DiffuseLight), m_Texture(CreateRef<SolidColor>(emitted))
 		{}
 
 		DiffuseLight(Ref<Texture> texture)
-			: m_Texture(texture)
+			: Blank(Type::DiffuseLight), m_Texture(texture)
 		{}
 		
-		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const override { return 0; }
+		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const override { return 0; }
 		virtual glm::vec3 Emitted(float u, float v, const glm::vec3& point) const override;
 
+		virtual bool IsEmissive() const override { return true; }
+
 	private:
 		Ref<Texture> m_Texture;
 	};
 
-	class Isotropic : public Blank
+	class Isotropic final : public Blank
 	{
 	public:
 		Isotropic(const glm::vec3& albedo) 
-			: m_Texture(CreateRef<SolidColor>(albedo)) 
+			: Blank(Type::Isotropic), m_Texture(CreateRef<SolidColor>(albedo)) 
 		{}
 
 		Isotropic(Ref<Texture> texture)
-			: m_Texture(texture)
+			: Blank(Type::Isotropic), m_Texture(texture)
 		{}
 
-		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered) const override;
+		virtual bool Scatter(const Ray& rayIn, const HitRecord& record, glm::vec3& attenuation, Ray& scattered, Sampler& sampler) const override;
 		virtual glm::vec3 Emitted(float u, float v, const glm::vec3& point) const override { return glm::vec3(0.0f); }
 
+		virtual bool IsSpecular() const override { return false; }
+		virtual glm::vec3 Evaluate(const Ray& rayIn, const HitRecord& record, const glm::vec3& direction) const override;
+		virtual float ScatteringPDF(const Ray& rayIn, const HitRecord& record, const glm::vec3& direction) const override { return 1.0f / (4.0f * PI); }
+
 	private:
 		Ref<Texture> m_Texture;
 	};
+
+	// Calls function with the material cast to its concrete class. The classes are final, so
+	// every member function the function calls binds statically, and an instantiation of it per
+	// class lets the compiler fold IsSpecular, IsEmissive and the like into constants.
+	template<typename Function>
+	decltype(auto) Visit(const Blank& material, Function&& function)
+	{
+		switch (material.GetType())
+		{
+		case Type::Lambertian:   return function(static_cast<const Lambertian&>(material));
+		case Type::Metal:        return function(static_cast<const Metal&>(material));
+		case Type::Dielectric:   return function(static_cast<const Dielectric&>(material));
+		case Type::DiffuseLight: return function(static_cast<const DiffuseLight&>(material));
+		case Type::Isotropic:    return function(static_cast<const Isotropic&>(material));
+		}
+		RT_UNREACHABLE();
+	}
 };
 
@@ -0,0 +1,737 @@
+#include "rtpch.h"
+#include "Objects/MeshLoader.h"
+
+#include <charconv>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+namespace {
+
+	// Hands out lines or raw bytes of a file that is read one large block at a time
+	class FileReader
+	{
+	public:
+		explicit FileReader(std::ifstream& file)
+			: m_File(file), m_Buffer(s_BlockSize)
+		{
+			m_File.seekg(0, std::ios::end);
+			std::streamoff size = m_File.tellg();
+			m_File.seekg(0, std::ios::beg);
+			m_FileSize = size > 0 ? (size_t)size : 0;
+		}
+
+		// Bytes not handed out yet
+		size_t RemainingBytes() const { return m_End - m_Begin + (m_FileSize - m_FileRead); }
+
+		// The line stays valid until the next call, without its line break
+		bool ReadLine(std::string_view& line)
+		{
+			while (true)
+			{
+				const char* begin = m_Buffer.data() + m_Begin;
+				const char* newline = (const char*)std::memchr(begin, '\n', m_End - m_Begin);
+				size_t length;
+				if (newline != nullptr)
+				{
+					length = newline - begin;
+					m_Begin += length + 1;
+				}
+				else if (!Fill())
+				{
+					// The last line of a file without a final line break
+					if (m_Begin == m_End)
+						return false;
+
+					begin = m_Buffer.data() + m_Begin;
+					length = m_End - m_Begin;
+					m_Begin = m_End;
+				}
+				else continue;
+
+				if (length > 0 && begin[length - 1] == '\r')
+					length--;
+				line = std::string_view(begin, length);
+				return true;
+			}
+		}
+
+		bool Read(void* destination, size_t size)
+		{
+			char* output = (char*)destination;
+			while (size > 0)
+			{
+				if (m_Begin == m_End && !Fill())
+					return false;
+
+				size_t chunk = std::min(size, m_End - m_Begin);
+				std::memcpy(output, m_Buffer.data() + m_Begin, chunk);
+				m_Begin += chunk;
+				output += chunk;
+				size -= chunk;
+			}
+			return true;
+		}
+
+	private:
+		// Moves the unread bytes to the front and appends the next block, false once the file has ended
+		bool Fill()
+		{
+			if (m_EndOfFile)
+				return false;
+
+			if (m_Begin > 0)
+			{
+				std::memmove(m_Buffer.data(), m_Buffer.data() + m_Begin, m_End - m_Begin);
+				m_End -= m_Begin;
+				m_Begin = 0;
+			}
+
+			// Only a single line longer than the whole buffer gets here with a full buffer
+			if (m_End == m_Buffer.size())
+				m_Buffer.resize(2 * m_Buffer.size());
+
+			m_File.read(m_Buffer.data() + m_End, m_Buffer.size() - m_End);
+			size_t read = (size_t)m_File.gcount();
+			m_End += read;
+			m_FileRead = std::min(m_FileRead + read, m_FileSize);
+			m_EndOfFile = read == 0;
+			return !m_EndOfFile;
+		}
+
+	private:
+		static constexpr size_t s_BlockSize = 1 << 20;
+
+		std::ifstream& m_File;
+		std::vector<char> m_Buffer;
+		size_t m_Begin = 0, m_End = 0;
+		size_t m_FileSize = 0, m_FileRead = 0;
+		bool m_EndOfFile = false;
+	};
+
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	void SkipSpaces(const char*& p, const char* end)
+	{
+		while (p < end && IsSpace(*p))
+			p++;
+	}
+
+	// Like std::from_chars, but skips leading spaces and a leading plus sign
+	template<typename T>
+	bool ParseNumber(const char*& p, const char* end, T& value)
+	{
+		SkipSpaces(p, end);
+		if (p < end && *p == '+')
+			p++;
+
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc())
+			return false;
+
+		p = result.ptr;
+		return true;
+	}
+
+	bool StartsWithKeyword(const char* p, const char* end, const char* keyword)
+	{
+		size_t length = std::strlen(keyword);
+		return (size_t)(end - p) > length && std::memcmp(p, keyword, length) == 0 && IsSpace(p[length]);
+	}
+
+	std::vector<std::string_view> SplitWords(std::string_view line)
+	{
+		std::vector<std::string_view> words;
+		const char* p = line.data();
+		const char* end = p + line.size();
+		while (true)
+		{
+			SkipSpaces(p, end);
+			if (p == end)
+				return words;
+
+			const char* word = p;
+			while (p < end && !IsSpace(*p))
+				p++;
+			words.emplace_back(word, p - word);
+		}
+	}
+
+	std::string Extension(const std::string& path)
+	{
+		size_t dot = path.find_last_of('.');
+		if (dot == std::string::npos)
+			return "";
+
+		std::string extension = path.substr(dot);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return extension;
+	}
+
+	// OBJ indexes positions, UVs and normals separately, a corner refers to one of each (-1 if it has none).
+	struct ObjCorner
+	{
+		int64_t Position, UV, Normal;
+
+		bool operator==(const ObjCorner& other) const { return Position == other.Position && UV == other.UV && Normal == other.Normal; }
+	};
+
+	struct ObjCornerHash
+	{
+		size_t operator()(const ObjCorner& corner) const
+		{
+			uint64_t h = (uint64_t)corner.Position * 0x9e3779b97f4a7c15ull;
+			h ^= ((uint64_t)corner.UV + 0x632be59bd9b4e019ull) * 0xbf58476d1ce4e5b9ull;
+			h ^= ((uint64_t)corner.Normal + 0x85ebca6bull) * 0x94d049bb133111ebull;
+			return (size_t)(h ^ (h >> 31));
+		}
+	};
+
+	// 1 based and negative (counted back from the last element read so far) indices to 0 based ones
+	bool ResolveObjIndex(int64_t index, size_t count, int64_t& resolved)
+	{
+		if (index == 0)
+			return false;
+
+		resolved = index > 0 ? index - 1 : (int64_t)count + index;
+		return resolved >= 0;
+	}
+
+	Ref<MeshData> LoadOBJ(FileReader& reader, const std::string& filename)
+	{
+		std::vector<glm::vec3> positions, normals;
+		std::vector<glm::vec2> uvs;
+		std::vector<ObjCorner> corners, polygon;
+		bool anyUV = false, anyNormal = false;
+
+		std::string_view line;
+		size_t lineNumber = 0;
+		auto fail = [&](const char* reason)
+			{
+				std::cerr << "ERROR: " << filename << ":" << lineNumber << ": " << reason << ".\n";
+				return nullptr;
+			};
+
+		while (reader.ReadLine(line))
+		{
+			lineNumber++;
+			const char* p = line.data();
+			const char* end = p + line.size();
+			SkipSpaces(p, end);
+
+			if (StartsWithKeyword(p, end, "v"))
+			{
+				glm::vec3 position;
+				p += 1;
+				if (!ParseNumber(p, end, position.x) || !ParseNumber(p, end, position.y) || !ParseNumber(p, end, position.z))
+					return fail("Invalid vertex position");
+				positions.push_back(position);
+			}
+			else if (StartsWithKeyword(p, end, "vt"))
+			{
+				glm::vec2 uv(0.0f);
+				p += 2;
+				if (!ParseNumber(p, end, uv.x))
+					return fail("Invalid texture coordinate");
+				ParseNumber(p, end, uv.y);
+				uvs.push_back(uv);
+			}
+			else if (StartsWithKeyword(p, end, "vn"))
+			{
+				glm::vec3 normal;
+				p += 2;
+				if (!ParseNumber(p, end, normal.x) || !ParseNumber(p, end, normal.y) || !ParseNumber(p, end, normal.z))
+					return fail("Invalid vertex normal");
+				normals.push_back(normal);
+			}
+			else if (StartsWithKeyword(p, end, "f"))
+			{
+				// Corners are written as p, p/t, p//n or p/t/n
+				polygon.clear();
+				p += 1;
+				while (true)
+				{
+					SkipSpaces(p, end);
+					if (p == end)
+						break;
+
+					int64_t index;
+					ObjCorner corner = { -1, -1, -1 };
+					if (!ParseNumber(p, end, index) || !ResolveObjIndex(index, positions.size(), corner.Position))
+						return fail("Invalid face");
+
+					if (p < end && *p == '/')
+					{
+						p++;
+						if (p < end && *p != '/')
+						{
+							if (!ParseNumber(p, end, index) || !ResolveObjIndex(index, uvs.size(), corner.UV))
+								return fail("Invalid face");
+							anyUV = true;
+						}
+						if (p < end && *p == '/')
+						{
+							p++;
+							if (!ParseNumber(p, end, index) || !ResolveObjIndex(index, normals.size(), corner.Normal))
+								return fail("Invalid face");
+							anyNormal = true;
+						}
+					}
+
+					if (p < end && !IsSpace(*p))
+						return fail("Invalid face");
+					polygon.push_back(corner);
+				}
+
+				for (size_t i = 1; i + 1 < polygon.size(); i++)
+				{
+					corners.push_back(polygon[0]);
+					corners.push_back(polygon[i]);
+					corners.push_back(polygon[i + 1]);
+				}
+			}
+			// Comments, groups, smoothing groups and materials carry nothing the mesh uses
+		}
+
+		for (const ObjCorner& corner : corners)
+		{
+			if (corner.Position >= (int64_t)positions.size() || corner.UV >= (int64_t)uvs.size() || corner.Normal >= (int64_t)normals.size())
+			{
+				std::cerr << "ERROR: " << filename << ": A face refers to a vertex that does not exist.\n";
+				return nullptr;
+			}
+		}
+
+		Ref<MeshData> mesh = CreateRef<MeshData>();
+		mesh->Indices.reserve(corners.size());
+
+		// Without UVs and normals every position is one vertex, otherwise each distinct combination is
+		if (!anyUV && !anyNormal)
+		{
+			mesh->Positions = std::move(positions);
+			for (const ObjCorner& corner : corners)
+				mesh->Indices.push_back((uint32_t)corner.Position);
+			return mesh;
+		}
+
+		std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> vertices;
+		vertices.reserve(positions.size());
+		for (const ObjCorner& corner : corners)
+		{
+			auto [iterator, inserted] = vertices.try_emplace(corner, (uint32_t)mesh->Positions.size());
+			if (inserted)
+			{
+				mesh->Positions.push_back(positions[corner.Position]);
+				if (anyUV)
+					mesh->UVs.push_back(corner.UV >= 0 ? uvs[corner.UV] : glm::vec2(0.0f));
+				// A zero normal makes the triangle fall back to its geometric normal
+				if (anyNormal)
+					mesh->Normals.push_back(corner.Normal >= 0 ? normals[corner.Normal] : glm::vec3(0.0f));
+			}
+			mesh->Indices.push_back(iterator->second);
+		}
+
+		return mesh;
+	}
+
+	enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, None };
+
+	PlyType FindPlyType(std::string_view name)
+	{
+		if (name == "char" || name == "int8") return PlyType::Int8;
+		if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+		if (name == "short" || name == "int16") return PlyType::Int16;
+		if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+		if (name == "int" || name == "int32") return PlyType::Int32;
+		if (name == "uint" || name == "uint32") return PlyType::UInt32;
+		if (name == "float" || name == "float32") return PlyType::Float32;
+		if (name == "double" || name == "float64") return PlyType::Float64;
+		return PlyType::None;
+	}
+
+	size_t PlyTypeSize(PlyType type)
+	{
+		switch (type)
+		{
+		case PlyType::Int8: case PlyType::UInt8:   return 1;
+		case PlyType::Int16: case PlyType::UInt16: return 2;
+		case PlyType::Float64:                     return 8;
+		default:                                   return 4;
+		}
+	}
+
+	struct PlyProperty
+	{
+		std::string Name;
+		PlyType Type;
+		PlyType CountType = PlyType::None;   // Set for list properties
+
+		bool IsList() const { return CountType != PlyType::None; }
+	};
+
+	struct PlyElement
+	{
+		std::string Name;
+		size_t Count;
+		std::vector<PlyProperty> Properties;
+
+		// Fewest bytes an item can take up in the file, one per property at least
+		size_t MinimumItemSize(bool binary) const
+		{
+			size_t size = 0;
+			for (const PlyProperty& property : Properties)
+				size += binary ? PlyTypeSize(property.IsList() ? property.CountType : property.Type) : 1;
+			return std::max(size, (size_t)1);
+		}
+
+		int FindProperty(std::initializer_list<const char*> names) const
+		{
+			for (const char* name : names)
+			{
+				for (size_t i = 0; i < Properties.size(); i++)
+				{
+					if (Properties[i].Name == name)
+						return (int)i;
+				}
+			}
+			return -1;
+		}
+	};
+
+	enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+	// Longest list an item may have, anything longer is taken for a corrupt file
+	constexpr double s_MaxPlyListLength = 65536.0;
+
+	// Converts a value read as a double to an integer in [0, limit], false if it is not one
+	template<typename T>
+	bool ToIndex(double value, double limit, T& index)
+	{
+		if (!(value >= 0.0 && value <= limit && value == std::floor(value)))
+			return false;
+		index = (T)value;
+		return true;
+	}
+
+	// Reads the items of an element one at a time. Scalars receives every scalar property of the
+	// item, List the values of the one list property that is asked for, other lists are skipped.
+	class PlyItemReader
+	{
+	public:
+		std::vector<double> Scalars;
+		std::vector<double> List;
+
+	public:
+		PlyItemReader(FileReader& reader, PlyFormat format, const PlyElement& element, int listProperty)
+			: Scalars(element.Properties.size(), 0.0), m_Reader(reader), m_Format(format), m_Element(element), m_ListProperty(listProperty)
+		{
+			uint16_t one = 1;
+			bool hostLittleEndian = *(const uint8_t*)&one == 1;
+			m_Swap = format != PlyFormat::Ascii && hostLittleEndian != (format == PlyFormat::BinaryLittleEndian);
+		}
+
+		bool Next()
+		{
+			List.clear();
+			return m_Format == PlyFormat::Ascii ? NextAscii() : NextBinary();
+		}
+
+	private:
+		bool NextAscii()
+		{
+			std::string_view line;
+			if (!m_Reader.ReadLine(line))
+				return false;
+
+			const char* p = line.data();
+			const char* end = p + line.size();
+			for (size_t i = 0; i < m_Element.Properties.size(); i++)
+			{
+				const PlyProperty& property = m_Element.Properties[i];
+				if (!property.IsList())
+				{
+					if (!ParseNumber(p, end, Scalars[i]))
+						return false;
+					continue;
+				}
+
+				double count, value;
+				size_t length;
+				if (!ParseNumber(p, end, count) || !ToIndex(count, s_MaxPlyListLength, length))
+					return false;
+				for (size_t j = 0; j < length; j++)
+				{
+					if (!ParseNumber(p, end, value))
+						return false;
+					if ((int)i == m_ListProperty)
+						List.push_back(value);
+				}
+			}
+			return true;
+		}
+
+		bool NextBinary()
+		{
+			for (size_t i = 0; i < m_Element.Properties.size(); i++)
+			{
+				const PlyProperty& property = m_Element.Properties[i];
+				if (!property.IsList())
+				{
+					if (!ReadBinary(property.Type, Scalars[i]))
+						return false;
+					continue;
+				}
+
+				double count, value;
+				size_t length;
+				if (!ReadBinary(property.CountType, count) || !ToIndex(count, s_MaxPlyListLength, length))
+					return false;
+				for (size_t j = 0; j < length; j++)
+				{
+					if (!ReadBinary(property.Type, value))
+						return false;
+					if ((int)i == m_ListProperty)
+						List.push_back(value);
+				}
+			}
+			return true;
+		}
+
+		bool ReadBinary(PlyType type, double& value)
+		{
+			uint8_t bytes[8];
+			size_t size = PlyTypeSize(type);
+			if (!m_Reader.Read(bytes, size))
+				return false;
+			if (m_Swap)
+				std::reverse(bytes, bytes + size);
+
+			switch (type)
+			{
+			case PlyType::Int8:    { int8_t v; std::memcpy(&v, bytes, size); value = v; break; }
+			case PlyType::UInt8:   { uint8_t v; std::memcpy(&v, bytes, size); value = v; break; }
+			case PlyType::Int16:   { int16_t v; std::memcpy(&v, bytes, size); value = v; break; }
+			case PlyType::UInt16:  { uint16_t v; std::memcpy(&v, bytes, size); value = v; break; }
+			case PlyType::Int32:   { int32_t v; std::memcpy(&v, bytes, size); value = v; break; }
+			case PlyType::UInt32:  { uint32_t v; std::memcpy(&v, bytes, size); value = v; break; }
+			case PlyType::Float32: { float v; std::memcpy(&v, bytes, size); value = v; break; }
+			default:               { double v; std::memcpy(&v, bytes, size); value = v; break; }
+			}
+			return true;
+		}
+
+	private:
+		FileReader& m_Reader;
+		PlyFormat m_Format;
+		const PlyElement& m_Element;
+		int m_ListProperty;
+		bool m_Swap;
+	};
+
+	Ref<MeshData> LoadPLY(FileReader& reader, const std::string& filename)
+	{
+		auto fail = [&](const char* reason)
+			{
+				std::cerr << "ERROR: " << filename << ": " << reason << ".\n";
+				return nullptr;
+			};
+
+		std::string_view line;
+		if (!reader.ReadLine(line) || line != "ply")
+			return fail("Not a PLY file");
+
+		PlyFormat format = PlyFormat::Ascii;
+		std::vector<PlyElement> elements;
+		while (true)
+		{
+			if (!reader.ReadLine(line))
+				return fail("The header does not end");
+
+			std::vector<std::string_view> words = SplitWords(line);
+			if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+				continue;
+
+			if (words[0] == "end_header")
+				break;
+
+			if (words[0] == "format" && words.size() >= 2)
+			{
+				if (words[1] == "ascii") format = PlyFormat::Ascii;
+				else if (words[1] == "binary_little_endian") format = PlyFormat::BinaryLittleEndian;
+				else if (words[1] == "binary_big_endian") format = PlyFormat::BinaryBigEndian;
+				else return fail("Unknown format");
+			}
+			else if (words[0] == "element" && words.size() >= 3)
+			{
+				PlyElement element;
+				element.Name = std::string(words[1]);
+				const char* p = words[2].data();
+				if (!ParseNumber(p, words[2].data() + words[2].size(), element.Count))
+					return fail("Invalid element count");
+				elements.push_back(element);
+			}
+			else if (words[0] == "property" && !elements.empty())
+			{
+				PlyProperty property;
+				if (words.size() >= 5 && words[1] == "list")
+				{
+					property.CountType = FindPlyType(words[2]);
+					property.Type = FindPlyType(words[3]);
+					property.Name = std::string(words[4]);
+					if (property.CountType == PlyType::None)
+						return fail("Unknown property type");
+				}
+				else if (words.size() >= 3)
+				{
+					property.Type = FindPlyType(words[1]);
+					property.Name = std::string(words[2]);
+				}
+				else return fail("Invalid property");
+
+				if (property.Type == PlyType::None)
+					return fail("Unknown property type");
+				elements.back().Properties.push_back(property);
+			}
+			else return fail("Invalid header line");
+		}
+
+		// The counts size the buffers up front, so a corrupt header must not get that far
+		size_t remaining = reader.RemainingBytes();
+		for (const PlyElement& element : elements)
+		{
+			size_t itemSize = element.MinimumItemSize(format != PlyFormat::Ascii);
+			if (element.Count > remaining / itemSize)
+				return fail("Element counts exceed the file size");
+			remaining -= element.Count * itemSize;
+		}
+
+		Ref<MeshData> mesh = CreateRef<MeshData>();
+		bool hasVertices = false;
+		for (const PlyElement& element : elements)
+		{
+			if (element.Name == "vertex")
+			{
+				int x = element.FindProperty({ "x" }), y = element.FindProperty({ "y" }), z = element.FindProperty({ "z" });
+				int nx = element.FindProperty({ "nx" }), ny = element.FindProperty({ "ny" }), nz = element.FindProperty({ "nz" });
+				int u = element.FindProperty({ "u", "s", "texture_u", "texture_s" });
+				int v = element.FindProperty({ "v", "t", "texture_v", "texture_t" });
+				if (x < 0 || y < 0 || z < 0)
+					return fail("Vertices without positions");
+
+				bool hasNormals = nx >= 0 && ny >= 0 && nz >= 0;
+				bool hasUVs = u >= 0 && v >= 0;
+				mesh->Positions.reserve(element.Count);
+				if (hasNormals) mesh->Normals.reserve(element.Count);
+				if (hasUVs) mesh->UVs.reserve(element.Count);
+
+				PlyItemReader item(reader, format, element, -1);
+				for (size_t i = 0; i < element.Count; i++)
+				{
+					if (!item.Next())
+						return fail("Invalid or truncated vertex data");
+
+					const std::vector<double>& values = item.Scalars;
+					mesh->Positions.emplace_back((float)values[x], (float)values[y], (float)values[z]);
+					if (hasNormals)
+						mesh->Normals.emplace_back((float)values[nx], (float)values[ny], (float)values[nz]);
+					if (hasUVs)
+						mesh->UVs.emplace_back((float)values[u], (float)values[v]);
+				}
+				hasVertices = true;
+			}
+			else if (element.Name == "face")
+			{
+				int indices = element.FindProperty({ "vertex_indices", "vertex_index" });
+				if (indices < 0 || !element.Properties[indices].IsList())
+					return fail("Faces without vertex indices");
+
+				mesh->Indices.reserve(3 * element.Count);
+				PlyItemReader item(reader, format, element, indices);
+				std::vector<uint32_t> polygon;
+				for (size_t i = 0; i < element.Count; i++)
+				{
+					if (!item.Next())
+						return fail("Invalid or truncated face data");
+
+					polygon.resize(item.List.size());
+					for (size_t j = 0; j < polygon.size(); j++)
+					{
+						if (!ToIndex(item.List[j], (double)UINT32_MAX, polygon[j]))
+							return fail("Invalid vertex index");
+					}
+
+					for (size_t j = 1; j + 1 < polygon.size(); j++)
+					{
+						mesh->Indices.push_back(polygon[0]);
+						mesh->Indices.push_back(polygon[j]);
+						mesh->Indices.push_back(polygon[j + 1]);
+					}
+				}
+			}
+			else
+			{
+				// Edges, materials and the like are read past
+				PlyItemReader item(reader, format, element, -1);
+				for (size_t i = 0; i < element.Count; i++)
+				{
+					if (!item.Next())
+						return fail("Truncated data");
+				}
+			}
+		}
+
+		if (!hasVertices)
+			return fail("No vertices");
+
+		for (uint32_t index : mesh->Indices)
+		{
+			if (index >= mesh->Positions.size())
+				return fail("A face refers to a vertex that does not exist");
+		}
+
+		return mesh;
+	}
+
+}
+
+bool MeshLoader::IsSupported(const std::string& filename)
+{
+	std::string extension = Extension(filename);
+	return extension == ".obj" || extension == ".ply";
+}
+
+Ref<MeshData> MeshLoader::Load(const std::string& filename)
+{
+	std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+
+	if (!IsSupported(filename))
+	{
+		std::cerr << "ERROR: Unsupported mesh file '" << filename << "', use .obj or .ply.\n";
+		return nullptr;
+	}
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		file.open("res/" + filename, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "ERROR: Could not open mesh file '" << filename << "'.\n";
+		return nullptr;
+	}
+
+	FileReader reader(file);
+	Ref<MeshData> mesh = Extension(filename) == ".obj" ? LoadOBJ(reader, filename) : LoadPLY(reader, filename);
+	if (!mesh)
+		return nullptr;
+
+	float loadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+	if (s_Logging)
+		std::cout << "Mesh '" << filename << "': " << mesh->Positions.size() << " vertices, " << mesh->TriangleCount() << " triangles, "
+			<< mesh->MemoryUsage() / (1024 * 1024) << " MB, loaded in " << loadTime << "ms\n";
+	return mesh;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "Objects/TriangleMesh.h"
+
+// Reads triangle meshes from Wavefront OBJ and PLY (ASCII and binary) files. Files are parsed
+// block by block as they are read, so a large model never sits in memory as a whole file.
+// Polygons are split into triangle fans.
+class MeshLoader
+{
+public:
+	// Tries the path as given, then relative to res/. Returns nullptr and reports the reason
+	// if the file cannot be read.
+	static Ref<MeshData> Load(const std::string& filename);
+
+	static bool IsSupported(const std::string& filename);
+
+	// Load statistics on stdout, tools that print machine readable results turn them off.
+	static void SetLogging(bool enabled) { s_Logging = enabled; }
+
+private:
+	static inline bool s_Logging = true;
+};
@@ -0,0 +1,533 @@
+#include "rtpch.h"
+#include "Objects/PrimitiveArrays.h"
+
+#include "Core/CPUFeatures.h"
+#include "Core/Statistics.h"
+#include "Objects/Quad.h"
+#include "Objects/Sphere.h"
+#include "Objects/TriangleMesh.h"
+
+#include <algorithm>
+
+#if RT_SIMD_X86
+	#include <immintrin.h>
+#endif
+
+namespace {
+
+	// Entries added behind the last primitive of each kind, a batch starting at the last one still reads four
+	constexpr size_t s_BatchPadding = 3;
+
+#if RT_SIMD_X86
+	inline __m128 Load(const std::vector<float>& values, uint32_t index)
+	{
+		return _mm_loadu_ps(values.data() + index);
+	}
+
+	// Lane holding the smallest of the values. Ties go to the lane a sequential loop over the
+	// batch would have kept: the first one for strict interval tests, the last one otherwise.
+	inline int ClosestLane(__m128 t, bool keepLast, float& closest)
+	{
+		__m128 minimum = _mm_min_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 3, 0, 1)));
+		minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+		closest = _mm_cvtss_f32(minimum);
+
+		int mask = _mm_movemask_ps(_mm_cmpeq_ps(t, minimum));
+		for (int i = 0; i < 4; i++)
+		{
+			int lane = keepLast ? 3 - i : i;
+			if (mask & (1 << lane))
+				return lane;
+		}
+		return 0;
+	}
+
+	inline __m128 LaneMask(int mask)
+	{
+		return _mm_castsi128_ps(_mm_setr_epi32(mask & 1 ? -1 : 0, mask & 2 ? -1 : 0, mask & 4 ? -1 : 0, mask & 8 ? -1 : 0));
+	}
+#endif
+
+	int KindOrder(const Ref<Hittable>& object)
+	{
+		return (int)PrimitiveArrays::KindOf(*object);
+	}
+
+}
+
+PrimitiveKind PrimitiveArrays::KindOf(const Hittable& object)
+{
+	if (dynamic_cast<const Sphere*>(&object)) return PrimitiveKind::Sphere;
+	if (dynamic_cast<const Quad*>(&object)) return PrimitiveKind::Quad;
+	return PrimitiveKind::Other;
+}
+
+void PrimitiveArrays::OrderLeaf(std::vector<Ref<Hittable>>& primitives, size_t first, size_t count)
+{
+	std::stable_sort(primitives.begin() + first, primitives.begin() + first + count,
+		[](const Ref<Hittable>& a, const Ref<Hittable>& b) { return KindOrder(a) < KindOrder(b); });
+}
+
+void PrimitiveArrays::Build(const std::vector<Ref<Hittable>>& primitives)
+{
+	*this = PrimitiveArrays();
+	m_Kinds.reserve(primitives.size());
+	m_Indices.reserve(primitives.size());
+
+	for (const Ref<Hittable>& primitive : primitives)
+	{
+		PrimitiveKind kind = KindOf(*primitive);
+		m_Kinds.push_back(kind);
+
+		if (kind == PrimitiveKind::Sphere)
+		{
+			const Sphere& sphere = static_cast<const Sphere&>(*primitive);
+			m_Indices.push_back((uint32_t)m_SphereMaterials.size());
+			m_CenterX.push_back(sphere.m_Center.x);
+			m_CenterY.push_back(sphere.m_Center.y);
+			m_CenterZ.push_back(sphere.m_Center.z);
+			m_MotionX.push_back(sphere.m_CenterVec.x);
+			m_MotionY.push_back(sphere.m_CenterVec.y);
+			m_MotionZ.push_back(sphere.m_CenterVec.z);
+			m_Radius.push_back(sphere.m_Radius);
+			m_SphereMaterials.push_back(sphere.m_MaterialPtr.get());
+		}
+		else if (kind == PrimitiveKind::Quad)
+		{
+			const Quad& quad = static_cast<const Quad&>(*primitive);
+			m_Indices.push_back((uint32_t)m_QuadMaterials.size());
+			m_CornerX.push_back(quad.m_StartingCorner.x);
+			m_CornerY.push_back(quad.m_StartingCorner.y);
+			m_CornerZ.push_back(quad.m_StartingCorner.z);
+			m_UX.push_back(quad.m_U.x);
+			m_UY.push_back(quad.m_U.y);
+			m_UZ.push_back(quad.m_U.z);
+			m_VX.push_back(quad.m_V.x);
+			m_VY.push_back(quad.m_V.y);
+			m_VZ.push_back(quad.m_V.z);
+			m_NormalX.push_back(quad.m_Normal.x);
+			m_NormalY.push_back(quad.m_Normal.y);
+			m_NormalZ.push_back(quad.m_Normal.z);
+			m_D.push_back(quad.m_D);
+			m_WX.push_back(quad.m_W.x);
+			m_WY.push_back(quad.m_W.y);
+			m_WZ.push_back(quad.m_W.z);
+			m_QuadMaterials.push_back(quad.m_Material.get());
+		}
+		else
+		{
+			m_Indices.push_back((uint32_t)m_Others.size());
+			m_Others.push_back(primitive.get());
+		}
+	}
+
+	for (std::vector<float>* values : { &m_CenterX, &m_CenterY, &m_CenterZ, &m_MotionX, &m_MotionY, &m_MotionZ, &m_Radius })
+		values->resize(values->size() + s_BatchPadding, 0.0f);
+
+	for (std::vector<float>* values : { &m_CornerX, &m_CornerY, &m_CornerZ, &m_UX, &m_UY, &m_UZ, &m_VX, &m_VY, &m_VZ,
+		&m_NormalX, &m_NormalY, &m_NormalZ, &m_D, &m_WX, &m_WY, &m_WZ })
+		values->resize(values->size() + s_BatchPadding, 0.0f);
+}
+
+void PrimitiveArrays::Build(const MeshData& mesh, const Material::Blank* material)
+{
+	*this = PrimitiveArrays();
+	m_Mesh = &mesh;
+	m_MeshMaterial = material;
+}
+
+size_t PrimitiveArrays::MemoryUsage() const
+{
+	size_t floats = 0;
+	for (const std::vector<float>* values : { &m_CenterX, &m_CenterY, &m_CenterZ, &m_MotionX, &m_MotionY, &m_MotionZ, &m_Radius,
+		&m_CornerX, &m_CornerY, &m_CornerZ, &m_UX, &m_UY, &m_UZ, &m_VX, &m_VY, &m_VZ, &m_NormalX, &m_NormalY, &m_NormalZ, &m_D, &m_WX, &m_WY, &m_WZ })
+		floats += values->capacity();
+
+	return floats * sizeof(float) + m_Kinds.capacity() * sizeof(PrimitiveKind) + m_Indices.capacity() * sizeof(uint32_t)
+		+ (m_SphereMaterials.capacity() + m_QuadMaterials.capacity() + m_Others.capacity()) * sizeof(void*);
+}
+
+bool PrimitiveArrays::Hit(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval, HitRecord& record) const
+{
+	if (m_Mesh)
+	{
+		float t;
+		glm::vec3 barycentrics;
+		int index = HitTriangles(first, count, ray, rayInterval, t, barycentrics);
+		if (index < 0)
+			return false;
+
+		m_Mesh->FillRecord((uint32_t)index, ray, t, barycentrics, m_MeshMaterial, record);
+		return true;
+	}
+
+	bool hitAnything = false;
+	uint32_t slot = first, end = first + count;
+
+	uint32_t sphereEnd = KindEnd(slot, end, PrimitiveKind::Sphere);
+	if (sphereEnd > slot)
+	{
+		float t;
+		int index = HitSpheres(m_Indices[slot], sphereEnd - slot, ray, rayInterval, t);
+		if (index >= 0)
+		{
+			FillSphereRecord((uint32_t)index, ray, t, record);
+			rayInterval.max(t);
+			hitAnything = true;
+		}
+		slot = sphereEnd;
+	}
+
+	uint32_t quadEnd = KindEnd(slot, end, PrimitiveKind::Quad);
+	if (quadEnd > slot)
+	{
+		float t, alpha, beta;
+		int index = HitQuads(m_Indices[slot], quadEnd - slot, ray, rayInterval, t, alpha, beta);
+		if (index >= 0)
+		{
+			FillQuadRecord((uint32_t)index, ray, t, alpha, beta, record);
+			rayInterval.max(t);
+			hitAnything = true;
+		}
+		slot = quadEnd;
+	}
+
+	for (; slot < end; slot++)
+	{
+		if (m_Others[m_Indices[slot]]->Hit(ray, rayInterval, record))
+		{
+			rayInterval.max(record.Intersection);
+			hitAnything = true;
+		}
+	}
+
+	return hitAnything;
+}
+
+bool PrimitiveArrays::Occluded(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval) const
+{
+	float t, alpha, beta;
+	glm::vec3 barycentrics;
+	if (m_Mesh)
+		return HitTriangles(first, count, ray, rayInterval, t, barycentrics) >= 0;
+
+	uint32_t slot = first, end = first + count;
+
+	uint32_t sphereEnd = KindEnd(slot, end, PrimitiveKind::Sphere);
+	if (sphereEnd > slot && HitSpheres(m_Indices[slot], sphereEnd - slot, ray, rayInterval, t) >= 0)
+		return true;
+	slot = sphereEnd;
+
+	uint32_t quadEnd = KindEnd(slot, end, PrimitiveKind::Quad);
+	if (quadEnd > slot && HitQuads(m_Indices[slot], quadEnd - slot, ray, rayInterval, t, alpha, beta) >= 0)
+		return true;
+	slot = quadEnd;
+
+	for (; slot < end; slot++)
+	{
+		if (m_Others[m_Indices[slot]]->Occluded(ray, rayInterval))
+			return true;
+	}
+
+	return false;
+}
+
+// The arithmetic follows Sphere::Hit operation by operation, so both find the same distances.
+int PrimitiveArrays::HitSpheres(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval, float& t) const
+{
+	const glm::vec3& origin = ray.Origin();
+	const glm::vec3& direction = ray.Direction();
+	const float a = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;
+	int closest = -1;
+
+	for (uint32_t batch = 0; batch < count; batch += 4)
+	{
+		uint32_t start = first + batch;
+		uint32_t lanes = std::min(count - batch, 4u);
+		RT_COUNT_ADD(PrimitiveTests, lanes);
+
+	#if RT_SIMD_X86
+		__m128 time = _mm_set1_ps(ray.time());
+		__m128 ocX = _mm_sub_ps(_mm_add_ps(Load(m_CenterX, start), _mm_mul_ps(time, Load(m_MotionX, start))), _mm_set1_ps(origin.x));
+		__m128 ocY = _mm_sub_ps(_mm_add_ps(Load(m_CenterY, start), _mm_mul_ps(time, Load(m_MotionY, start))), _mm_set1_ps(origin.y));
+		__m128 ocZ = _mm_sub_ps(_mm_add_ps(Load(m_CenterZ, start), _mm_mul_ps(time, Load(m_MotionZ, start))), _mm_set1_ps(origin.z));
+		__m128 radius = Load(m_Radius, start);
+
+		__m128 h = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(direction.x), ocX), _mm_mul_ps(_mm_set1_ps(direction.y), ocY)),
+			_mm_mul_ps(_mm_set1_ps(direction.z), ocZ));
+		__m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocX, ocX), _mm_mul_ps(ocY, ocY)), _mm_mul_ps(ocZ, ocZ)), _mm_mul_ps(radius, radius));
+		__m128 discriminant = _mm_sub_ps(_mm_mul_ps(h, h), _mm_mul_ps(_mm_set1_ps(a), c));
+		__m128 valid = _mm_cmpge_ps(discriminant, _mm_setzero_ps());
+
+		__m128 sqrtd = _mm_sqrt_ps(_mm_max_ps(discriminant, _mm_setzero_ps()));
+		__m128 nearRoot = _mm_div_ps(_mm_sub_ps(h, sqrtd), _mm_set1_ps(a));
+		__m128 farRoot = _mm_div_ps(_mm_add_ps(h, sqrtd), _mm_set1_ps(a));
+
+		__m128 tMin = _mm_set1_ps(rayInterval.min()), tMax = _mm_set1_ps(rayInterval.max());
+		__m128 nearInside = _mm_and_ps(_mm_cmpgt_ps(nearRoot, tMin), _mm_cmplt_ps(nearRoot, tMax));
+		__m128 farInside = _mm_and_ps(_mm_cmpgt_ps(farRoot, tMin), _mm_cmplt_ps(farRoot, tMax));
+		__m128 root = _mm_or_ps(_mm_and_ps(nearInside, nearRoot), _mm_andnot_ps(nearInside, farRoot));
+		__m128 hit = _mm_and_ps(valid, _mm_or_ps(nearInside, farInside));
+
+		int mask = _mm_movemask_ps(hit) & ((1 << lanes) - 1);
+		if (mask == 0) continue;
+
+		__m128 laneHit = LaneMask(mask);
+		float batchClosest;
+		int lane = ClosestLane(_mm_or_ps(_mm_and_ps(laneHit, root), _mm_andnot_ps(laneHit, _mm_set1_ps(INFINITY))), false, batchClosest);
+		t = batchClosest;
+	#else
+		int lane = -1;
+		for (uint32_t i = 0; i < lanes; i++)
+		{
+			uint32_t index = start + i;
+			glm::vec3 center = glm::vec3(m_CenterX[index], m_CenterY[index], m_CenterZ[index])
+				+ ray.time() * glm::vec3(m_MotionX[index], m_MotionY[index], m_MotionZ[index]);
+			glm::vec3 oc = center - origin;
+			float h = glm::dot(direction, oc);
+			float c = oc.x * oc.x + oc.y * oc.y + oc.z * oc.z - m_Radius[index] * m_Radius[index];
+
+			float discriminant = h * h - a * c;
+			if (discriminant < 0) continue;
+			float sqrtd = std::sqrt(discriminant);
+
+			float root = (h - sqrtd) / a;
+			if (!rayInterval.Surrounds(root))
+			{
+				root = (h + sqrtd) / a;
+				if (!rayInterval.Surrounds(root)) continue;
+			}
+
+			rayInterval.max(root);
+			t = root;
+			lane = (int)i;
+		}
+		if (lane < 0) continue;
+	#endif
+
+		closest = (int)start + lane;
+		rayInterval.max(t);
+	}
+
+	return closest;
+}
+
+// Follows Quad::Hit the same way
+int PrimitiveArrays::HitQuads(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval, float& t, float& alpha, float& beta) const
+{
+	const glm::vec3& origin = ray.Origin();
+	const glm::vec3& direction = ray.Direction();
+	int closest = -1;
+
+	for (uint32_t batch = 0; batch < count; batch += 4)
+	{
+		uint32_t start = first + batch;
+		uint32_t lanes = std::min(count - batch, 4u);
+		RT_COUNT_ADD(PrimitiveTests, lanes);
+
+	#if RT_SIMD_X86
+		__m128 normalX = Load(m_NormalX, start), normalY = Load(m_NormalY, start), normalZ = Load(m_NormalZ, start);
+		__m128 denominator = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, _mm_set1_ps(direction.x)), _mm_mul_ps(normalY, _mm_set1_ps(direction.y))),
+			_mm_mul_ps(normalZ, _mm_set1_ps(direction.z)));
+		__m128 absDenominator = _mm_andnot_ps(_mm_set1_ps(-0.0f), denominator);
+		__m128 valid = _mm_cmpge_ps(absDenominator, _mm_set1_ps(1e-8f));
+
+		__m128 normalDotOrigin = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, _mm_set1_ps(origin.x)), _mm_mul_ps(normalY, _mm_set1_ps(origin.y))),
+			_mm_mul_ps(normalZ, _mm_set1_ps(origin.z)));
+		__m128 distance = _mm_div_ps(_mm_sub_ps(Load(m_D, start), normalDotOrigin), denominator);
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(distance, _mm_set1_ps(rayInterval.min())), _mm_cmple_ps(distance, _mm_set1_ps(rayInterval.max()))));
+
+		// Hit point relative to the corner, then its plane coordinates
+		__m128 pX = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(origin.x), _mm_mul_ps(distance, _mm_set1_ps(direction.x))), Load(m_CornerX, start));
+		__m128 pY = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(origin.y), _mm_mul_ps(distance, _mm_set1_ps(direction.y))), Load(m_CornerY, start));
+		__m128 pZ = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(origin.z), _mm_mul_ps(distance, _mm_set1_ps(direction.z))), Load(m_CornerZ, start));
+
+		__m128 uX = Load(m_UX, start), uY = Load(m_UY, start), uZ = Load(m_UZ, start);
+		__m128 vX = Load(m_VX, start), vY = Load(m_VY, start), vZ = Load(m_VZ, start);
+		__m128 wX = Load(m_WX, start), wY = Load(m_WY, start), wZ = Load(m_WZ, start);
+
+		__m128 pvX = _mm_sub_ps(_mm_mul_ps(pY, vZ), _mm_mul_ps(vY, pZ));
+		__m128 pvY = _mm_sub_ps(_mm_mul_ps(pZ, vX), _mm_mul_ps(vZ, pX));
+		__m128 pvZ = _mm_sub_ps(_mm_mul_ps(pX, vY), _mm_mul_ps(vX, pY));
+		__m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(wX, pvX), _mm_mul_ps(wY, pvY)), _mm_mul_ps(wZ, pvZ));
+
+		__m128 upX = _mm_sub_ps(_mm_mul_ps(uY, pZ), _mm_mul_ps(pY, uZ));
+		__m128 upY = _mm_sub_ps(_mm_mul_ps(uZ, pX), _mm_mul_ps(pZ, uX));
+		__m128 upZ = _mm_sub_ps(_mm_mul_ps(uX, pY), _mm_mul_ps(pX, uY));
+		__m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(wX, upX), _mm_mul_ps(wY, upY)), _mm_mul_ps(wZ, upZ));
+
+		__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(a, zero), _mm_cmple_ps(a, one)));
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(b, zero), _mm_cmple_ps(b, one)));
+
+		int mask = _mm_movemask_ps(valid) & ((1 << lanes) - 1);
+		if (mask == 0) continue;
+
+		__m128 laneHit = LaneMask(mask);
+		float batchClosest;
+		int lane = ClosestLane(_mm_or_ps(_mm_and_ps(laneHit, distance), _mm_andnot_ps(laneHit, _mm_set1_ps(INFINITY))), true, batchClosest);
+
+		alignas(16) float alphas[4], betas[4];
+		_mm_store_ps(alphas, a);
+		_mm_store_ps(betas, b);
+		t = batchClosest;
+		alpha = alphas[lane];
+		beta = betas[lane];
+	#else
+		int lane = -1;
+		for (uint32_t i = 0; i < lanes; i++)
+		{
+			uint32_t index = start + i;
+			glm::vec3 normal(m_NormalX[index], m_NormalY[index], m_NormalZ[index]);
+			float denominator = glm::dot(normal, direction);
+			if (std::fabs(denominator) < 1e-8f) continue;
+
+			float distance = (m_D[index] - glm::dot(normal, origin)) / denominator;
+			if (!rayInterval.Contains(distance)) continue;
+
+			glm::vec3 planarHitpointVector = ray.At(distance) - glm::vec3(m_CornerX[index], m_CornerY[index], m_CornerZ[index]);
+			glm::vec3 u(m_UX[index], m_UY[index], m_UZ[index]), v(m_VX[index], m_VY[index], m_VZ[index]), w(m_WX[index], m_WY[index], m_WZ[index]);
+			float a = glm::dot(w, glm::cross(planarHitpointVector, v));
+			float b = glm::dot(w, glm::cross(u, planarHitpointVector));
+			if (a < 0.0f || a > 1.0f || b < 0.0f || b > 1.0f) continue;
+
+			// Quads take later hits at the same distance, Interval::Contains is inclusive
+			rayInterval.max(distance);
+			t = distance;
+			alpha = a;
+			beta = b;
+			lane = (int)i;
+		}
+		if (lane < 0) continue;
+	#endif
+
+		closest = (int)start + lane;
+		rayInterval.max(t);
+	}
+
+	return closest;
+}
+
+// WatertightRay::Intersect four at a time, on the corners of four triangles gathered from the
+// mesh. Batches where a lane's edge function comes out exactly zero are redone by
+// WatertightRay::Intersect itself, which settles those in double precision.
+int PrimitiveArrays::HitTriangles(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval, float& t, glm::vec3& barycentrics) const
+{
+	const WatertightRay sheared(ray);
+	int closest = -1;
+
+	for (uint32_t batch = 0; batch < count; batch += 4)
+	{
+		uint32_t start = first + batch;
+		uint32_t lanes = std::min(count - batch, 4u);
+		RT_COUNT_ADD(PrimitiveTests, lanes);
+		int lane = -1;
+
+	#if RT_SIMD_X86
+		const glm::vec3& origin = ray.Origin();
+		__m128 originX = _mm_set1_ps(origin[sheared.Kx]), originY = _mm_set1_ps(origin[sheared.Ky]), originZ = _mm_set1_ps(origin[sheared.Kz]);
+		__m128 shearX = _mm_set1_ps(sheared.Sx), shearY = _mm_set1_ps(sheared.Sy), shearZ = _mm_set1_ps(sheared.Sz);
+
+		// Per corner and axis, one lane per triangle. Lanes past the last triangle stay zero and are masked off.
+		alignas(16) float corners[3][3][4] = {};
+		for (uint32_t i = 0; i < lanes; i++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const glm::vec3& position = m_Mesh->Vertex(start + i, corner);
+				for (int axis = 0; axis < 3; axis++)
+					corners[corner][axis][i] = position[axis];
+			}
+		}
+
+		__m128 aZ = _mm_sub_ps(_mm_load_ps(corners[0][sheared.Kz]), originZ);
+		__m128 bZ = _mm_sub_ps(_mm_load_ps(corners[1][sheared.Kz]), originZ);
+		__m128 cZ = _mm_sub_ps(_mm_load_ps(corners[2][sheared.Kz]), originZ);
+
+		__m128 aX = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(corners[0][sheared.Kx]), originX), _mm_mul_ps(shearX, aZ));
+		__m128 aY = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(corners[0][sheared.Ky]), originY), _mm_mul_ps(shearY, aZ));
+		__m128 bX = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(corners[1][sheared.Kx]), originX), _mm_mul_ps(shearX, bZ));
+		__m128 bY = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(corners[1][sheared.Ky]), originY), _mm_mul_ps(shearY, bZ));
+		__m128 cX = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(corners[2][sheared.Kx]), originX), _mm_mul_ps(shearX, cZ));
+		__m128 cY = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(corners[2][sheared.Ky]), originY), _mm_mul_ps(shearY, cZ));
+
+		__m128 u = _mm_sub_ps(_mm_mul_ps(cX, bY), _mm_mul_ps(cY, bX));
+		__m128 v = _mm_sub_ps(_mm_mul_ps(aX, cY), _mm_mul_ps(aY, cX));
+		__m128 w = _mm_sub_ps(_mm_mul_ps(bX, aY), _mm_mul_ps(bY, aX));
+
+		__m128 zero = _mm_setzero_ps();
+		int laneMask = (1 << lanes) - 1;
+		int zeroEdges = _mm_movemask_ps(_mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(u, zero), _mm_cmpeq_ps(v, zero)), _mm_cmpeq_ps(w, zero)));
+		if ((zeroEdges & laneMask) == 0)
+		{
+			__m128 anyNegative = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmplt_ps(v, zero)), _mm_cmplt_ps(w, zero));
+			__m128 anyPositive = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(u, zero), _mm_cmpgt_ps(v, zero)), _mm_cmpgt_ps(w, zero));
+			__m128 determinant = _mm_add_ps(_mm_add_ps(u, v), w);
+			__m128 valid = _mm_andnot_ps(_mm_and_ps(anyNegative, anyPositive), _mm_cmpneq_ps(determinant, zero));
+
+			__m128 scaledDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(u, _mm_mul_ps(shearZ, aZ)), _mm_mul_ps(v, _mm_mul_ps(shearZ, bZ))),
+				_mm_mul_ps(w, _mm_mul_ps(shearZ, cZ)));
+			__m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+			__m128 distance = _mm_mul_ps(scaledDistance, inverseDeterminant);
+			valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(distance, _mm_set1_ps(rayInterval.min())), _mm_cmplt_ps(distance, _mm_set1_ps(rayInterval.max()))));
+
+			int mask = _mm_movemask_ps(valid) & laneMask;
+			if (mask == 0) continue;
+
+			__m128 laneHit = LaneMask(mask);
+			lane = ClosestLane(_mm_or_ps(_mm_and_ps(laneHit, distance), _mm_andnot_ps(laneHit, _mm_set1_ps(INFINITY))), false, t);
+
+			alignas(16) float us[4], vs[4], ws[4], inverses[4];
+			_mm_store_ps(us, u);
+			_mm_store_ps(vs, v);
+			_mm_store_ps(ws, w);
+			_mm_store_ps(inverses, inverseDeterminant);
+			barycentrics = glm::vec3(us[lane] * inverses[lane], vs[lane] * inverses[lane], ws[lane] * inverses[lane]);
+		}
+		else
+	#endif
+		{
+			for (uint32_t i = 0; i < lanes; i++)
+			{
+				uint32_t triangle = start + i;
+				if (sheared.Intersect(m_Mesh->Vertex(triangle, 0), m_Mesh->Vertex(triangle, 1), m_Mesh->Vertex(triangle, 2), ray, rayInterval, t, barycentrics))
+				{
+					rayInterval.max(t);
+					lane = (int)i;
+				}
+			}
+			if (lane < 0) continue;
+		}
+
+		closest = (int)start + lane;
+		rayInterval.max(t);
+	}
+
+	return closest;
+}
+
+void PrimitiveArrays::FillSphereRecord(uint32_t index, const Ray& ray, float t, HitRecord& record) const
+{
+	glm::vec3 center = glm::vec3(m_CenterX[index], m_CenterY[index], m_CenterZ[index])
+		+ ray.time() * glm::vec3(m_MotionX[index], m_MotionY[index], m_MotionZ[index]);
+
+	record.Intersection = t;
+	record.Point = ray.At(t);
+	glm::vec3 outwardNormal = (record.Point - center) / m_Radius[index];
+	record.SetFaceNormal(ray, outwardNormal);
+	Sphere::GetSphereUV(outwardNormal, record.U, record.V);
+	record.UVScale = Sphere::UVScale(m_Radius[index]);
+	record.MaterialPtr = m_SphereMaterials[index];
+}
+
+void PrimitiveArrays::FillQuadRecord(uint32_t index, const Ray& ray, float t, float alpha, float beta, HitRecord& record) const
+{
+	record.Intersection = t;
+	record.Point = ray.At(t);
+	record.U = alpha;
+	record.V = beta;
+	// w is the normal over its squared length, the length of u x v is the area
+	record.UVScale = std::sqrt(glm::length(glm::vec3(m_WX[index], m_WY[index], m_WZ[index])));
+	record.MaterialPtr = m_QuadMaterials[index];
+	record.SetFaceNormal(ray, glm::vec3(m_NormalX[index], m_NormalY[index], m_NormalZ[index]));
+}
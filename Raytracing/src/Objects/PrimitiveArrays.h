@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+#include "Objects/Hittable.h"
+
+struct MeshData;
+
+enum class PrimitiveKind : uint8_t
+{
+	Sphere,
+	Quad,
+	Other    // Any other hittable, intersected through its virtual Hit
+};
+
+// Structure of arrays copy of the spheres and quads of a BVH, so a leaf can intersect all of its
+// primitives of one kind at once, four per SIMD batch, without a virtual call or pointer chase
+// per primitive. Slots are the positions in the BVH's primitive order. The primitives of one
+// kind have to be in adjacent slots of a leaf (OrderLeaf sorts them), their data then sits in
+// adjacent entries of the arrays as well.
+//
+// The hierarchy of a triangle mesh has no primitive objects, its slots are the mesh's triangles
+// themselves, whose vertices are read straight from the mesh's buffers.
+class PrimitiveArrays
+{
+public:
+	static PrimitiveKind KindOf(const Hittable& object);
+
+	// Spheres first, then quads, then everything else
+	static void OrderLeaf(std::vector<Ref<Hittable>>& primitives, size_t first, size_t count);
+
+	void Build(const std::vector<Ref<Hittable>>& primitives);
+	// Slots are the mesh's triangles, which all share the material
+	void Build(const MeshData& mesh, const Material::Blank* material);
+
+	// Closest hit among the slots [first, first + count)
+	bool Hit(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval, HitRecord& record) const;
+	bool Occluded(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval) const;
+
+	size_t SphereCount() const { return m_SphereMaterials.size(); }
+	size_t QuadCount() const { return m_QuadMaterials.size(); }
+	size_t MemoryUsage() const;
+
+private:
+	// Each returns the index of the closest hit and sets its distance, or returns -1
+	int HitSpheres(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval, float& t) const;
+	int HitQuads(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval, float& t, float& alpha, float& beta) const;
+	int HitTriangles(uint32_t first, uint32_t count, const Ray& ray, Interval rayInterval, float& t, glm::vec3& barycentrics) const;
+
+	// End of the run of slots of the given kind that starts at slot
+	uint32_t KindEnd(uint32_t slot, uint32_t end, PrimitiveKind kind) const
+	{
+		while (slot < end && m_Kinds[slot] == kind)
+			slot++;
+		return slot;
+	}
+
+	void FillSphereRecord(uint32_t index, const Ray& ray, float t, HitRecord& record) const;
+	void FillQuadRecord(uint32_t index, const Ray& ray, float t, float alpha, float beta, HitRecord& record) const;
+
+private:
+	// Per slot: index into the arrays of its kind
+	std::vector<PrimitiveKind> m_Kinds;
+	std::vector<uint32_t> m_Indices;
+
+	// Spheres, padded to a multiple of four so batches never read past the end
+	std::vector<float> m_CenterX, m_CenterY, m_CenterZ;
+	std::vector<float> m_MotionX, m_MotionY, m_MotionZ;
+	std::vector<float> m_Radius;
+	std::vector<const Material::Blank*> m_SphereMaterials;
+
+	// Quads, padded the same way
+	std::vector<float> m_CornerX, m_CornerY, m_CornerZ;
+	std::vector<float> m_UX, m_UY, m_UZ;
+	std::vector<float> m_VX, m_VY, m_VZ;
+	std::vector<float> m_NormalX, m_NormalY, m_NormalZ;
+	std::vector<float> m_D;
+	std::vector<float> m_WX, m_WY, m_WZ;
+	std::vector<const Material::Blank*> m_QuadMaterials;
+
+	// Set instead of all of the above for the hierarchy of a mesh
+	const MeshData* m_Mesh = nullptr;
+	const Material::Blank* m_MeshMaterial = nullptr;
+
+	std::vector<const Hittable*> m_Others;
+};
@@ -1,5 +1,7 @@
 #include "rtpch.h"
 #include "Quad.h"
+#include "Core/Statistics.h"
+#include "Objects/Material.h"
 
 Quad::Quad(const glm::vec3& startingCorner, const glm::vec3& u, const glm::vec3& v, Ref<Material::Blank> material)
 	: m_StartingCorner(startingCorner), m_U(u), m_V(v), m_Material(material)
@@ -8,6 +10,7 @@ Quad::Quad(const glm::vec3& startingCorner, const glm::vec3& u, const glm::vec3&
 	m_Normal = glm::normalize(normal);
 	m_D = glm::dot(m_Normal, m_StartingCorner);
 	m_W = normal / glm::dot(normal, normal);
+	m_Area = glm::length(normal);
 
 	SetBoundingBox();
 }
@@ -17,6 +20,7 @@ void Quad::SetBoundingBox()
 	AABB boundingBoxDiagonal1 = AABB(m_StartingCorner, m_StartingCorner + m_U + m_V);
 	AABB boundingBoxDiagonal2 = AABB(m_StartingCorner + m_U, m_StartingCorner + m_V);
 	m_BoundingBox = AABB(boundingBoxDiagonal1, boundingBoxDiagonal2);
+	m_BoundingBox.PadToMinimums();
 }
 
 bool Quad::IsInterior(float a, float b, HitRecord& record) const
@@ -29,11 +33,13 @@ bool Quad::IsInterior(float a, float b, HitRecord& record) const
 
 	record.U = a;
 	record.V = b;
+	record.UVScale = 1.0f / std::sqrt(m_Area);
 	return true;
 }
 
 bool Quad::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
 {
+	RT_COUNT(PrimitiveTests);
 	float denominator = glm::dot(m_Normal, ray.Direction());
 
 	// No hit if the ray is parallel to the plane.
@@ -54,12 +60,51 @@ bool Quad::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
 	// Ray hits the 2D shape; set the rest of the hir record and return true;
 	record.Intersection = t;
 	record.Point = intersectionPoint;
-	record.MaterialPtr = m_Material;
+	record.MaterialPtr = m_Material.get();
 	record.SetFaceNormal(ray, m_Normal);
 
 	return true;
 }
 
+bool Quad::Occluded(const Ray& ray, Interval rayInterval) const
+{
+	RT_COUNT(PrimitiveTests);
+	float denominator = glm::dot(m_Normal, ray.Direction());
+	if (std::fabs(denominator) < 1e-8f) return false;
+
+	float t = (m_D - glm::dot(m_Normal, ray.Origin())) / denominator;
+	if (!rayInterval.Contains(t)) return false;
+
+	glm::vec3 planarHitpointVector = ray.At(t) - m_StartingCorner;
+	float alpha = glm::dot(m_W, glm::cross(planarHitpointVector, m_V));
+	float beta = glm::dot(m_W, glm::cross(m_U, planarHitpointVector));
+
+	Interval unitInterval = Interval(0.0f, 1.0f);
+	return unitInterval.Contains(alpha) && unitInterval.Contains(beta);
+}
+
+bool Quad::IsLight() const
+{
+	return m_Material && m_Material->IsEmissive();
+}
+
+float Quad::PDFValue(const Ray& ray, Interval rayInterval) const
+{
+	HitRecord record;
+	if (!Hit(ray, rayInterval, record)) return 0.0f;
+
+	// Converts the uniform density over the area into a density over solid angle
+	float length = glm::length(ray.Direction());
+	float distance = record.Intersection * length;
+	float cosine = std::fabs(glm::dot(ray.Direction(), m_Normal)) / length;
+	return distance * distance / (cosine * m_Area);
+}
+
+glm::vec3 Quad::SampleDirection(const glm::vec3& origin, float time, const glm::vec2& u) const
+{
+	return m_StartingCorner + u.x * m_U + u.y * m_V - origin;
+}
+
 Ref<HittableList> Box(const glm::vec3& a, const glm::vec3& b, Ref<Material::Blank> material)
 {
 	// Returns the 3D box (six sides) that contains the two opposite vertices a & b.
@@ -5,6 +5,9 @@
 
 class Quad : public Hittable
 {
+	// Copies the shape into its SoA arrays and fills records from them
+	friend class PrimitiveArrays;
+
 public:
 	Quad(const glm::vec3& startingCorner, const glm::vec3& u, const glm::vec3& v, Ref<Material::Blank> material);
 
@@ -12,14 +15,22 @@ public:
 	virtual bool IsInterior(float a, float b, HitRecord& record) const;
 
 	bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const override;
+	bool Occluded(const Ray& ray, Interval rayInterval) const override;
 
 	AABB BoundingBox() const override { return m_BoundingBox; }
+	void CollectMemory(SceneMemory& memory) const override { memory.Add(this, sizeof(*this)); }
+
+	bool IsLight() const override;
+	float PDFValue(const Ray& ray, Interval rayInterval) const override;
+	// Uniform over the quad's area
+	glm::vec3 SampleDirection(const glm::vec3& origin, float time, const glm::vec2& u) const override;
 
 private:
 	glm::vec3 m_StartingCorner;
 	glm::vec3 m_U, m_V, m_W;
 	glm::vec3 m_Normal;
 	float m_D;
+	float m_Area;
 
 	Ref<Material::Blank> m_Material;
 	AABB m_BoundingBox;
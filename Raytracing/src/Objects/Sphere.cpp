@@ -1,6 +1,8 @@
 #include "rtpch.h"
 #include "Objects/Sphere.h"
 #include "Math/MathUtil.h"
+#include "Objects/Material.h"
+#include "Core/Statistics.h"
 
 Sphere::Sphere(const glm::vec3& center, float radius, std::shared_ptr<Material::Blank> material)
     : m_Center(center), m_Radius((float)std::fmax(0, radius)), m_MaterialPtr(material), m_Moving(false)
@@ -24,6 +26,7 @@ Sphere::Sphere(const glm::vec3& center1, const glm::vec3& center2, double radius
 
 bool Sphere::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
 {
+    RT_COUNT(PrimitiveTests);
     glm::vec3 center = m_Moving ? SphereCenter(ray.time()) : m_Center;
     glm::vec3 oc = center - ray.Origin();
     float a = ray.Direction().x * ray.Direction().x + ray.Direction().y * ray.Direction().y + ray.Direction().z * ray.Direction().z;
@@ -46,11 +49,64 @@ bool Sphere::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
     glm::vec3 outwardNormal = (record.Point - center) / m_Radius;
     record.SetFaceNormal(ray, outwardNormal);
     GetSphereUV(outwardNormal, record.U, record.V);
-    record.MaterialPtr = m_MaterialPtr;
+    record.UVScale = UVScale(m_Radius);
+    record.MaterialPtr = m_MaterialPtr.get();
 
     return true;
 }
 
+bool Sphere::Occluded(const Ray& ray, Interval rayInterval) const
+{
+    RT_COUNT(PrimitiveTests);
+    glm::vec3 center = m_Moving ? SphereCenter(ray.time()) : m_Center;
+    glm::vec3 oc = center - ray.Origin();
+    float a = glm::dot(ray.Direction(), ray.Direction());
+    float h = glm::dot(ray.Direction(), oc);
+    float c = glm::dot(oc, oc) - m_Radius * m_Radius;
+
+    float discriminant = h * h - a * c;
+    if (discriminant < 0) return false;
+    float sqrtd = std::sqrt(discriminant);
+
+    return rayInterval.Surrounds((h - sqrtd) / a) || rayInterval.Surrounds((h + sqrtd) / a);
+}
+
+bool Sphere::IsLight() const
+{
+    return m_MaterialPtr && m_MaterialPtr->IsEmissive();
+}
+
+float Sphere::PDFValue(const Ray& ray, Interval rayInterval) const
+{
+    HitRecord record;
+    if (!Hit(ray, rayInterval, record)) return 0.0f;
+
+    // From inside every direction hits, SampleDirection falls back to the whole sphere of directions.
+    glm::vec3 center = m_Moving ? SphereCenter(ray.time()) : m_Center;
+    float distanceSquared = glm::dot(center - ray.Origin(), center - ray.Origin());
+    if (distanceSquared <= m_Radius * m_Radius) return 1.0f / (4.0f * PI);
+
+    float cosThetaMax = std::sqrt(1.0f - m_Radius * m_Radius / distanceSquared);
+    return 1.0f / (2.0f * PI * (1.0f - cosThetaMax));
+}
+
+glm::vec3 Sphere::SampleDirection(const glm::vec3& origin, float time, const glm::vec2& u) const
+{
+    glm::vec3 center = m_Moving ? SphereCenter(time) : m_Center;
+    glm::vec3 toCenter = center - origin;
+    float distanceSquared = glm::dot(toCenter, toCenter);
+    if (distanceSquared <= m_Radius * m_Radius) return MathUtil::SampleSphere(u);
+
+    float cosThetaMax = std::sqrt(1.0f - m_Radius * m_Radius / distanceSquared);
+    float cosTheta = 1.0f + u.x * (cosThetaMax - 1.0f);
+    float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    float phi = 2.0f * PI * u.y;
+
+    glm::vec3 w = toCenter / std::sqrt(distanceSquared);
+    glm::vec3 t, b;
+    MathUtil::OrthonormalBasis(w, t, b);
+    return std::cos(phi) * sinTheta * t + std::sin(phi) * sinTheta * b + cosTheta * w;
+}
 
 void Sphere::GetSphereUV(const glm::vec3& point, float& u, float& v)
 {
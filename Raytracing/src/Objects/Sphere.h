@@ -1,18 +1,30 @@
 #pragma once
 
-#include "Objects\Hittable.h"
+#include "Objects/Hittable.h"
 
-#include "glm\glm.hpp"
+#include "glm/glm.hpp"
+
+#include "Math/MathUtil.h"
 
 class Sphere : public Hittable 
 {
+    // Copies the shape into its SoA arrays and fills records from them
+    friend class PrimitiveArrays;
+
 public:
     Sphere(const glm::vec3& center, float radius, std::shared_ptr<Material::Blank> material);
     Sphere(const glm::vec3& center1, const glm::vec3& center2, double radius, std::shared_ptr<Material::Blank> material);
 
     bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const override;
+    bool Occluded(const Ray& ray, Interval rayInterval) const override;
 
     AABB BoundingBox() const override { return m_BoundingBox; }
+    void CollectMemory(SceneMemory& memory) const override { memory.Add(this, sizeof(*this)); }
+
+    bool IsLight() const override;
+    float PDFValue(const Ray& ray, Interval rayInterval) const override;
+    // Uniform over the cone of directions the sphere covers as seen from origin
+    glm::vec3 SampleDirection(const glm::vec3& origin, float time, const glm::vec2& u) const override;
 
 private:
     glm::vec3 SphereCenter(float time) const { return m_Center + time * m_CenterVec; }
@@ -28,6 +40,8 @@ private:
     * @param v returned value [0,1] of angle from Y=-1 to Y=+1.
     */
     static void GetSphereUV(const glm::vec3& point, float& u, float& v);
+    // The UVs cover the unit square once over the surface area of 4 pi r^2
+    static float UVScale(float radius) { return 0.5f / (std::sqrt(PI) * radius); }
 
 private:
     glm::vec3 m_Center;
@@ -0,0 +1,168 @@
+#include "rtpch.h"
+#include "Objects/TriangleMesh.h"
+
+#include "Math/BVH.h"
+
+size_t MeshData::MemoryUsage() const
+{
+	return Positions.capacity() * sizeof(glm::vec3) + Normals.capacity() * sizeof(glm::vec3)
+		+ UVs.capacity() * sizeof(glm::vec2) + Indices.capacity() * sizeof(uint32_t);
+}
+
+WatertightRay::WatertightRay(const Ray& ray)
+{
+	// The largest component of the direction becomes z, swapping x and y keeps the winding
+	const glm::vec3& direction = ray.Direction();
+	glm::vec3 magnitude = glm::abs(direction);
+	Kz = magnitude.x > magnitude.y ? (magnitude.x > magnitude.z ? 0 : 2) : (magnitude.y > magnitude.z ? 1 : 2);
+	Kx = (Kz + 1) % 3;
+	Ky = (Kx + 1) % 3;
+	if (direction[Kz] < 0.0f)
+		std::swap(Kx, Ky);
+
+	Sx = direction[Kx] / direction[Kz];
+	Sy = direction[Ky] / direction[Kz];
+	Sz = 1.0f / direction[Kz];
+}
+
+bool WatertightRay::Intersect(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const Ray& ray, Interval rayInterval,
+	float& t, glm::vec3& barycentrics) const
+{
+	const glm::vec3 a = p0 - ray.Origin();
+	const glm::vec3 b = p1 - ray.Origin();
+	const glm::vec3 c = p2 - ray.Origin();
+
+	const float ax = a[Kx] - Sx * a[Kz];
+	const float ay = a[Ky] - Sy * a[Kz];
+	const float bx = b[Kx] - Sx * b[Kz];
+	const float by = b[Ky] - Sy * b[Kz];
+	const float cx = c[Kx] - Sx * c[Kz];
+	const float cy = c[Ky] - Sy * c[Kz];
+
+	// Scaled barycentric coordinates, edge functions of the opposite edges
+	float u = cx * by - cy * bx;
+	float v = ax * cy - ay * cx;
+	float w = bx * ay - by * ax;
+
+	// A ray through an edge or vertex is decided in double precision, so it lands on exactly one side
+	if (u == 0.0f || v == 0.0f || w == 0.0f)
+	{
+		u = (float)((double)cx * by - (double)cy * bx);
+		v = (float)((double)ax * cy - (double)ay * cx);
+		w = (float)((double)bx * ay - (double)by * ax);
+	}
+
+	if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f)) return false;
+
+	const float determinant = u + v + w;
+	if (determinant == 0.0f) return false;
+
+	const float az = Sz * a[Kz];
+	const float bz = Sz * b[Kz];
+	const float cz = Sz * c[Kz];
+	const float scaledDistance = u * az + v * bz + w * cz;
+
+	// t and barycentrics may hold a closer hit found earlier, so they are only written on a hit
+	const float inverseDeterminant = 1.0f / determinant;
+	const float distance = scaledDistance * inverseDeterminant;
+	if (!rayInterval.Surrounds(distance)) return false;
+
+	t = distance;
+	barycentrics = glm::vec3(u * inverseDeterminant, v * inverseDeterminant, w * inverseDeterminant);
+	return true;
+}
+
+AABB MeshData::TriangleBounds(uint32_t triangle) const
+{
+	const glm::vec3& p0 = Vertex(triangle, 0);
+	const glm::vec3& p1 = Vertex(triangle, 1);
+	const glm::vec3& p2 = Vertex(triangle, 2);
+	AABB box(glm::min(p0, glm::min(p1, p2)), glm::max(p0, glm::max(p1, p2)));
+	box.PadToMinimums();
+	return box;
+}
+
+void MeshData::FillRecord(uint32_t triangle, const Ray& ray, float t, const glm::vec3& barycentrics, const Material::Blank* material,
+	HitRecord& record) const
+{
+	const uint32_t* indices = &Indices[3 * triangle];
+	const glm::vec3& p0 = Positions[indices[0]];
+	const glm::vec3& p1 = Positions[indices[1]];
+	const glm::vec3& p2 = Positions[indices[2]];
+
+	record.Intersection = t;
+	record.Point = ray.At(t);
+	record.MaterialPtr = material;
+
+	// The side is decided by the geometric normal, vertex normals only shade
+	glm::vec3 normal = glm::normalize(glm::cross(p1 - p0, p2 - p0));
+	record.FrontFace = glm::dot(ray.Direction(), normal) < 0.0f;
+
+	if (!Normals.empty())
+	{
+		glm::vec3 shading = barycentrics.x * Normals[indices[0]] + barycentrics.y * Normals[indices[1]]
+			+ barycentrics.z * Normals[indices[2]];
+		if (glm::dot(shading, shading) > 0.0f)
+		{
+			shading = glm::normalize(shading);
+			normal = glm::dot(shading, normal) < 0.0f ? -shading : shading;
+		}
+	}
+	record.Normal = record.FrontFace ? normal : -normal;
+
+	float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+	if (!UVs.empty())
+	{
+		const glm::vec2& uv0 = UVs[indices[0]];
+		const glm::vec2& uv1 = UVs[indices[1]];
+		const glm::vec2& uv2 = UVs[indices[2]];
+		glm::vec2 uv = barycentrics.x * uv0 + barycentrics.y * uv1 + barycentrics.z * uv2;
+		record.U = uv.x;
+		record.V = uv.y;
+
+		glm::vec2 edge1 = uv1 - uv0, edge2 = uv2 - uv0;
+		float uvArea = std::fabs(edge1.x * edge2.y - edge1.y * edge2.x);
+		record.UVScale = area > 0.0f ? std::sqrt(uvArea / area) : 0.0f;
+	}
+	else
+	{
+		// The barycentric UVs span half the unit square
+		record.U = barycentrics.y;
+		record.V = barycentrics.z;
+		record.UVScale = area > 0.0f ? std::sqrt(1.0f / area) : 0.0f;
+	}
+}
+
+TriangleMesh::TriangleMesh(Ref<MeshData> data, Ref<Material::Blank> material)
+	: m_Data(data), m_Material(material)
+{
+	m_BVH = CreateScope<BVHNode>(*m_Data, m_Material.get());
+	m_BoundingBox = m_BVH->BoundingBox();
+}
+
+// Defined here, where BVHNode is a complete type
+TriangleMesh::~TriangleMesh() = default;
+
+bool TriangleMesh::Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const
+{
+	return m_BVH->Hit(ray, rayInterval, record);
+}
+
+bool TriangleMesh::Occluded(const Ray& ray, Interval rayInterval) const
+{
+	return m_BVH->Occluded(ray, rayInterval);
+}
+
+void TriangleMesh::CollectMemory(SceneMemory& memory) const
+{
+	if (!memory.Add(this, sizeof(*this)))
+		return;
+
+	memory.Add(m_Data.get(), m_Data->MemoryUsage());
+	m_BVH->CollectMemory(memory);
+}
+
+RayMask TriangleMesh::HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const
+{
+	return m_BVH->HitPacket(packet, tMin, closest, records);
+}
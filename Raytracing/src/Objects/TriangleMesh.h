@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include "Objects/Hittable.h"
+
+class BVHNode;
+
+// Indexed vertex buffers, shared by the triangles of a mesh.
+struct MeshData
+{
+	std::vector<glm::vec3> Positions;
+	std::vector<glm::vec3> Normals;   // Empty, or one per position
+	std::vector<glm::vec2> UVs;       // Empty, or one per position
+	std::vector<uint32_t> Indices;    // Three per triangle
+
+	size_t TriangleCount() const { return Indices.size() / 3; }
+	size_t MemoryUsage() const;
+
+	const glm::vec3& Vertex(uint32_t triangle, int corner) const { return Positions[Indices[3 * triangle + corner]]; }
+	AABB TriangleBounds(uint32_t triangle) const;
+
+	// Fills the record of a hit on a triangle, interpolating the vertex normals and UVs if there are any
+	void FillRecord(uint32_t triangle, const Ray& ray, float t, const glm::vec3& barycentrics, const Material::Blank* material,
+		HitRecord& record) const;
+};
+
+// Per ray setup of the watertight intersector (Woop, Benthin and Wald, "Watertight Ray/Triangle
+// Intersection"). The ray is sheared onto the +z axis, after which hits are decided by the signs
+// of 2D edge functions. Edges shared by two triangles then always hit exactly one of them.
+struct WatertightRay
+{
+	int Kx, Ky, Kz;
+	float Sx, Sy, Sz;
+
+	WatertightRay(const Ray& ray);
+
+	// Sets t and the barycentric weights of the three vertices if the ray hits within the interval
+	bool Intersect(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const Ray& ray, Interval rayInterval,
+		float& t, glm::vec3& barycentrics) const;
+};
+
+// Indexed triangle mesh with a hierarchy of its own, so the scene's hierarchy only sees the
+// mesh as a whole and the same buffers can be placed several times. The hierarchy is built
+// over the triangles themselves, which the mesh reorders into the order of its leaves, so the
+// data belongs to this mesh alone.
+class TriangleMesh : public Hittable
+{
+public:
+	TriangleMesh(Ref<MeshData> data, Ref<Material::Blank> material);
+	~TriangleMesh();
+
+	bool Hit(const Ray& ray, Interval rayInterval, HitRecord& record) const override;
+	bool Occluded(const Ray& ray, Interval rayInterval) const override;
+	RayMask HitPacket(const RayPacket& packet, float tMin, float* closest, HitRecord* records) const override;
+
+	AABB BoundingBox() const override { return m_BoundingBox; }
+	// The buffers and the hierarchy, once per mesh however often it is instanced
+	void CollectMemory(SceneMemory& memory) const override;
+
+	const MeshData& GetData() const { return *m_Data; }
+
+private:
+	Ref<MeshData> m_Data;
+	Ref<Material::Blank> m_Material;
+	Scope<BVHNode> m_BVH;
+	AABB m_BoundingBox;
+};
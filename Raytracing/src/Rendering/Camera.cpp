@@ -11,16 +11,20 @@ Camera::Camera(glm::vec3 lookFrom, glm::vec3 lookAt, glm::vec3 vUp, uint32_t wid
     Resize(width, height);
 }
 
-Ray Camera::GetRay(int i, int j) const
+Ray Camera::GetRay(int i, int j, Sampler& sampler) const
 {
-    glm::vec3 offset = MathUtil::SampleSquare();
+    // The lens sample is drawn even without defocus, so the camera always uses the same
+    // sampler dimensions and the materials' dimensions start at the same place.
+    glm::vec3 offset = MathUtil::SampleSquare(sampler.Get2D());
+    glm::vec2 lens = sampler.Get2D();
+    float rayTime = sampler.Get1D();
+
     glm::vec3 pixelSample = m_Pixel00Location
         + (i + offset.x) * m_PixelDeltaU
         + (j + offset.y) * m_PixelDeltaV;
 
-    glm::vec3 rayOrigin = (m_DefocusAngle <= 0) ? m_Center : DefocusDiskSample();
+    glm::vec3 rayOrigin = (m_DefocusAngle <= 0) ? m_Center : DefocusDiskSample(lens);
     glm::vec3 rayDirection = pixelSample - rayOrigin;
-    float rayTime = Walnut::Random::Float();
 
     return Ray(rayOrigin, rayDirection, rayTime);
 }
@@ -39,6 +43,7 @@ void Camera::Resize(uint32_t width, uint32_t height)
 
     m_PixelDeltaU = viewportU / (float)width;
     m_PixelDeltaV = viewportV / (float)height;
+    m_PixelSpread = 2.0f * h / (float)height;
 
     glm::vec3 viewportUpperLeft = m_Center - m_FocusDistance * m_W - viewportU / 2.0f - viewportV / 2.0f;
     m_Pixel00Location = viewportUpperLeft + 0.5f * (m_PixelDeltaU, m_PixelDeltaV);
@@ -64,8 +69,8 @@ void Camera::SetDirection(glm::vec3 lookFrom, glm::vec3 lookAt, glm::vec3 vUp, f
     m_V = glm::cross(m_W, m_U);
 }
 
-glm::vec3 Camera::DefocusDiskSample() const
+glm::vec3 Camera::DefocusDiskSample(const glm::vec2& u) const
 {
-    glm::vec2 p = Walnut::Random::InUnitDisk();
+    glm::vec2 p = MathUtil::SampleDisk(u);
     return m_Center + p.x * m_DefocusDiskU + p.y * m_DefocusDiskV;
 }
@@ -3,6 +3,7 @@
 #include "glm/glm.hpp"
 
 #include "Math/Ray.h"
+#include "Math/Sampler.h"
 
 class Camera
 {
@@ -10,13 +11,16 @@ public:
     Camera() = default;
     Camera(glm::vec3 lookFrom, glm::vec3 lookAt, glm::vec3 vUp, uint32_t width, uint32_t height, float vfov, float defocusAngle, float focusDistance);
 
-    Ray GetRay(int i, int j) const;
+    Ray GetRay(int i, int j, Sampler& sampler) const;
 
     void Resize(uint32_t width, uint32_t height);
     void SetFocus(float defocusAngle, float focusDistance);
     void SetDirection(glm::vec3 lookFrom, glm::vec3 lookAt, glm::vec3 vUp, float vfov);
+
+    // Angle between the rays through neighboring pixels, the spread of a ray cone
+    float GetPixelSpread() const { return m_PixelSpread; }
 private:
-    glm::vec3 DefocusDiskSample() const;
+    glm::vec3 DefocusDiskSample(const glm::vec2& u) const;
 
 private:
     glm::vec3 m_Center, m_Pixel00Location;
@@ -25,4 +29,5 @@ private:
     glm::vec3 m_DefocusDiskU, m_DefocusDiskV;
 
     float m_DefocusAngle, m_FOV, m_FocusDistance;
+    float m_PixelSpread;
 };
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <string>
 
+// Decoded image of linear RGB floats, three per pixel. Textures keep their texels in the
+// TextureCache, an image only lives until its pixels are stored there.
 class RTImage {
 public:
 	RTImage() = default;
@@ -14,15 +16,12 @@ public:
 	int GetWidth() const { return m_FloatData == nullptr ? 0 : m_Width; }
 	int GetHeight() const { return m_FloatData == nullptr ? 0 : m_Height; }
 
-	const unsigned char* Pixel(int x, int y) const;
+	const float* GetData() const { return m_FloatData; }
 
-private:
-	static unsigned char FloatToByte(float value);
-
-	void ConvertToBytes();
+	RTImage(const RTImage&) = delete;
+	RTImage& operator=(const RTImage&) = delete;
 
 private:
 	float* m_FloatData = nullptr;
-	unsigned char* m_ByteData = nullptr;
 	int m_Width, m_Height;
 };
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "rtpch.h"
+#include "Rendering/ImageWriter.h"
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+	void AppendBigEndian32(std::vector<uint8_t>& buffer, uint32_t value)
+	{
+		buffer.push_back((uint8_t)(value >> 24));
+		buffer.push_back((uint8_t)(value >> 16));
+		buffer.push_back((uint8_t)(value >> 8));
+		buffer.push_back((uint8_t)value);
+	}
+
+	template<typename T>
+	void AppendLittleEndian(std::vector<uint8_t>& buffer, T value)
+	{
+		uint8_t bytes[sizeof(T)];
+		std::memcpy(bytes, &value, sizeof(T));
+		// Every platform we build for is little endian, the bytes can be copied as they are.
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	void AppendString(std::vector<uint8_t>& buffer, const char* text)
+	{
+		buffer.insert(buffer.end(), text, text + std::strlen(text) + 1);
+	}
+
+	uint32_t CRC32(const uint8_t* data, size_t size)
+	{
+		static const std::array<uint32_t, 256> table = []()
+			{
+				std::array<uint32_t, 256> result;
+				for (uint32_t i = 0; i < 256; i++)
+				{
+					uint32_t c = i;
+					for (int k = 0; k < 8; k++)
+						c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+					result[i] = c;
+				}
+				return result;
+			}();
+
+		uint32_t crc = 0xffffffffu;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		return crc ^ 0xffffffffu;
+	}
+
+	uint32_t Adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t a = 1, b = 0;
+		for (size_t i = 0; i < size; i++)
+		{
+			a = (a + data[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	void AppendPNGChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data)
+	{
+		AppendBigEndian32(png, (uint32_t)data.size());
+		size_t typeStart = png.size();
+		png.insert(png.end(), type, type + 4);
+		png.insert(png.end(), data.begin(), data.end());
+		AppendBigEndian32(png, CRC32(png.data() + typeStart, png.size() - typeStart));
+	}
+
+	bool WriteFile(const std::string& path, const std::vector<uint8_t>& data)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (file)
+			file.write((const char*)data.data(), data.size());
+
+		if (!file)
+		{
+			std::cerr << "ERROR: Could not write image file '" << path << "'.\n";
+			return false;
+		}
+		return true;
+	}
+
+}
+
+bool ImageWriter::Write(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels, const glm::vec3* radiance, uint32_t samples)
+{
+	std::string extension = Extension(path);
+	if (extension == ".png") return WritePNG(path, width, height, pixels);
+	if (extension == ".ppm") return WritePPM(path, width, height, pixels);
+	if (extension == ".exr") return WriteEXR(path, width, height, radiance, samples);
+
+	std::cerr << "ERROR: Unsupported image format '" << extension << "', use .png, .ppm or .exr.\n";
+	return false;
+}
+
+bool ImageWriter::WritePNG(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels)
+{
+	// Raw scanlines, every one prefixed with filter type 0 (none)
+	std::vector<uint8_t> scanlines;
+	scanlines.reserve((size_t)height * (1 + 3 * (size_t)width));
+	for (uint32_t y = 0; y < height; y++)
+	{
+		scanlines.push_back(0);
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint32_t pixel = pixels[x + y * width];
+			scanlines.push_back((uint8_t)pixel);
+			scanlines.push_back((uint8_t)(pixel >> 8));
+			scanlines.push_back((uint8_t)(pixel >> 16));
+		}
+	}
+
+	// zlib stream made of uncompressed deflate blocks. The files are larger than a real encoder
+	// would produce, but any PNG reader can open them and writing costs next to nothing.
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	const size_t maxBlockSize = 65535;
+	size_t offset = 0;
+	do
+	{
+		size_t blockSize = std::min(maxBlockSize, scanlines.size() - offset);
+		bool lastBlock = offset + blockSize == scanlines.size();
+		zlib.push_back(lastBlock ? 1 : 0);
+		AppendLittleEndian<uint16_t>(zlib, (uint16_t)blockSize);
+		AppendLittleEndian<uint16_t>(zlib, (uint16_t)~blockSize);
+		zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < scanlines.size());
+	AppendBigEndian32(zlib, Adler32(scanlines.data(), scanlines.size()));
+
+	std::vector<uint8_t> header;
+	AppendBigEndian32(header, width);
+	AppendBigEndian32(header, height);
+	header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8 bit RGB, deflate, no filtering, no interlacing
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	AppendPNGChunk(png, "IHDR", header);
+	AppendPNGChunk(png, "IDAT", zlib);
+	AppendPNGChunk(png, "IEND", {});
+
+	return WriteFile(path, png);
+}
+
+bool ImageWriter::WritePPM(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels)
+{
+	std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+
+	std::vector<uint8_t> ppm(header.begin(), header.end());
+	ppm.reserve(header.size() + 3 * (size_t)width * height);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		ppm.push_back((uint8_t)pixels[i]);
+		ppm.push_back((uint8_t)(pixels[i] >> 8));
+		ppm.push_back((uint8_t)(pixels[i] >> 16));
+	}
+
+	return WriteFile(path, ppm);
+}
+
+bool ImageWriter::WriteEXR(const std::string& path, uint32_t width, uint32_t height, const glm::vec3* radiance, uint32_t samples)
+{
+	// Single part scanline file without compression, channels have to be sorted by name.
+	std::vector<uint8_t> exr;
+	AppendLittleEndian<uint32_t>(exr, 20000630);  // Magic number
+	AppendLittleEndian<uint32_t>(exr, 2);         // Version 2, no flags
+
+	auto attribute = [&exr](const char* name, const char* type, uint32_t size)
+		{
+			AppendString(exr, name);
+			AppendString(exr, type);
+			AppendLittleEndian<uint32_t>(exr, size);
+		};
+
+	const char* channels[] = { "B", "G", "R" };
+	attribute("channels", "chlist", 3 * (2 + 16) + 1);
+	for (const char* channel : channels)
+	{
+		AppendString(exr, channel);
+		AppendLittleEndian<int32_t>(exr, 2);      // FLOAT
+		AppendLittleEndian<uint32_t>(exr, 0);     // pLinear and reserved bytes
+		AppendLittleEndian<int32_t>(exr, 1);      // x sampling
+		AppendLittleEndian<int32_t>(exr, 1);      // y sampling
+	}
+	exr.push_back(0);
+
+	attribute("compression", "compression", 1);
+	exr.push_back(0);                             // NO_COMPRESSION
+
+	for (const char* window : { "dataWindow", "displayWindow" })
+	{
+		attribute(window, "box2i", 16);
+		AppendLittleEndian<int32_t>(exr, 0);
+		AppendLittleEndian<int32_t>(exr, 0);
+		AppendLittleEndian<int32_t>(exr, (int32_t)width - 1);
+		AppendLittleEndian<int32_t>(exr, (int32_t)height - 1);
+	}
+
+	attribute("lineOrder", "lineOrder", 1);
+	exr.push_back(0);                             // INCREASING_Y
+
+	attribute("pixelAspectRatio", "float", 4);
+	AppendLittleEndian<float>(exr, 1.0f);
+
+	attribute("screenWindowCenter", "v2f", 8);
+	AppendLittleEndian<float>(exr, 0.0f);
+	AppendLittleEndian<float>(exr, 0.0f);
+
+	attribute("screenWindowWidth", "float", 4);
+	AppendLittleEndian<float>(exr, 1.0f);
+
+	exr.push_back(0);                             // End of header
+
+	// Offset table, one entry per scanline since uncompressed blocks hold a single line
+	const uint32_t lineSize = 3 * width * sizeof(float);
+	const uint64_t firstLine = exr.size() + (uint64_t)height * sizeof(uint64_t);
+	for (uint32_t y = 0; y < height; y++)
+		AppendLittleEndian<uint64_t>(exr, firstLine + (uint64_t)y * (8 + lineSize));
+
+	const float scale = samples > 0 ? 1.0f / samples : 0.0f;
+	exr.reserve(exr.size() + (size_t)height * (8 + lineSize));
+	for (uint32_t y = 0; y < height; y++)
+	{
+		AppendLittleEndian<int32_t>(exr, (int32_t)y);
+		AppendLittleEndian<uint32_t>(exr, lineSize);
+
+		// Every line stores all values of one channel before the next, in the B, G, R order from above.
+		for (int channel = 2; channel >= 0; channel--)
+		{
+			for (uint32_t x = 0; x < width; x++)
+				AppendLittleEndian<float>(exr, radiance[x + y * width][channel] * scale);
+		}
+	}
+
+	return WriteFile(path, exr);
+}
+
+bool ImageWriter::IsSupported(const std::string& path)
+{
+	std::string extension = Extension(path);
+	return extension == ".png" || extension == ".ppm" || extension == ".exr";
+}
+
+std::string ImageWriter::Extension(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos)
+		return std::string();
+
+	std::string extension = path.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return extension;
+}
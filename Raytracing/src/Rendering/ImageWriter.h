@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#include "glm/glm.hpp"
+
+// Writes rendered frames to disk without any third party encoder. PNG and PPM store the
+// display image (packed RGBA8, red in the lowest byte, as produced by the Renderer), EXR
+// stores the linear radiance as 32 bit floats so it can be tone mapped later.
+class ImageWriter
+{
+public:
+	// Picks the format from the file extension (.png, .ppm or .exr). radiance holds the summed
+	// samples per pixel and is divided by samples, it is only read for EXR files.
+	static bool Write(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels, const glm::vec3* radiance, uint32_t samples);
+
+	static bool WritePNG(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels);
+	static bool WritePPM(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels);
+	static bool WriteEXR(const std::string& path, uint32_t width, uint32_t height, const glm::vec3* radiance, uint32_t samples);
+
+	static bool IsSupported(const std::string& path);
+
+private:
+	static std::string Extension(const std::string& path);
+};
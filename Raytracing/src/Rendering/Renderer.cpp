@@ -4,44 +4,77 @@
 #include "Rendering/Renderer.h"
 #include "Objects/Material.h"
 #include "Math/Interval.h"
+#include "Math/MathUtil.h"
+#include "Math/RayStream.h"
+#include "Math/Sampler.h"
+#include "Rendering/TextureLoader.h"
 
-void Renderer::StartRender(uint32_t width, uint32_t height, int samples, int maxDepth, Scene* scene)
+Renderer::~Renderer()
+{
+	StopRender();
+	delete[] m_ImageData;
+	delete[] m_AccumulationData;
+}
+
+void Renderer::StartRender(const RenderSettings& settings, Scene* scene)
 {
 	if (m_State == RenderState::Running) return;
-	std::cout << "Started Render with " << width << "x" << height << "pixels, " << samples << " samples, " << maxDepth << " bounces\n";
 
-	if (m_FinalImage)
-	{
-		// No resize necessary
-		if (m_FinalImage->GetWidth() != width || m_FinalImage->GetHeight() != height)
-			m_FinalImage->Resize(width, height);
-	}
-	else
-		m_FinalImage = std::make_shared<Walnut::Image>(width, height, Walnut::ImageFormat::RGBA);
-	
+	// Collect the previous render thread before its state gets replaced.
+	if (m_RenderingThread.joinable())
+		m_RenderingThread.join();
+
+	m_Settings = settings;
+	uint32_t width = settings.Width, height = settings.Height;
+
+	uint32_t threadCount = settings.ThreadCount == 0 ? ThreadPool::HardwareThreads() : settings.ThreadCount;
+	// The render thread works through the tiles as well, so the pool needs one worker less.
+	if (!m_ThreadPool || m_ThreadPool->Concurrency() != threadCount)
+		m_ThreadPool = CreateScope<ThreadPool>(threadCount - 1);
+
+	if (s_Logging)
+		std::cout << "Started " << (settings.Progressive ? "progressive " : "") << "Render with " << width << "x" << height << "pixels, "
+			<< settings.Samples << " samples (" << Sampler::TypeName(settings.Sampling) << "), " << settings.MaxDepth << " bounces, "
+			<< threadCount << " threads\n";
+
 	delete[] m_ImageData;
 	m_ImageData = new uint32_t[width * height];
 	std::fill_n(m_ImageData, width * height, (uint32_t)0xff1e1e1e);
 
+	delete[] m_AccumulationData;
+	m_AccumulationData = new glm::vec3[width * height];
+	std::fill_n(m_AccumulationData, width * height, glm::vec3(0.0f));
+	m_AccumulatedSamples = 0;
+	m_Statistics = RayStatistics();
+	m_WavefrontTimings = WavefrontTimings();
+	Texture::SetStaticDispatch(settings.StaticDispatch);
+
 	// Resize camera
 	scene->Camera.Resize(width, height);
 
-	m_RenderingThread = std::thread(&Renderer::Render, this, samples, maxDepth, scene);
-	m_RenderingThread.detach();
+	m_State = RenderState::Running;
+	m_RenderingThread = std::thread(&Renderer::Render, this, scene);
 }
 
 void Renderer::StopRender()
 {
-	m_State = RenderState::Stopped;
+	if (m_State == RenderState::Running)
+		m_State = RenderState::Stopped;
+
+	// Workers poll the state between pixels, so this only waits for the pixels in flight.
+	if (m_RenderingThread.joinable())
+		m_RenderingThread.join();
+}
+
+void Renderer::WaitForRender()
+{
+	if (m_RenderingThread.joinable())
+		m_RenderingThread.join();
 }
 
 void Renderer::Update()
 {
-	if (m_State == RenderState::Running)
-	{
-		m_FinalImage->SetData(m_ImageData);
-	}
-	else if (m_State == RenderState::Finished || m_State == RenderState::Stopped)
+	if (m_State == RenderState::Finished || m_State == RenderState::Stopped)
 	{
 		if (m_RenderingThread.joinable())
 		{
@@ -50,57 +83,505 @@ void Renderer::Update()
 	}
 }
 
-void Renderer::Render(int maxSamples, int maxDepth, Scene* scene)
+void Renderer::Render(Scene* scene)
 {
+	// Textures may still be decoding in the background, the first pixel can need any of them
+	TextureLoader::WaitAll();
+
 	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-	m_State = RenderState::Running;
 
 	// Rendering
-	for (uint32_t y = m_FinalImage->GetHeight() - 1; y > 0; y--) {
-		for (uint32_t x = 0; x < m_FinalImage->GetWidth(); x++) {
+	if (m_Settings.Wavefront)
+	{
+		// A fixed sample count is rendered as just as many passes
+		uint32_t samples = (uint32_t)std::max(m_Settings.Samples, 0);
+		for (uint32_t pass = 0; m_Settings.Progressive ? !ProgressiveFinished(pass, start) : pass < samples; pass++)
+		{
+			RenderWavefrontPass(pass, scene);
 			if (m_State == RenderState::Stopped) return;
 
-			glm::vec3 pixelColor(0.0f);
-			for (int s = 0; s < maxSamples; s++)
-			{
-				Ray ray = scene->Camera.GetRay(x, y);
-				pixelColor += RayColor(ray, maxDepth, scene);
-			}
+			m_AccumulatedSamples = pass + 1;
+		}
+	}
+	else if (m_Settings.Progressive)
+	{
+		for (uint32_t pass = 0; !ProgressiveFinished(pass, start); pass++)
+		{
+			DispatchTiles([&](const Tile& tile) { AccumulateTile(tile, pass, scene); });
+			if (m_State == RenderState::Stopped) return;
 
-			WritePixelToBuffer(m_ImageData, x, y, maxSamples, pixelColor);
+			// Each pass already wrote its running average, Update() uploads it on the UI thread.
+			m_AccumulatedSamples = pass + 1;
 		}
 	}
+	else
+	{
+		DispatchTiles([&](const Tile& tile) { RenderTile(tile, scene); });
+		if (m_State == RenderState::Stopped) return;
+
+		m_AccumulatedSamples = m_Settings.Samples;
+	}
 
 	m_State = RenderState::Finished;
-	m_FinalImage->SetData(m_ImageData);
 
 	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 
 	auto seconds = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
 	auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() - (1000 * seconds);
 	m_RenderingTime = std::string(std::to_string(seconds) + "s " + std::to_string(milliseconds) + "ms");
-	std::cout << "Rendering Took " << m_RenderingTime << std::endl;
+	if (s_Logging)
+		std::cout << "Rendering Took " << m_RenderingTime << std::endl;
+}
+
+void Renderer::DispatchTiles(const std::function<void(const Tile&)>& renderTile)
+{
+	TileScheduler scheduler(m_Settings.Width, m_Settings.Height, m_Settings.TileSize, m_ThreadPool->Concurrency());
+	m_ThreadPool->Dispatch([&](uint32_t workerIndex)
+		{
+			Statistics::ResetLocal();
+
+			Tile tile;
+			while (m_State != RenderState::Stopped && scheduler.Next(workerIndex, tile))
+				renderTile(tile);
+
+			std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+			m_Statistics += Statistics::Local();
+		});
+}
+
+void Renderer::RenderTile(const Tile& tile, Scene* scene)
+{
+	Scope<Sampler> sampler = CreateSampler();
+
+	if (m_Settings.PacketTracing)
+	{
+		for (uint32_t y0 = tile.Y; y0 < tile.Y + tile.Height; y0 += s_BlockSize) {
+			for (uint32_t x0 = tile.X; x0 < tile.X + tile.Width; x0 += s_BlockSize) {
+				if (m_State == RenderState::Stopped) return;
+
+				uint32_t width = std::min(s_BlockSize, tile.X + tile.Width - x0);
+				uint32_t height = std::min(s_BlockSize, tile.Y + tile.Height - y0);
+
+				// Every pixel sums its samples in the same order as below, so the colors match bit for bit.
+				glm::vec3 colors[s_BlockSize * s_BlockSize] = {};
+				for (int s = 0; s < m_Settings.Samples; s++)
+					TraceBlock(x0, y0, width, height, s, scene, *sampler, colors);
+
+				for (uint32_t j = 0; j < height; j++) {
+					for (uint32_t i = 0; i < width; i++) {
+						m_AccumulationData[(x0 + i) + (y0 + j) * m_Settings.Width] = colors[i + j * width];
+						WritePixelToBuffer(m_ImageData, x0 + i, y0 + j, m_Settings.Samples, colors[i + j * width]);
+					}
+				}
+			}
+		}
+		return;
+	}
+
+	for (uint32_t y = tile.Y; y < tile.Y + tile.Height; y++) {
+		for (uint32_t x = tile.X; x < tile.X + tile.Width; x++) {
+			if (m_State == RenderState::Stopped) return;
+
+			const uint32_t index = x + y * m_Settings.Width;
+
+			glm::vec3 pixelColor(0.0f);
+			for (int s = 0; s < m_Settings.Samples; s++)
+			{
+				// Keying on the sample index keeps this bit-identical to the same number of progressive passes.
+				sampler->StartPixelSample(x, y, s);
+				Ray ray = scene->Camera.GetRay(x, y, *sampler);
+				RT_COUNT(PrimaryRays);
+				pixelColor += RayColor(ray, scene, *sampler);
+			}
+
+			m_AccumulationData[index] = pixelColor;
+			WritePixelToBuffer(m_ImageData, x, y, m_Settings.Samples, pixelColor);
+		}
+	}
+}
+
+void Renderer::AccumulateTile(const Tile& tile, uint32_t pass, Scene* scene)
+{
+	Scope<Sampler> sampler = CreateSampler();
+
+	if (m_Settings.PacketTracing)
+	{
+		for (uint32_t y0 = tile.Y; y0 < tile.Y + tile.Height; y0 += s_BlockSize) {
+			for (uint32_t x0 = tile.X; x0 < tile.X + tile.Width; x0 += s_BlockSize) {
+				if (m_State == RenderState::Stopped) return;
+
+				uint32_t width = std::min(s_BlockSize, tile.X + tile.Width - x0);
+				uint32_t height = std::min(s_BlockSize, tile.Y + tile.Height - y0);
+
+				glm::vec3 colors[s_BlockSize * s_BlockSize] = {};
+				TraceBlock(x0, y0, width, height, pass, scene, *sampler, colors);
+
+				for (uint32_t j = 0; j < height; j++) {
+					for (uint32_t i = 0; i < width; i++) {
+						const uint32_t index = (x0 + i) + (y0 + j) * m_Settings.Width;
+						m_AccumulationData[index] += colors[i + j * width];
+						WritePixelToBuffer(m_ImageData, x0 + i, y0 + j, pass + 1, m_AccumulationData[index]);
+					}
+				}
+			}
+		}
+		return;
+	}
+
+	for (uint32_t y = tile.Y; y < tile.Y + tile.Height; y++) {
+		for (uint32_t x = tile.X; x < tile.X + tile.Width; x++) {
+			if (m_State == RenderState::Stopped) return;
+
+			const uint32_t index = x + y * m_Settings.Width;
+
+			sampler->StartPixelSample(x, y, pass);
+			Ray ray = scene->Camera.GetRay(x, y, *sampler);
+			RT_COUNT(PrimaryRays);
+			m_AccumulationData[index] += RayColor(ray, scene, *sampler);
+
+			WritePixelToBuffer(m_ImageData, x, y, pass + 1, m_AccumulationData[index]);
+		}
+	}
+}
+
+void Renderer::TraceBlock(uint32_t x0, uint32_t y0, uint32_t width, uint32_t height, uint32_t sample, Scene* scene, Sampler& sampler, glm::vec3* colors)
+{
+	if (m_Settings.MaxDepth <= 0)
+		return;
+
+	constexpr uint32_t blockPixels = s_BlockSize * s_BlockSize;
+	PathState paths[blockPixels];
+	uint32_t dimensions[blockPixels];
+	for (uint32_t j = 0; j < height; j++) {
+		for (uint32_t i = 0; i < width; i++) {
+			sampler.StartPixelSample(x0 + i, y0 + j, sample);
+			paths[i + j * width].PathRay = scene->Camera.GetRay(x0 + i, y0 + j, sampler);
+			dimensions[i + j * width] = sampler.GetDimension();
+		}
+	}
+
+	const uint32_t count = width * height;
+	RT_COUNT_ADD(PrimaryRays, count);
+
+	// The block's paths go on bounce by bounce, each bounce's rays of the paths still alive are
+	// traced together. Later bounces scatter in all directions, the stream sorts them by octant.
+	uint32_t active[blockPixels];
+	for (uint32_t index = 0; index < count; index++)
+		active[index] = index;
+
+	Ray rays[blockPixels];
+	HitRecord records[blockPixels];
+	bool hits[blockPixels];
+	for (uint32_t activeCount = count; activeCount > 0; )
+	{
+		for (uint32_t k = 0; k < activeCount; k++)
+			rays[k] = paths[active[k]].PathRay;
+
+		RT_COUNT_ADD(TotalRays, activeCount);
+		RayStream::Trace(scene->World, rays, activeCount, 0.001f, records, hits);
+
+		// Each path picks its sample up again where its last bounce left it
+		uint32_t next = 0;
+		for (uint32_t k = 0; k < activeCount; k++)
+		{
+			const uint32_t index = active[k];
+			sampler.StartPixelSample(x0 + index % width, y0 + index / width, sample);
+			sampler.SetDimension(dimensions[index]);
+			if (ShadeHit(paths[index], hits[k], records[k], scene, sampler))
+				active[next++] = index;
+			dimensions[index] = sampler.GetDimension();
+		}
+		activeCount = next;
+	}
+
+	for (uint32_t index = 0; index < count; index++)
+		colors[index] += paths[index].Radiance;
+}
+
+void Renderer::RenderWavefrontPass(uint32_t pass, Scene* scene)
+{
+	const uint32_t width = m_Settings.Width;
+	const uint32_t pixelCount = m_Settings.Width * m_Settings.Height;
+	const uint32_t waveSize = std::min(s_WaveSize, pixelCount);
+
+	// Per path of the wave, a path is the pixel first + its index
+	std::vector<PathState> paths(waveSize);
+	std::vector<uint32_t> dimensions(waveSize);
+	std::vector<HitRecord> records(waveSize);
+	std::vector<uint8_t> hits(waveSize), alive(waveSize);
+
+	// Paths that still go on, in the order the extend and the shade stage take them
+	std::vector<uint32_t> queue(waveSize), sorted(waveSize);
+	std::vector<uint8_t> types(waveSize);
+
+	auto timeStage = [](double& seconds, const std::function<void()>& stage)
+	{
+		std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+		stage();
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - stageStart).count();
+	};
+
+	for (uint32_t first = 0; first < pixelCount; first += waveSize)
+	{
+		const uint32_t pathCount = std::min(waveSize, pixelCount - first);
+
+		timeStage(m_WavefrontTimings.Generate, [&]()
+			{
+				ParallelFor(pathCount, [&](uint32_t begin, uint32_t end, Sampler& sampler)
+					{
+						for (uint32_t i = begin; i < end; i++)
+						{
+							const uint32_t x = (first + i) % width, y = (first + i) / width;
+							sampler.StartPixelSample(x, y, pass);
+							paths[i] = PathState();
+							paths[i].PathRay = scene->Camera.GetRay(x, y, sampler);
+							dimensions[i] = sampler.GetDimension();
+							queue[i] = i;
+						}
+						RT_COUNT_ADD(PrimaryRays, end - begin);
+					});
+			});
+
+		uint32_t queueSize = m_Settings.MaxDepth > 0 ? pathCount : 0;
+		while (queueSize > 0)
+		{
+			if (m_State == RenderState::Stopped) return;
+
+			timeStage(m_WavefrontTimings.Extend, [&]()
+				{
+					ParallelFor(queueSize, [&](uint32_t begin, uint32_t end, Sampler&)
+						{
+							// Each chunk is one stream, sorted by octant so its packets hold rays that
+							// head the same way, kept per thread so the stage allocates nothing once warm
+							static thread_local std::vector<Ray> rays;
+							static thread_local std::vector<HitRecord> chunkRecords;
+							static thread_local std::unique_ptr<bool[]> chunkHits = std::make_unique<bool[]>(s_WaveChunkSize);
+							rays.resize(end - begin);
+							chunkRecords.resize(end - begin);
+							for (uint32_t q = begin; q < end; q++)
+								rays[q - begin] = paths[queue[q]].PathRay;
+
+							RayStream::Trace(scene->World, rays.data(), end - begin, 0.001f, chunkRecords.data(), chunkHits.get());
+
+							for (uint32_t q = begin; q < end; q++)
+							{
+								const uint32_t i = queue[q];
+								hits[i] = chunkHits[q - begin];
+								if (hits[i])
+									records[i] = chunkRecords[q - begin];
+								types[q] = hits[i] ? (uint8_t)records[i].MaterialPtr->GetType() : (uint8_t)Material::TypeCount;
+							}
+							RT_COUNT_ADD(TotalRays, end - begin);
+						});
+				});
+
+			// Counting sort by material type, misses last. It is stable, so each type keeps the
+			// paths in pixel order.
+			timeStage(m_WavefrontTimings.Sort, [&]()
+				{
+					uint32_t offsets[Material::TypeCount + 2] = {};
+					for (uint32_t q = 0; q < queueSize; q++)
+						offsets[types[q] + 1]++;
+					for (uint32_t type = 1; type < Material::TypeCount + 2; type++)
+						offsets[type] += offsets[type - 1];
+					for (uint32_t q = 0; q < queueSize; q++)
+						sorted[offsets[types[q]]++] = queue[q];
+				});
+
+			timeStage(m_WavefrontTimings.Shade, [&]()
+				{
+					ParallelFor(queueSize, [&](uint32_t begin, uint32_t end, Sampler& sampler)
+						{
+							for (uint32_t q = begin; q < end; q++)
+							{
+								const uint32_t i = sorted[q];
+								sampler.StartPixelSample((first + i) % width, (first + i) / width, pass);
+								sampler.SetDimension(dimensions[i]);
+								alive[i] = ShadeHit(paths[i], hits[i] != 0, records[i], scene, sampler);
+								dimensions[i] = sampler.GetDimension();
+							}
+						});
+
+					uint32_t next = 0;
+					for (uint32_t q = 0; q < queueSize; q++)
+					{
+						if (alive[sorted[q]])
+							queue[next++] = sorted[q];
+					}
+					queueSize = next;
+				});
+		}
+
+		for (uint32_t i = 0; i < pathCount; i++)
+		{
+			const uint32_t pixel = first + i;
+			m_AccumulationData[pixel] += paths[i].Radiance;
+			WritePixelToBuffer(m_ImageData, pixel % width, pixel / width, pass + 1, m_AccumulationData[pixel]);
+		}
+	}
+}
+
+void Renderer::ParallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t, Sampler&)>& function)
+{
+	std::atomic<uint32_t> next = 0;
+	m_ThreadPool->Dispatch([&](uint32_t)
+		{
+			Statistics::ResetLocal();
+			Scope<Sampler> sampler = CreateSampler();
+
+			for (uint32_t begin = next.fetch_add(s_WaveChunkSize); begin < count; begin = next.fetch_add(s_WaveChunkSize))
+				function(begin, std::min(begin + s_WaveChunkSize, count), *sampler);
+
+			std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+			m_Statistics += Statistics::Local();
+		});
+}
+
+Scope<Sampler> Renderer::CreateSampler() const
+{
+	return Sampler::Create(m_Settings.Sampling, m_Settings.Width, m_Settings.Height, (uint32_t)std::max(m_Settings.Samples, 0), m_Settings.Seed);
 }
 
-glm::vec3 Renderer::RayColor(const Ray& ray, int depth, Scene* scene)
+bool Renderer::ProgressiveFinished(uint32_t pass, std::chrono::steady_clock::time_point start) const
 {
-	// If the ray bounce limit is exceeded, no more light is gathered
-	if (depth <= 0) return glm::vec3(0.0f);
+	if (m_Settings.Samples > 0 && pass >= (uint32_t)m_Settings.Samples)
+		return true;
+
+	std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+	return m_Settings.TimeBudget > 0.0f && elapsed.count() >= m_Settings.TimeBudget;
+}
+
+glm::vec3 Renderer::RayColor(const Ray& ray, Scene* scene, Sampler& sampler)
+{
+	if (m_Settings.MaxDepth <= 0)
+		return glm::vec3(0.0f);
 
 	HitRecord record;
+	RT_COUNT(TotalRays);
+	bool hit = scene->World.Hit(ray, Interval(0.001f, std::numeric_limits<float>::infinity()), record);
+	return PathColor(ray, hit, record, scene, sampler);
+}
+
+glm::vec3 Renderer::PathColor(const Ray& primaryRay, bool hit, HitRecord& primaryRecord, Scene* scene, Sampler& sampler)
+{
+	PathState path;
+	path.PathRay = primaryRay;
+	bool alive = ShadeHit(path, hit, primaryRecord, scene, sampler);
+
+	HitRecord record;
+	while (alive)
+	{
+		RT_COUNT(TotalRays);
+		hit = scene->World.Hit(path.PathRay, Interval(0.001f, std::numeric_limits<float>::infinity()), record);
+		alive = ShadeHit(path, hit, record, scene, sampler);
+	}
+
+	return path.Radiance;
+}
+
+bool Renderer::ShadeHit(PathState& path, bool hit, HitRecord& record, Scene* scene, Sampler& sampler)
+{
+	if (!hit)
+	{
+		path.Radiance += path.Throughput * scene->Background;
+		return false;
+	}
+
+	path.ConeWidth += scene->Camera.GetPixelSpread() * record.Intersection * glm::length(path.PathRay.Direction());
+	record.Footprint = path.ConeWidth * record.UVScale;
+
+	if (m_Settings.StaticDispatch)
+		return Material::Visit(*record.MaterialPtr, [&](const auto& material) { return ShadeMaterial(path, record, material, scene, sampler); });
+	return ShadeMaterial(path, record, *record.MaterialPtr, scene, sampler);
+}
+
+template<typename MaterialClass>
+bool Renderer::ShadeMaterial(PathState& path, const HitRecord& record, const MaterialClass& material, Scene* scene, Sampler& sampler)
+{
+	bool sampleLights = m_Settings.LightSampling && !scene->Lights.empty();
 
-	if (!scene->World.Hit(ray, Interval(0.001f, std::numeric_limits<float>::infinity()), record))
-		return scene->Background;
+	if (material.IsEmissive())
+	{
+		glm::vec3 emitted = material.Emitted(record.U, record.V, record.Point);
+		float weight = path.SpecularBounce || !sampleLights ? 1.0f : MathUtil::PowerHeuristic(path.ScatteringPDF, LightPDF(path.PathRay, record.Intersection, scene));
+		path.Radiance += path.Throughput * emitted * weight;
+	}
+
+	// Past the bounce limit no more light is gathered. That includes the light sample, whose
+	// MIS weight assumes the scattered ray could still find the same light and take the rest.
+	if (path.Depth + 1 >= m_Settings.MaxDepth)
+		return false;
+
+	if (sampleLights && !material.IsSpecular())
+		path.Radiance += path.Throughput * SampleLight(path.PathRay, record, material, scene, sampler);
 
 	Ray scattered;
 	glm::vec3 attenuation;
-	glm::vec3 colorFromEmission = record.MaterialPtr->Emitted(record.U, record.V, record.Point);
+	if (!material.Scatter(path.PathRay, record, attenuation, scattered, sampler))
+		return false;
+
+	path.SpecularBounce = material.IsSpecular();
+	if (!path.SpecularBounce)
+		path.ScatteringPDF = material.ScatteringPDF(path.PathRay, record, scattered.Direction());
+
+	path.Throughput *= attenuation;
+
+	if (path.Depth + 1 >= m_Settings.RouletteDepth)
+	{
+		float survival = std::min(MathUtil::Max(path.Throughput), 0.95f);
+		if (sampler.Get1D() >= survival)
+			return false;
+		path.Throughput /= survival;
+	}
+
+	path.PathRay = scattered;
+	path.Depth++;
+	return true;
+}
+
+template<typename MaterialClass>
+glm::vec3 Renderer::SampleLight(const Ray& ray, const HitRecord& record, const MaterialClass& material, Scene* scene, Sampler& sampler)
+{
+	const std::vector<Ref<Hittable>>& lights = scene->Lights;
+
+	// Both are drawn before anything can fail, so every path uses the same sampler dimensions.
+	float pick = sampler.Get1D();
+	glm::vec2 u = sampler.Get2D();
+
+	const Hittable& light = *lights[std::min((size_t)(pick * lights.size()), lights.size() - 1)];
+	glm::vec3 direction = glm::normalize(light.SampleDirection(record.Point, ray.time(), u));
+	Ray shadowRay(record.Point, direction, ray.time());
+
+	HitRecord lightRecord;
+	if (!light.Hit(shadowRay, Interval(0.001f, std::numeric_limits<float>::infinity()), lightRecord))
+		return glm::vec3(0.0f);
+
+	float lightPDF = light.PDFValue(shadowRay, Interval(0.001f, std::numeric_limits<float>::infinity())) / lights.size();
+	glm::vec3 scattered = material.Evaluate(ray, record, direction);
+	if (lightPDF <= 0.0f || MathUtil::Max(scattered) <= 0.0f)
+		return glm::vec3(0.0f);
+
+	RT_COUNT(TotalRays);
+	RT_COUNT(ShadowRays);
+	if (scene->World.Occluded(shadowRay, Interval(0.001f, lightRecord.Intersection * 0.999f)))
+		return glm::vec3(0.0f);
+
+	glm::vec3 emitted = lightRecord.MaterialPtr->Emitted(lightRecord.U, lightRecord.V, lightRecord.Point);
+	float weight = MathUtil::PowerHeuristic(lightPDF, material.ScatteringPDF(ray, record, direction));
+	return scattered * emitted * (weight / lightPDF);
+}
+
+float Renderer::LightPDF(const Ray& ray, float hitDistance, Scene* scene) const
+{
+	// Lights behind the emitter that was hit could not have been picked for this direction,
+	// and an emitter missing from the list gets no density at all.
+	Interval interval(0.001f, hitDistance * 1.001f);
 
-	if (!record.MaterialPtr->Scatter(ray, record, attenuation, scattered))
-		return colorFromEmission;
+	float pdf = 0.0f;
+	for (const Ref<Hittable>& light : scene->Lights)
+		pdf += light->PDFValue(ray, interval);
 
-	glm::vec3 colorFromScatter = attenuation * RayColor(scattered, depth - 1, scene);
-	return colorFromEmission + colorFromScatter;
+	return pdf / std::max<size_t>(scene->Lights.size(), 1);
 }
 
 void Renderer::WritePixelToBuffer(uint32_t* buffer, unsigned int x, unsigned int y, unsigned int samples, glm::vec3 color) const
@@ -109,7 +590,7 @@ void Renderer::WritePixelToBuffer(uint32_t* buffer, unsigned int x, unsigned int
 	color = glm::sqrt(color);
 	color = glm::clamp(color, 0.0f, 1.0f);
 
-	const unsigned int index = x + y * m_FinalImage->GetWidth();
+	const unsigned int index = x + y * m_Settings.Width;
 	buffer[index] = 0xff000000 | (static_cast<uint8_t>(255 * color.z) << 16)
 		| (static_cast<uint8_t>(255 * color.g) << 8)
 		| static_cast<uint8_t>(255 * color.r);
@@ -1,22 +1,100 @@
 #pragma once
 
-#include "Walnut/Image.h"
-
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 
+#include "Core/Statistics.h"
+#include "Core/ThreadPool.h"
+
 #include "Objects/Hittable.h"
 #include "Objects/Sphere.h"
 #include "Objects/HittableList.h"
 
 #include "Rendering/Camera.h"
 #include "Rendering/Scene.h"
+#include "Rendering/TileScheduler.h"
 
 #include "Math/Ray.h"
+#include "Math/Sampler.h"
 
 #include "glm/glm.hpp"
 
+struct RenderSettings
+{
+	uint32_t Width = 0, Height = 0;
+	int Samples = 20;
+	int MaxDepth = 20;
+	// Paths that have bounced this often are ended at random with a probability that grows as their
+	// throughput drops, and the survivors are weighted up so the estimate stays unbiased. A value of
+	// MaxDepth or more turns Russian roulette off.
+	int RouletteDepth = 3;
+	// Next event estimation: diffuse bounces also sample the scene's lights directly, combined with
+	// the scattered rays by multiple importance sampling.
+	bool LightSampling = true;
+
+	// Every random number is hashed from this seed, the pixel, the sample and the dimension,
+	// so the same seed always yields the same image, no matter how many threads render it.
+	uint32_t Seed = 0;
+	SamplerType Sampling = SamplerType::Sobol;
+	uint32_t ThreadCount = 0; // 0 uses every hardware thread
+	uint32_t TileSize = 32;
+	// The paths of every 8x8 block of pixels are traced together bounce by bounce, as packets of
+	// rays, so each BVH node is fetched once per packet instead of once per ray. The image is the
+	// same either way. Off by default: every ray still does its own box tests, on top of the
+	// packet's bookkeeping, which costs about what the saved node fetches gain unless the
+	// hierarchy does not fit in cache.
+	bool PacketTracing = false;
+	// Renders pass by pass as a wavefront: all paths of a wave of pixels are extended by one
+	// bounce at a time, their rays traced as packets and their hits grouped by material type and
+	// shaded in batches of one type.
+	// The image is the same as the path by path renderer's.
+	bool Wavefront = false;
+	// Materials and textures are called through a switch on their type tag instead of the
+	// vtable, and each material gets a shading routine compiled for its class. Off uses the
+	// virtual calls, the image is the same either way.
+	bool StaticDispatch = true;
+
+	// Progressive mode adds one sample per pixel over the whole frame per pass and publishes the
+	// running average after each pass. It stops after Samples passes or once TimeBudget seconds
+	// have elapsed, whichever comes first; a value of 0 disables that limit.
+	bool Progressive = false;
+	float TimeBudget = 0.0f;
+};
+
+// Seconds spent in each stage of the wavefront renderer, summed over all bounces and passes.
+// Stages run on every render thread at once, so these are wall clock times.
+struct WavefrontTimings
+{
+	double Generate = 0.0;  // Camera rays
+	double Extend = 0.0;    // Closest hits
+	double Sort = 0.0;      // Grouping hits by material type
+	double Shade = 0.0;     // Emission, light sampling, scattering and queueing the next rays
+
+	double Total() const { return Generate + Extend + Sort + Shade; }
+};
+
+// Where a path stands between two bounces
+struct PathState
+{
+	Ray PathRay;
+	// Throughput is the product of the attenuations along the path so far, the light a later
+	// bounce finds reaches the camera scaled by it.
+	glm::vec3 Throughput = glm::vec3(1.0f);
+	glm::vec3 Radiance = glm::vec3(0.0f);
+	// Emitters hit after a diffuse bounce were also reachable by light sampling, so their
+	// contribution is weighted against it. Camera rays and specular bounces count fully.
+	bool SpecularBounce = true;
+	float ScatteringPDF = 0.0f;
+	int Depth = 0;
+	// Width of the ray cone around the path at its current origin, growing by the camera's pixel
+	// spread over the distance travelled. Textures filter over its footprint at each hit.
+	float ConeWidth = 0.0f;
+};
 
 class Renderer
 {
@@ -25,31 +103,90 @@ public:
 	enum class RenderState { Ready, Running, Finished, Stopped };
 
 	Renderer() = default;
+	~Renderer();
 
-	void StartRender(uint32_t width, uint32_t height, int samples, int maxDepth, Scene* scene);
+	void StartRender(const RenderSettings& settings, Scene* scene);
 	void StopRender();
+	// Blocks until the current render has finished or was stopped.
+	void WaitForRender();
 
 	void Update();
 
-	void Render(int maxSamples, int maxDepth, Scene* scene);
+	void Render(Scene* scene);
 
-	std::shared_ptr<Walnut::Image> GetFinalImage() const { return m_FinalImage; }
+	// Packed RGBA8 (red in the lowest byte) display image, gamma corrected and clamped.
+	const uint32_t* GetImageData() const { return m_ImageData; }
+	uint32_t GetWidth() const { return m_Settings.Width; }
+	uint32_t GetHeight() const { return m_Settings.Height; }
+
+	// Summed linear radiance per pixel, divide by GetAccumulatedSamples() for the average.
+	const glm::vec3* GetAccumulationData() const { return m_AccumulationData; }
+	uint32_t GetAccumulatedSamples() const { return m_AccumulatedSamples; }
+
+	// Work done by the last render, only counted when statistics are compiled in.
+	RayStatistics GetStatistics() const { std::lock_guard<std::mutex> lock(m_StatisticsMutex); return m_Statistics; }
+	// Stage times of the last wavefront render
+	WavefrontTimings GetWavefrontTimings() const { return m_WavefrontTimings; }
 
 	std::string GetRenderTime() { return m_RenderingTime; }
+	RenderState GetState() const { return m_State; }
+
+	// Progress messages on stdout, tools that print machine readable results turn them off.
+	static void SetLogging(bool enabled) { s_Logging = enabled; }
 
 private:
 
+	void DispatchTiles(const std::function<void(const Tile&)>& renderTile);
+	void RenderTile(const Tile& tile, Scene* scene);
+	void AccumulateTile(const Tile& tile, uint32_t pass, Scene* scene);
+
+	// Adds one sample (index sample) to colors for every pixel of a block of at most 8x8 pixels
+	void TraceBlock(uint32_t x0, uint32_t y0, uint32_t width, uint32_t height, uint32_t sample, Scene* scene, Sampler& sampler, glm::vec3* colors);
+
+	// Renders one sample per pixel over the whole frame with the wavefront stages
+	void RenderWavefrontPass(uint32_t pass, Scene* scene);
+	// Calls function(begin, end, sampler) for chunks of [0, count) on every render thread
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t, Sampler&)>& function);
+
+	Scope<Sampler> CreateSampler() const;
+	bool ProgressiveFinished(uint32_t pass, std::chrono::steady_clock::time_point start) const;
+
 	void WritePixelToBuffer(uint32_t* buffer, unsigned int x, unsigned int y, unsigned int samples, glm::vec3 color) const;
 
-	glm::vec3 RayColor(const Ray& r, int depth, Scene* scene);
+	glm::vec3 RayColor(const Ray& ray, Scene* scene, Sampler& sampler);
+	// Follows a path whose camera ray was already traced, hit tells if record holds its closest hit
+	glm::vec3 PathColor(const Ray& primaryRay, bool hit, HitRecord& primaryRecord, Scene* scene, Sampler& sampler);
+	// Gathers the light of the path's current hit and scatters it. Returns false once the path
+	// has ended, otherwise its next ray is in path.PathRay.
+	bool ShadeHit(PathState& path, bool hit, HitRecord& record, Scene* scene, Sampler& sampler);
+	// ShadeHit for a hit on material, either a concrete material class or Material::Blank for virtual calls
+	template<typename MaterialClass>
+	bool ShadeMaterial(PathState& path, const HitRecord& record, const MaterialClass& material, Scene* scene, Sampler& sampler);
+	// Light arriving directly from one randomly picked light, weighted for multiple importance sampling
+	template<typename MaterialClass>
+	glm::vec3 SampleLight(const Ray& ray, const HitRecord& record, const MaterialClass& material, Scene* scene, Sampler& sampler);
+	// Density of SampleLight picking the direction of ray, which hit an emitter at hitDistance
+	float LightPDF(const Ray& ray, float hitDistance, Scene* scene) const;
 
 private:
-	std::shared_ptr<Walnut::Image> m_FinalImage;
 	uint32_t* m_ImageData = nullptr;
+	glm::vec3* m_AccumulationData = nullptr;
+	std::atomic<uint32_t> m_AccumulatedSamples = 0;
+
+	RayStatistics m_Statistics;
+	mutable std::mutex m_StatisticsMutex;
+	WavefrontTimings m_WavefrontTimings;
 
+	RenderSettings m_Settings;
+	Scope<ThreadPool> m_ThreadPool;
 	std::thread m_RenderingThread;
 
-	RenderState m_State = RenderState::Ready;
+	static inline bool s_Logging = true;
+	static constexpr uint32_t s_BlockSize = 8;
+	// Paths in flight per wave and per chunk of work handed to a render thread
+	static constexpr uint32_t s_WaveSize = 1 << 16;
+	static constexpr uint32_t s_WaveChunkSize = 1024;
+
+	std::atomic<RenderState> m_State = RenderState::Ready;
 	std::string m_RenderingTime = std::string("0s");
 };
-#pragma once
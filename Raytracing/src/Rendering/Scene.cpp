@@ -5,9 +5,114 @@
 #include "Objects/Sphere.h"
 #include "Objects/ConstantMedium.h"
 #include "Objects/Quad.h"
+#include "Objects/TriangleMesh.h"
+#include "Objects/Instance.h"
+#include "Objects/MeshLoader.h"
 
 #include "Math/MathUtil.h"
 #include "Math/BVH.h"
+#include "Math/Random.h"
+
+#include <cctype>
+#include <chrono>
+
+namespace {
+
+	// Moves the objects of nested lists up into the list that holds them. An instance of a list
+	// gets a hierarchy over the list's objects instead, so its primitives are batched as well.
+	void FlattenInto(const HittableList& list, std::vector<Ref<Hittable>>& objects, SceneCompileStats& stats)
+	{
+		for (const Ref<Hittable>& object : list.Objects())
+		{
+			if (const HittableList* nested = dynamic_cast<const HittableList*>(object.get()))
+			{
+				stats.FlattenedLists++;
+				FlattenInto(*nested, objects, stats);
+			}
+			else if (const Instance* instance = dynamic_cast<const Instance*>(object.get()))
+			{
+				const HittableList* placed = dynamic_cast<const HittableList*>(instance->GetObject().get());
+				if (!placed)
+				{
+					objects.push_back(object);
+					continue;
+				}
+
+				stats.FlattenedLists++;
+				std::vector<Ref<Hittable>> placedObjects;
+				FlattenInto(*placed, placedObjects, stats);
+				objects.push_back(instance->WithObject(CreateRef<BVHNode>(placedObjects, 0, placedObjects.size())));
+			}
+			else
+			{
+				objects.push_back(object);
+			}
+		}
+	}
+
+}
+
+Scene::Scene(const HittableList& world, const ::Camera& camera, const std::string& name, const glm::vec3& background)
+	: Camera(camera), Name(name), Background(background)
+{
+	Compile(world);
+}
+
+Scene& Scene::operator=(Scene other)
+{
+	std::swap(Arena, other.Arena);
+	std::swap(World, other.World);
+	std::swap(Camera, other.Camera);
+	std::swap(Name, other.Name);
+	std::swap(Background, other.Background);
+	std::swap(Lights, other.Lights);
+	std::swap(CompileStats, other.CompileStats);
+	return *this;
+}
+
+void Scene::Compile(const HittableList& world)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	CompileStats = SceneCompileStats();
+	CompileStats.InputObjects = world.Objects().size();
+
+	std::vector<Ref<Hittable>> objects;
+	FlattenInto(world, objects, CompileStats);
+	CompileStats.TopLevelObjects = objects.size();
+
+	// A few objects are tested faster one after the other than through a hierarchy, and a world
+	// that already is one hierarchy is taken as it is
+	World.Clear();
+	if (objects.size() <= 4)
+	{
+		for (const Ref<Hittable>& object : objects)
+			World.Add(object);
+	}
+	else
+	{
+		World.Add(CreateRef<BVHNode>(objects, 0, objects.size()));
+	}
+
+	Lights.clear();
+	World.CollectLights(Lights);
+
+	CompileStats.BuildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	SceneMemory memory;
+	World.CollectMemory(memory);
+	CompileStats.MemoryBytes = memory.Bytes;
+}
+
+Scene SceneInfo::Create(uint32_t width, uint32_t height) const
+{
+	Ref<SceneArena> arena = SceneArena::IsEnabled() ? std::make_shared<SceneArena>() : nullptr;
+	SceneArena::Binding binding(arena.get());
+
+	Scene scene = Generate(width, height);
+	scene.Arena = arena;
+	return scene;
+}
 
 SceneList::SceneList()
 	: m_Scenes()
@@ -18,17 +123,53 @@ void SceneList::Add(Scene scene)
 	m_Scenes.emplace_back(scene);
 }
 
+const std::vector<SceneInfo>& SceneList::GetBuiltInScenes()
+{
+	static const std::vector<SceneInfo> scenes = {
+		{ "Random Spheres", GenerateRandomScene },
+		{ "Checkered Spheres", GenerateCheckeredSpheres },
+		{ "Earth", GenerateEarthScene },
+		{ "Perlin Spheres", GeneratePerlinSpheres },
+		{ "Quad Scene", GenerateQuadScene },
+		{ "Simple Light", GenerateSimpleLightScene },
+		{ "Cornell Box", GenerateCornellBoxScene },
+		{ "Cornell Smoke", GenerateCornellSmokeScene },
+		{ "Final Scene", GenerateFinalScene },
+		{ "Triangle Mesh", GenerateTriangleMeshScene },
+		{ "Instanced Knots", GenerateInstancedKnotsScene }
+	};
+	return scenes;
+}
+
+int SceneList::FindBuiltInScene(const std::string& nameOrIndex)
+{
+	const std::vector<SceneInfo>& scenes = GetBuiltInScenes();
+
+	if (!nameOrIndex.empty() && nameOrIndex.size() < 10 && std::all_of(nameOrIndex.begin(), nameOrIndex.end(), ::isdigit))
+	{
+		int index = std::stoi(nameOrIndex);
+		return index < (int)scenes.size() ? index : -1;
+	}
+
+	auto toLower = [](std::string text)
+		{
+			std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+			return text;
+		};
+
+	std::string name = toLower(nameOrIndex);
+	for (size_t i = 0; i < scenes.size(); i++)
+	{
+		if (toLower(scenes[i].Name) == name)
+			return (int)i;
+	}
+	return -1;
+}
+
 void SceneList::Setup(uint32_t width, uint32_t height)
 {
-	Add(GenerateRandomScene(width, height));
-	Add(GenerateCheckeredSpheres(width, height));
-	Add(GenerateEarthScene(width, height));
-	Add(GeneratePerlinSpheres(width, height));
-	Add(GenerateQuadScene(width, height));
-	Add(GenerateSimpleLightScene(width, height));
-	Add(GenerateCornellBoxScene(width, height));
-	Add(GenerateCornellSmokeScene(width, height));
-	Add(GenerateFinalScene(width, height));
+	for (const SceneInfo& scene : GetBuiltInScenes())
+		Add(scene.Create(width, height));
 }
 
 Scene* SceneList::Get(int index)
@@ -55,28 +196,32 @@ Scene GenerateRandomScene(uint32_t width, uint32_t height)
 		world.Add<Sphere>(glm::vec3(0.0f, -1000.0f, 0.0f), 1000.0f, CreateRef<Material::Lambertian>(checker));
 
 		// Small Spheres
+		RandomStream random(0);
 		for (int a = -11; a < 11; a++)
 		{
 			for (int b = -11; b < 11; b++)
 			{
-				float chosenMaterial = Walnut::Random::Float(0.0f, 1.0f);
-				glm::vec3 center(a + 0.9f * Walnut::Random::Float(-1.0f, 1.0f), 0.2f, b + 0.9f * Walnut::Random::Float(-1.0f, 1.0f));
+				float chosenMaterial = random.Float();
+				float offsetX = random.Float(-1.0f, 1.0f);
+				float offsetZ = random.Float(-1.0f, 1.0f);
+				glm::vec3 center(a + 0.9f * offsetX, 0.2f, b + 0.9f * offsetZ);
 
 				if (glm::length(center - glm::vec3(4.0f, 0.2f, 0.0f)) > 0.9f)
 				{
 					if (chosenMaterial < 0.8f)
 					{
 						// diffuse
-						glm::vec3 albedo = Walnut::Random::Vec3() * Walnut::Random::Vec3();
+						glm::vec3 albedo = random.Vec3();
+						albedo *= random.Vec3();
 						Ref<Material::Lambertian> sphereMaterial = CreateRef<Material::Lambertian>(albedo);
-						glm::vec3 center2 = center + glm::vec3(0.0f, Walnut::Random::Float(0.0f, 0.5f), 0.0f);
+						glm::vec3 center2 = center + glm::vec3(0.0f, random.Float(0.0f, 0.5f), 0.0f);
 						world.Add<Sphere>(center, center2, 0.2f, sphereMaterial);
 					}
 					else if (chosenMaterial < 0.95f)
 					{
 						// metal
-						glm::vec3 albedo = Walnut::Random::Vec3(0.5f, 1.0f);
-						float fuzz = Walnut::Random::Float(0.0f, 0.5f);
+						glm::vec3 albedo = random.Vec3(0.5f, 1.0f);
+						float fuzz = random.Float(0.0f, 0.5f);
 						Ref<Material::Metal> sphereMaterial = CreateRef<Material::Metal>(albedo, fuzz);
 						world.Add<Sphere>(center, 0.2f, sphereMaterial);
 					}
@@ -300,6 +445,7 @@ Scene GenerateFinalScene(uint32_t width, uint32_t height)
 		HittableList boxes1;
 		Ref<Material::Lambertian> ground = CreateRef<Material::Lambertian>(glm::vec3(0.48f, 0.83f, 0.53f));
 
+		RandomStream random(0);
 		int boxesPerSide = 20;
 		for (int i = 0; i < boxesPerSide; i++)
 		{
@@ -310,10 +456,13 @@ Scene GenerateFinalScene(uint32_t width, uint32_t height)
 				float z0 = -1000.0f + j * w;
 				float y0 = 0.0f;
 				float x1 = x0 + w;
-				float y1 = Walnut::Random::Float(1.0f, 101.0f);
+				float y1 = random.Float(1.0f, 101.0f);
 				float z1 = z0 + w;
 
-				boxes1.Add(Box(glm::vec3(x0, y0, z0), glm::vec3(x1, y1, z1), ground));
+				// The sides go into the hierarchy one by one, so its leaves can batch them as quads
+				Ref<HittableList> box = Box(glm::vec3(x0, y0, z0), glm::vec3(x1, y1, z1), ground);
+				for (const Ref<Hittable>& side : box->Objects())
+					boxes1.Add(side);
 			}
 		}
 
@@ -346,14 +495,164 @@ Scene GenerateFinalScene(uint32_t width, uint32_t height)
 		Ref<Material::Lambertian> white = CreateRef<Material::Lambertian>(glm::vec3(0.73f));
 		int ns = 1000;
 		for (int j = 0; j < ns; j++)
-			boxes2.Add<Sphere>(Walnut::Random::Vec3(0.0f, 165.0f), 10.0f, white);
+			boxes2.Add<Sphere>(random.Vec3(0.0f, 165.0f), 10.0f, white);
 
 
-		world.Add<Translate>(CreateRef<RotateY>(CreateRef<BVHNode>(boxes2), 15.0f), glm::vec3(-100.0f, 270.0f, 395.0f));
+		AffineTransform placement = AffineTransform::FromTranslation(glm::vec3(-100.0f, 270.0f, 395.0f)) * AffineTransform::FromRotationY(15.0f);
+		world.Add<Instance>(CreateRef<BVHNode>(boxes2), placement);
 	}
 
 	// Camera
 	Camera camera(glm::vec3(478.0f, 278.0f, -600.0f), glm::vec3(278.0f, 278.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), width, height, 40.0f, 0.0f, 10.0f);
 
 	return { world, camera, std::string("Final Scene"), glm::vec3(0.0f) };
-}
\ No newline at end of file
+}
+// (2, 3) torus knot swept by a circle, with vertex normals and UVs
+static Ref<MeshData> GenerateTorusKnot(uint32_t segments, uint32_t sides, float tubeRadius)
+{
+	auto curve = [](float phi)
+		{
+			float r = 2.0f + std::cos(3.0f * phi);
+			return glm::vec3(r * std::cos(2.0f * phi), r * std::sin(2.0f * phi), -std::sin(3.0f * phi));
+		};
+
+	Ref<MeshData> mesh = CreateRef<MeshData>();
+	mesh->Positions.reserve((size_t)segments * sides);
+	mesh->Normals.reserve((size_t)segments * sides);
+	mesh->UVs.reserve((size_t)segments * sides);
+
+	const float step = 2.0f * PI / (float)segments;
+	for (uint32_t i = 0; i < segments; i++)
+	{
+		float phi = (float)i * step;
+		glm::vec3 center = curve(phi);
+		glm::vec3 tangent = glm::normalize(curve(phi + step) - curve(phi - step));
+		glm::vec3 bend = curve(phi + step) + curve(phi - step) - 2.0f * center;
+		glm::vec3 normal = glm::normalize(bend - glm::dot(bend, tangent) * tangent);
+		glm::vec3 binormal = glm::cross(tangent, normal);
+
+		for (uint32_t j = 0; j < sides; j++)
+		{
+			float theta = 2.0f * PI * (float)j / (float)sides;
+			glm::vec3 direction = std::cos(theta) * normal + std::sin(theta) * binormal;
+			mesh->Positions.push_back(center + tubeRadius * direction);
+			mesh->Normals.push_back(direction);
+			mesh->UVs.emplace_back((float)i / (float)segments, (float)j / (float)sides);
+		}
+	}
+
+	mesh->Indices.reserve((size_t)segments * sides * 6);
+	for (uint32_t i = 0; i < segments; i++)
+	{
+		for (uint32_t j = 0; j < sides; j++)
+		{
+			uint32_t a = i * sides + j;
+			uint32_t b = ((i + 1) % segments) * sides + j;
+			uint32_t c = ((i + 1) % segments) * sides + (j + 1) % sides;
+			uint32_t d = i * sides + (j + 1) % sides;
+			mesh->Indices.insert(mesh->Indices.end(), { a, b, c, a, c, d });
+		}
+	}
+	return mesh;
+}
+
+Scene GenerateTriangleMeshScene(uint32_t width, uint32_t height)
+{
+	// World
+	HittableList world;
+	{
+		// Materials
+		Ref<Texture> checker = CreateRef<CheckerTexture>(0.5f, glm::vec3(0.2f, 0.3f, 0.1f), glm::vec3(0.9f));
+		Ref<Material::Lambertian> ground = CreateRef<Material::Lambertian>(checker);
+		Ref<Material::Metal> gold = CreateRef<Material::Metal>(glm::vec3(0.8f, 0.6f, 0.2f), 0.15f);
+		Ref<Material::DiffuseLight> light = CreateRef<Material::DiffuseLight>(glm::vec3(6.0f));
+
+		// 1024 x 32 quads, 65536 triangles
+		world.Add<TriangleMesh>(GenerateTorusKnot(1024, 32, 0.45f), gold);
+
+		world.Add<Quad>(glm::vec3(-20.0f, -3.5f, -20.0f), glm::vec3(40.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 40.0f), ground);
+		world.Add<Quad>(glm::vec3(-3.0f, 8.0f, 0.0f), glm::vec3(6.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 6.0f), light);
+	}
+
+	// Camera
+	Camera camera(glm::vec3(2.0f, 3.0f, 14.0f), glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), width, height, 35.0f, 0.0f, 10.0f);
+
+	return { world, camera, std::string("Triangle Mesh"), glm::vec3(0.3f, 0.35f, 0.45f) };
+}
+
+Scene GenerateInstancedKnotsScene(uint32_t width, uint32_t height)
+{
+	// World
+	HittableList world;
+	{
+		// Materials
+		Ref<Texture> checker = CreateRef<CheckerTexture>(2.0f, glm::vec3(0.2f, 0.3f, 0.1f), glm::vec3(0.9f));
+		Ref<Material::Lambertian> ground = CreateRef<Material::Lambertian>(checker);
+		Ref<Material::Lambertian> clay = CreateRef<Material::Lambertian>(glm::vec3(0.8f, 0.45f, 0.3f));
+
+		// One mesh and hierarchy, placed 100 x 100 times under a hierarchy of instances
+		Ref<TriangleMesh> knot = CreateRef<TriangleMesh>(GenerateTorusKnot(1024, 32, 0.45f), clay);
+
+		HittableList instances;
+		RandomStream random(0);
+		const int knotsPerSide = 100;
+		for (int i = 0; i < knotsPerSide; i++)
+		{
+			for (int j = 0; j < knotsPerSide; j++)
+			{
+				float scale = random.Float(0.08f, 0.14f);
+				glm::vec3 position((float)(i - knotsPerSide / 2) * 1.2f, 3.5f * scale, (float)(j - knotsPerSide / 2) * 1.2f);
+				AffineTransform placement = AffineTransform::FromTranslation(position)
+					* AffineTransform::FromRotation(random.Float(0.0f, 360.0f), random.Vec3(-1.0f, 1.0f))
+					* AffineTransform::FromScale(glm::vec3(scale));
+				instances.Add<Instance>(knot, placement);
+			}
+		}
+		world.Add<BVHNode>(instances);
+
+		world.Add<Quad>(glm::vec3(-200.0f, 0.0f, -200.0f), glm::vec3(400.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 400.0f), ground);
+	}
+
+	// Camera
+	Camera camera(glm::vec3(3.0f, 2.5f, 12.0f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), width, height, 40.0f, 0.0f, 10.0f);
+
+	return { world, camera, std::string("Instanced Knots"), glm::vec3(0.7f, 0.8f, 1.0f) };
+}
+
+bool GenerateMeshScene(const std::string& filename, uint32_t width, uint32_t height, Scene& scene)
+{
+	Ref<SceneArena> arena = SceneArena::IsEnabled() ? std::make_shared<SceneArena>() : nullptr;
+	SceneArena::Binding binding(arena.get());
+
+	Ref<MeshData> data = MeshLoader::Load(filename);
+	if (!data)
+		return false;
+
+	// World
+	HittableList world;
+	Ref<TriangleMesh> mesh = CreateRef<TriangleMesh>(data, CreateRef<Material::Lambertian>(glm::vec3(0.73f)));
+	glm::vec3 low = mesh->BoundingBox().min();
+	glm::vec3 high = mesh->BoundingBox().max();
+	glm::vec3 center = mesh->BoundingBox().Centroid();
+	float radius = glm::max(0.5f * glm::length(high - low), 0.0001f);
+	{
+		world.Add(mesh);
+
+		// A ground under the model and a light above it, both scaled to its size
+		Ref<Texture> checker = CreateRef<CheckerTexture>(0.1f * radius, glm::vec3(0.2f, 0.3f, 0.1f), glm::vec3(0.9f));
+		world.Add<Quad>(glm::vec3(center.x - 10.0f * radius, low.y, center.z - 10.0f * radius),
+			glm::vec3(20.0f * radius, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 20.0f * radius), CreateRef<Material::Lambertian>(checker));
+		world.Add<Quad>(glm::vec3(center.x - radius, high.y + 2.0f * radius, center.z - radius),
+			glm::vec3(2.0f * radius, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 2.0f * radius), CreateRef<Material::DiffuseLight>(glm::vec3(4.0f)));
+	}
+
+	// Camera, far enough back that the bounding sphere fits a 30 degree field of view
+	float distance = radius / std::sin(MathUtil::DegreeToRadians(15.0f));
+	glm::vec3 lookfrom = center + distance * glm::normalize(glm::vec3(0.4f, 0.3f, 1.0f));
+	Camera camera(lookfrom, center, glm::vec3(0.0f, 1.0f, 0.0f), width, height, 30.0f, 0.0f, distance);
+
+	std::string name = filename.substr(filename.find_last_of("/\\") + 1);
+	scene = Scene(world, camera, name, glm::vec3(0.3f, 0.35f, 0.45f));
+	scene.Arena = arena;
+	return true;
+}
@@ -3,15 +3,60 @@
 #include <string>
 #include <vector>
 
+#include "Core/SceneArena.h"
 #include "Objects/HittableList.h"
 #include "Rendering/Camera.h"
 
+// What compiling a scene's world did
+struct SceneCompileStats
+{
+	size_t InputObjects = 0;     // Top level objects of the world as it was built
+	size_t FlattenedLists = 0;   // Nested lists merged into their parent or turned into a hierarchy
+	size_t TopLevelObjects = 0;  // Objects under the world's top level hierarchy
+	size_t MemoryBytes = 0;      // Geometry and hierarchies, shared objects counted once
+	float BuildTime = 0.0f;      // Milliseconds
+};
+
 struct Scene
 {
+	// Memory of the scene's objects, materials and textures, null if it was built without one.
+	// Declared first, so it is destroyed after everything that lives in it.
+	Ref<SceneArena> Arena;
+
+	Scene() = default;
+	// Compiles the world and collects the emissive spheres and quads into Lights.
+	Scene(const HittableList& world, const ::Camera& camera, const std::string& name, const glm::vec3& background = glm::vec3(0.0f));
+
+	Scene(const Scene&) = default;
+	Scene(Scene&&) = default;
+	// Swaps, so the replaced scene's objects are released before its arena
+	Scene& operator=(Scene other);
+
+	// Flattens the nested lists of world in one pass and builds a single hierarchy over what is
+	// left, which becomes the only object of World unless there are just a few objects. The
+	// world is only read, its objects are shared rather than copied.
+	void Compile(const HittableList& world);
+
 	HittableList World;
-	Camera Camera;
+	::Camera Camera;
 	std::string Name;
-	glm::vec3 Background;
+	glm::vec3 Background = glm::vec3(0.0f);
+
+	// Sampled directly by the integrator at every diffuse bounce
+	std::vector<Ref<Hittable>> Lights;
+
+	SceneCompileStats CompileStats;
+};
+
+using SceneGenerator = Scene(*)(uint32_t width, uint32_t height);
+
+struct SceneInfo
+{
+	const char* Name;
+	SceneGenerator Generate;
+
+	// Runs the generator with a new arena bound, which the scene then owns
+	Scene Create(uint32_t width, uint32_t height) const;
 };
 
 class SceneList
@@ -19,6 +64,11 @@ class SceneList
 public:
 	SceneList();
 
+	// Every built-in scene in the order Setup adds them, so single scenes can be generated without building all of them.
+	static const std::vector<SceneInfo>& GetBuiltInScenes();
+	// Looks a built-in scene up by its index or its case insensitive name, returns -1 if there is none.
+	static int FindBuiltInScene(const std::string& nameOrIndex);
+
 	void Add(Scene scene);
 
 	void Setup(uint32_t width, uint32_t height);
@@ -41,4 +91,9 @@ Scene GenerateQuadScene(uint32_t width, uint32_t height);
 Scene GenerateSimpleLightScene(uint32_t width, uint32_t height);
 Scene GenerateCornellBoxScene(uint32_t width, uint32_t height);
 Scene GenerateCornellSmokeScene(uint32_t width, uint32_t height);
-Scene GenerateFinalScene(uint32_t width, uint32_t height);
\ No newline at end of file
+Scene GenerateFinalScene(uint32_t width, uint32_t height);
+Scene GenerateTriangleMeshScene(uint32_t width, uint32_t height);
+Scene GenerateInstancedKnotsScene(uint32_t width, uint32_t height);
+
+// Places a mesh file on a ground under an area light, with the camera framing it. Returns false if the file cannot be loaded.
+bool GenerateMeshScene(const std::string& filename, uint32_t width, uint32_t height, Scene& scene);
@@ -3,7 +3,23 @@
 
 #include "Math/Interval.h"
 
-glm::vec3 CheckerTexture::Value(float u, float v, const glm::vec3& point) const
+glm::vec3 Texture::Lookup(float u, float v, const glm::vec3& point, float footprint) const
+{
+    if (!s_StaticDispatch)
+        return Value(u, v, point, footprint);
+
+    // The classes are final, so each call below binds statically
+    switch (m_Type)
+    {
+    case Type::SolidColor: return static_cast<const SolidColor*>(this)->Value(u, v, point, footprint);
+    case Type::Checker:    return static_cast<const CheckerTexture*>(this)->Value(u, v, point, footprint);
+    case Type::Image:      return static_cast<const ImageTexture*>(this)->Value(u, v, point, footprint);
+    case Type::Noise:      return static_cast<const NoiseTexture*>(this)->Value(u, v, point, footprint);
+    }
+    return Value(u, v, point, footprint);
+}
+
+glm::vec3 CheckerTexture::Value(float u, float v, const glm::vec3& point, float footprint) const
 {
     int xInteger = int(std::floor(m_InverseScale * point.x));
     int yInteger = int(std::floor(m_InverseScale * point.y));
@@ -11,27 +27,23 @@ glm::vec3 CheckerTexture::Value(float u, float v, const glm::vec3& point) const
 
     bool isEven = (xInteger + yInteger + zInteger) % 2 == 0;
 
-    return isEven ? m_EvenTexture->Value(u, v, point) : m_OddTexture->Value(u, v, point);
+    return isEven ? m_EvenTexture->Lookup(u, v, point, footprint) : m_OddTexture->Lookup(u, v, point, footprint);
 }
 
-glm::vec3 ImageTexture::Value(float u, float v, const glm::vec3& point) const
+glm::vec3 ImageTexture::Value(float u, float v, const glm::vec3& point, float footprint) const
 {
     // If we have no texture data, then return solid cyan as a debugging aid.
-    if (m_Image.GetHeight() <= 0) return glm::vec3(0.0f, 1.0f, 1.0f);
+    const TextureCache::Pyramid& pyramid = m_Image->GetPyramid();
+    if (pyramid.empty()) return glm::vec3(0.0f, 1.0f, 1.0f);
 
     // Clamp input texture coordinates to [0,1] x [1,0]
     u = Interval(0.0f, 1.0f).Clamp(u);
     v = 1.0f - Interval(0.0f, 1.0f).Clamp(v);  // Flip V to image coordinates
 
-    int i = int(u * m_Image.GetWidth());
-    int j = int(v * m_Image.GetHeight());
-    const unsigned char* pixel = m_Image.Pixel(i, j);
-
-    float colorScale = 1.0f / 255.0f;
-    return glm::vec3(colorScale * pixel[0], colorScale * pixel[1], colorScale * pixel[2]);
+    return TextureCache::Get().Sample(pyramid, u, v, footprint);
 }
 
-glm::vec3 NoiseTexture::Value(float u, float v, const glm::vec3& point) const
+glm::vec3 NoiseTexture::Value(float u, float v, const glm::vec3& point, float footprint) const
 {
     return glm::vec3(0.5f) * (1.0f + std::sin(m_Scale * point.z + 10.0f * m_Noise.Turbulence(point, 7)));
 }
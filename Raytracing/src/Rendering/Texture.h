@@ -3,74 +3,108 @@
 #include <memory>
 #include <glm/glm.hpp>
 
-#include "Rendering/Image.h"
+#include "Rendering/TextureLoader.h"
 
 #include "Math/Perlin.h"
 
 class Texture 
 {
 public:
+	// Concrete class of a texture, the closed set Lookup switches over
+	enum class Type : uint8_t
+	{
+		SolidColor,
+		Checker,
+		Image,
+		Noise
+	};
+
 	virtual ~Texture() = default;
 	
-	virtual glm::vec3 Value(float u, float v, const glm::vec3& point) const = 0;
+	// Footprint is the width of the area seen around (u, v) in UV units, 0 for a point sample
+	virtual glm::vec3 Value(float u, float v, const glm::vec3& point, float footprint) const = 0;
+
+	// Value, dispatched with a switch on the type instead of the vtable when static dispatch is
+	// on, so the compiler sees which Value it calls and can inline it
+	glm::vec3 Lookup(float u, float v, const glm::vec3& point, float footprint) const;
+
+	Type GetType() const { return m_Type; }
+
+	// Off makes Lookup a plain virtual call, to compare the two
+	static void SetStaticDispatch(bool enabled) { s_StaticDispatch = enabled; }
+
+protected:
+	Texture(Type type)
+		: m_Type(type)
+	{}
+
+private:
+	Type m_Type;
+
+	static inline bool s_StaticDispatch = true;
 };
 
-class SolidColor : public Texture 
+class SolidColor final : public Texture 
 {
 public:
 	SolidColor(const glm::vec3& albedo) 
-		: m_Albedo(albedo) 
+		: Texture(Type::SolidColor), m_Albedo(albedo) 
 	{}
 
 	SolidColor(float red, float green, float blue) 
 		: SolidColor(glm::vec3(red, green, blue)) 
 	{}
 
-	glm::vec3 Value(float u, float v, const glm::vec3& point) const override { return m_Albedo; }
+	glm::vec3 Value(float u, float v, const glm::vec3& point, float footprint) const override { return m_Albedo; }
 
 private:
 	glm::vec3 m_Albedo;
 };
 
-class CheckerTexture : public Texture 
+class CheckerTexture final : public Texture 
 {
 public:
 	CheckerTexture(float scale, std::shared_ptr<Texture> even, std::shared_ptr<Texture> odd)
-		: m_InverseScale(1.0f / scale), m_EvenTexture(even), m_OddTexture(odd) 
+		: Texture(Type::Checker), m_InverseScale(1.0f / scale), m_EvenTexture(even), m_OddTexture(odd) 
 	{}
 
 	CheckerTexture(float scale, const glm::vec3& color1, const glm::vec3& color2)
-		: m_InverseScale(1.0f / scale), m_EvenTexture(std::make_shared<SolidColor>(color1)), m_OddTexture(std::make_shared<SolidColor>(color2))
+		: Texture(Type::Checker), m_InverseScale(1.0f / scale), m_EvenTexture(CreateRef<SolidColor>(color1)), m_OddTexture(CreateRef<SolidColor>(color2))
 	{}
 
-	glm::vec3 Value(float u, float v, const glm::vec3& point) const override;
+	glm::vec3 Value(float u, float v, const glm::vec3& point, float footprint) const override;
 private:
 	float m_InverseScale;
 	std::shared_ptr<Texture> m_EvenTexture, m_OddTexture;
 };
 
-class ImageTexture : public Texture 
+// Texels are filtered trilinearly over the mip level matching the footprint, from the TextureCache.
+// The image is loaded in the background, textures of the same file share it.
+class ImageTexture final : public Texture 
 {
 public:
-	ImageTexture(std::string& path) 
-		: m_Image(path) 
+	ImageTexture(const std::string& path)
+		: Texture(Type::Image), m_Image(TextureLoader::Load(path))
 	{}
 
-	glm::vec3 Value(float u, float v, const glm::vec3& point) const override;
+	glm::vec3 Value(float u, float v, const glm::vec3& point, float footprint) const override;
 
 private:
-	RTImage m_Image;
+	Ref<TextureImage> m_Image;
 };
 
-class NoiseTexture : public Texture 
+class NoiseTexture final : public Texture 
 {
 public:
-	NoiseTexture() = default;
+	NoiseTexture()
+		: Texture(Type::Noise)
+	{}
+
 	NoiseTexture(float scale) 
-		: m_Scale(scale) 
+		: Texture(Type::Noise), m_Scale(scale) 
 	{}
 
-	glm::vec3 Value(float u, float v, const glm::vec3& point) const override;
+	glm::vec3 Value(float u, float v, const glm::vec3& point, float footprint) const override;
 	
 private:
 	Perlin m_Noise;
@@ -0,0 +1,427 @@
+#include "rtpch.h"
+#include "Rendering/TextureCache.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "Math/MathUtil.h"
+
+#ifdef _MSC_VER
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+namespace {
+
+	// Positional reads and writes leave the file position alone, so any number of threads use the
+	// file at once without a lock. Offsets are 64 bit, the file grows past 2 GB with enough textures.
+	bool ReadAt(FILE* file, void* data, size_t size, uint64_t offset)
+	{
+#ifdef _MSC_VER
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD transferred = 0;
+		return ReadFile((HANDLE)_get_osfhandle(_fileno(file)), data, (DWORD)size, &transferred, &overlapped) && transferred == size;
+#else
+		return pread(fileno(file), data, size, (off_t)offset) == (ssize_t)size;
+#endif
+	}
+
+	bool WriteAt(FILE* file, const void* data, size_t size, uint64_t offset)
+	{
+#ifdef _MSC_VER
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD transferred = 0;
+		return WriteFile((HANDLE)_get_osfhandle(_fileno(file)), data, (DWORD)size, &transferred, &overlapped) && transferred == size;
+#else
+		return pwrite(fileno(file), data, size, (off_t)offset) == (ssize_t)size;
+#endif
+	}
+
+	uint8_t FloatToByte(float value)
+	{
+		if (value <= 0.0f) return 0;
+		if (1.0f <= value) return 255;
+		return static_cast<uint8_t>(256.0f * value);
+	}
+
+	uint32_t PackTexel(const glm::vec3& color)
+	{
+		return (uint32_t)FloatToByte(color.r) | ((uint32_t)FloatToByte(color.g) << 8) | ((uint32_t)FloatToByte(color.b) << 16) | 0xFF000000u;
+	}
+
+	glm::vec3 UnpackTexel(uint32_t texel)
+	{
+		float colorScale = 1.0f / 255.0f;
+		return glm::vec3(colorScale * (texel & 0xFF), colorScale * ((texel >> 8) & 0xFF), colorScale * ((texel >> 16) & 0xFF));
+	}
+
+	// Spreads the low 16 bits of x over the even bits
+	uint32_t SpreadBits(uint32_t x)
+	{
+		x &= 0x0000FFFF;
+		x = (x | (x << 8)) & 0x00FF00FF;
+		x = (x | (x << 4)) & 0x0F0F0F0F;
+		x = (x | (x << 2)) & 0x33333333;
+		x = (x | (x << 1)) & 0x55555555;
+		return x;
+	}
+
+}
+
+TextureCache& TextureCache::Get()
+{
+	// Never destroyed, textures may still be released during static destruction
+	static TextureCache* cache = new TextureCache();
+	return *cache;
+}
+
+uint32_t TextureCache::MortonOffset(uint32_t x, uint32_t y)
+{
+	return SpreadBits(x) | (SpreadBits(y) << 1);
+}
+
+TextureCache::Pyramid TextureCache::Add(const float* pixels, int width, int height)
+{
+	Pyramid pyramid;
+	uint64_t tileCount = 0;
+	for (uint32_t w = (uint32_t)width, h = (uint32_t)height; ; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+	{
+		Level level;
+		level.Width = w;
+		level.Height = h;
+		level.TilesX = (w + TileSize - 1) / TileSize;
+		level.TilesY = (h + TileSize - 1) / TileSize;
+		level.FirstTile = tileCount;
+		pyramid.push_back(level);
+		tileCount += (uint64_t)level.TilesX * level.TilesY;
+
+		if (w == 1 && h == 1)
+			break;
+	}
+
+	// Reserves the image's range of tiles in the store
+	uint64_t firstTile;
+	{
+		std::lock_guard<std::mutex> lock(m_StoreMutex);
+		if (!m_File && !m_InMemory)
+		{
+			m_File = std::tmpfile();
+			if (!m_File)
+			{
+				std::cerr << "ERROR: Could not create the texture cache's backing file, textures are kept in memory.\n";
+				m_InMemory = true;
+			}
+		}
+
+		firstTile = m_TileCount;
+		m_TileCount += tileCount;
+		m_LiveTiles += tileCount;
+		m_LiveImages++;
+		if (m_InMemory)
+			m_MemoryStore.resize(m_TileCount * TileTexels);
+	}
+	for (Level& level : pyramid)
+		level.FirstTile += firstTile;
+
+	// Each level is box filtered from the one above, in floating point, and only then quantized.
+	// The full size level is read straight from the image, only the smaller ones are copies.
+	static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Pixels are read as vec3");
+	const glm::vec3* current = reinterpret_cast<const glm::vec3*>(pixels);
+	std::vector<glm::vec3> levelPixels, next;
+
+	Tile tile;
+	for (size_t index = 0; index < pyramid.size(); index++)
+	{
+		const Level& level = pyramid[index];
+		for (uint32_t tileY = 0; tileY < level.TilesY; tileY++)
+		{
+			for (uint32_t tileX = 0; tileX < level.TilesX; tileX++)
+			{
+				// Tiles past the edge of the image repeat its last row and column
+				for (uint32_t y = 0; y < TileSize; y++)
+				{
+					uint32_t sourceY = std::min(tileY * TileSize + y, level.Height - 1);
+					for (uint32_t x = 0; x < TileSize; x++)
+					{
+						uint32_t sourceX = std::min(tileX * TileSize + x, level.Width - 1);
+						tile[MortonOffset(x, y)] = PackTexel(current[(size_t)sourceY * level.Width + sourceX]);
+					}
+				}
+				WriteTile(level.FirstTile + (uint64_t)tileY * level.TilesX + tileX, tile);
+			}
+		}
+
+		if (index + 1 == pyramid.size())
+			break;
+
+		const Level& smaller = pyramid[index + 1];
+		next.resize((size_t)smaller.Width * smaller.Height);
+		for (uint32_t y = 0; y < smaller.Height; y++)
+		{
+			uint32_t y0 = std::min(2 * y, level.Height - 1), y1 = std::min(2 * y + 1, level.Height - 1);
+			for (uint32_t x = 0; x < smaller.Width; x++)
+			{
+				uint32_t x0 = std::min(2 * x, level.Width - 1), x1 = std::min(2 * x + 1, level.Width - 1);
+				next[(size_t)y * smaller.Width + x] = 0.25f * (current[(size_t)y0 * level.Width + x0] + current[(size_t)y0 * level.Width + x1]
+					+ current[(size_t)y1 * level.Width + x0] + current[(size_t)y1 * level.Width + x1]);
+			}
+		}
+		std::swap(levelPixels, next);
+		current = levelPixels.data();
+	}
+
+	return pyramid;
+}
+
+void TextureCache::Remove(const Pyramid& pyramid)
+{
+	if (pyramid.empty())
+		return;
+
+	const Level& last = pyramid.back();
+	uint64_t first = pyramid.front().FirstTile;
+	uint64_t end = last.FirstTile + (uint64_t)last.TilesX * last.TilesY;
+
+	for (Shard& shard : m_Shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.Mutex);
+		for (auto it = shard.Tiles.begin(); it != shard.Tiles.end();)
+		{
+			if (it->first >= first && it->first < end)
+			{
+				shard.Index.erase(it->first);
+				it = shard.Tiles.erase(it);
+			}
+			else
+				it++;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_StoreMutex);
+	m_LiveTiles -= end - first;
+	if (--m_LiveImages > 0)
+		return;
+
+	// Nothing refers to the store any more, it starts over with the next image
+	if (m_File)
+		std::fclose(m_File);
+	m_File = nullptr;
+	m_InMemory = false;
+	m_MemoryStore = std::vector<uint32_t>();
+	m_TileCount = 0;
+	m_Generation.fetch_add(1, std::memory_order_release);
+}
+
+glm::vec3 TextureCache::Sample(const Pyramid& pyramid, float u, float v, float width)
+{
+	const Level& top = pyramid.front();
+	// The level whose texels are as wide as the footprint
+	float lod = width > 0.0f ? std::log2(width * (float)std::max(top.Width, top.Height)) : 0.0f;
+	if (!(lod > 0.0f))
+		return Bilinear(top, u, v);
+
+	size_t coarsest = pyramid.size() - 1;
+	if (lod >= (float)coarsest)
+		return Bilinear(pyramid[coarsest], u, v);
+
+	size_t index = (size_t)lod;
+	float t = lod - (float)index;
+	glm::vec3 fine = Bilinear(pyramid[index], u, v);
+	glm::vec3 coarse = Bilinear(pyramid[index + 1], u, v);
+	return fine + t * (coarse - fine);
+}
+
+glm::vec3 TextureCache::Bilinear(const Level& level, float u, float v)
+{
+	float x = u * (float)level.Width - 0.5f;
+	float y = v * (float)level.Height - 0.5f;
+	float floorX = std::floor(x), floorY = std::floor(y);
+	float tx = x - floorX, ty = y - floorY;
+
+	// Clamp's upper bound is exclusive
+	int width = (int)level.Width, height = (int)level.Height;
+	uint32_t xs[2] = { (uint32_t)MathUtil::Clamp((int)floorX, 0, width), (uint32_t)MathUtil::Clamp((int)floorX + 1, 0, width) };
+	uint32_t ys[2] = { (uint32_t)MathUtil::Clamp((int)floorY, 0, height), (uint32_t)MathUtil::Clamp((int)floorY + 1, 0, height) };
+
+	uint64_t tiles[4];
+	uint32_t offsets[4];
+	for (uint32_t corner = 0; corner < 4; corner++)
+	{
+		uint32_t cx = xs[corner & 1], cy = ys[corner >> 1];
+		tiles[corner] = level.FirstTile + (uint64_t)(cy / TileSize) * level.TilesX + cx / TileSize;
+		offsets[corner] = MortonOffset(cx % TileSize, cy % TileSize);
+	}
+
+	// The corners in the same tile are read together, most often all four are
+	uint32_t texels[4];
+	bool read[4] = {};
+	for (uint32_t corner = 0; corner < 4; corner++)
+	{
+		if (read[corner])
+			continue;
+
+		uint32_t group[4], groupOffsets[4], groupTexels[4];
+		uint32_t count = 0;
+		for (uint32_t other = corner; other < 4; other++)
+		{
+			if (read[other] || tiles[other] != tiles[corner])
+				continue;
+			read[other] = true;
+			group[count] = other;
+			groupOffsets[count++] = offsets[other];
+		}
+
+		ReadTexels(tiles[corner], groupOffsets, count, groupTexels);
+		for (uint32_t i = 0; i < count; i++)
+			texels[group[i]] = groupTexels[i];
+	}
+
+	glm::vec3 top = UnpackTexel(texels[0]) + tx * (UnpackTexel(texels[1]) - UnpackTexel(texels[0]));
+	glm::vec3 bottom = UnpackTexel(texels[2]) + tx * (UnpackTexel(texels[3]) - UnpackTexel(texels[2]));
+	return top + ty * (bottom - top);
+}
+
+void TextureCache::ReadTexels(uint64_t tile, const uint32_t* offsets, uint32_t count, uint32_t* texels)
+{
+	thread_local std::array<HotTile, s_HotTileCount> hotTiles;
+	thread_local uint32_t hotHits = 0;
+
+	// Coherent lookups mostly land on a tile the thread read just before
+	HotTile& hot = hotTiles[tile % s_HotTileCount];
+	uint64_t generation = m_Generation.load(std::memory_order_acquire);
+	if (hot.Index == tile && hot.Generation == generation)
+	{
+		if (++hotHits == s_HotHitBatch)
+		{
+			m_HotHits.fetch_add(hotHits, std::memory_order_relaxed);
+			hotHits = 0;
+		}
+	}
+	else
+	{
+		hot.Texels = FindTile(tile);
+		hot.Index = tile;
+		hot.Generation = generation;
+	}
+
+	const Tile& resident = *hot.Texels;
+	for (uint32_t i = 0; i < count; i++)
+		texels[i] = resident[offsets[i]];
+}
+
+TextureCache::TileRef TextureCache::FindTile(uint64_t tile)
+{
+	// Neighboring tiles go to different shards, so threads reading one region rarely wait on each other
+	Shard& shard = m_Shards[tile % s_ShardCount];
+	{
+		std::lock_guard<std::mutex> lock(shard.Mutex);
+		auto found = shard.Index.find(tile);
+		if (found != shard.Index.end())
+		{
+			shard.Hits++;
+			shard.Tiles.splice(shard.Tiles.begin(), shard.Tiles, found->second);
+			return found->second->second;
+		}
+		shard.Misses++;
+	}
+
+	// Read without holding the shard. Threads missing the same tile at once each read it, the
+	// first one to finish puts its copy in the cache.
+	uint64_t generation = m_Generation.load(std::memory_order_acquire);
+	std::shared_ptr<Tile> loaded = std::make_shared<Tile>();
+	LoadTile(tile, *loaded);
+
+	std::lock_guard<std::mutex> lock(shard.Mutex);
+	auto found = shard.Index.find(tile);
+	if (found != shard.Index.end())
+		return found->second->second;
+	// The store started over during the read, the tile's number may belong to another image by now
+	if (m_Generation.load(std::memory_order_acquire) != generation)
+		return loaded;
+
+	// Over budget the least recently used tiles make room
+	size_t capacity = std::max(m_Budget.load(std::memory_order_relaxed) / s_ShardCount / TileBytes, (size_t)1);
+	while (shard.Tiles.size() >= capacity)
+	{
+		shard.Index.erase(shard.Tiles.back().first);
+		shard.Tiles.pop_back();
+	}
+
+	shard.Tiles.emplace_front(tile, std::move(loaded));
+	shard.Index[tile] = shard.Tiles.begin();
+	return shard.Tiles.front().second;
+}
+
+void TextureCache::WriteTile(uint64_t tile, const Tile& texels)
+{
+	// The image's range of tiles was reserved before, the store cannot start over while it is written
+	if (m_InMemory)
+	{
+		std::lock_guard<std::mutex> lock(m_StoreMutex);
+		std::memcpy(&m_MemoryStore[tile * TileTexels], texels.data(), TileBytes);
+		return;
+	}
+
+	if (!WriteAt(m_File, texels.data(), TileBytes, tile * TileBytes))
+		std::cerr << "ERROR: Could not write tile " << tile << " of the texture cache.\n";
+}
+
+void TextureCache::LoadTile(uint64_t tile, Tile& texels)
+{
+	// Tiles are only read from images that still exist, whose store cannot start over
+	if (m_InMemory)
+	{
+		// Adding an image may move the memory store
+		std::lock_guard<std::mutex> lock(m_StoreMutex);
+		std::memcpy(texels.data(), &m_MemoryStore[tile * TileTexels], TileBytes);
+		return;
+	}
+
+	if (!ReadAt(m_File, texels.data(), TileBytes, tile * TileBytes))
+	{
+		// Magenta, like a missing image
+		texels.fill(0xFFFF00FFu);
+		std::cerr << "ERROR: Could not read tile " << tile << " of the texture cache.\n";
+	}
+}
+
+void TextureCache::SetBudget(size_t bytes)
+{
+	m_Budget = bytes;
+}
+
+TextureCache::Statistics TextureCache::GetStatistics()
+{
+	Statistics statistics;
+	for (Shard& shard : m_Shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.Mutex);
+		statistics.Hits += shard.Hits;
+		statistics.Misses += shard.Misses;
+		statistics.ResidentBytes += shard.Tiles.size() * TileBytes;
+	}
+	statistics.Hits += m_HotHits.load(std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(m_StoreMutex);
+	statistics.StoredBytes = m_LiveTiles * TileBytes;
+	statistics.Budget = m_Budget;
+	return statistics;
+}
+
+void TextureCache::ResetStatistics()
+{
+	m_HotHits = 0;
+	for (Shard& shard : m_Shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.Mutex);
+		shard.Hits = 0;
+		shard.Misses = 0;
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// Texels of all image textures, shared by every scene. An image is stored once as a mip pyramid
+// of 8 bit RGBA tiles in a backing file, and tiles are paged into memory on demand. Resident
+// tiles are kept in least recently used order and evicted once they exceed the budget, so
+// textures of any total size render within a fixed amount of memory.
+//
+// A tile is 32x32 texels, 4 KB. Its texels are in Morton order, so the 2x2 block a bilinear
+// lookup reads is almost always within one or two cache lines.
+//
+// Every thread keeps a few of the tiles it read last, which it reads again without taking any
+// lock. Tiles missing from memory are read from the store by the thread that needs them, with
+// positional reads outside of any lock, so a miss stalls neither the other threads nor the
+// lookups of its shard.
+class TextureCache
+{
+public:
+	static constexpr uint32_t TileSize = 32;
+	static constexpr uint32_t TileTexels = TileSize * TileSize;
+	static constexpr size_t TileBytes = TileTexels * sizeof(uint32_t);
+
+	struct Level
+	{
+		uint32_t Width, Height;
+		uint32_t TilesX, TilesY;
+		uint64_t FirstTile;   // Tiles are numbered row by row, from the level's first one
+	};
+
+	// Where the tiles of one image are stored, from the full size level down to 1x1
+	using Pyramid = std::vector<Level>;
+
+	struct Statistics
+	{
+		uint64_t Hits = 0, Misses = 0;
+		size_t ResidentBytes = 0;
+		size_t StoredBytes = 0;   // Tiles written to the backing store, of textures that still exist
+		size_t Budget = 0;
+	};
+
+public:
+	static TextureCache& Get();
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// Builds the pyramid of an image of linear RGB floats and stores its tiles. Thread safe.
+	Pyramid Add(const float* pixels, int width, int height);
+	// Drops the resident tiles of an image, its tiles are never read again
+	void Remove(const Pyramid& pyramid);
+
+	// Trilinearly filtered color at (u, v) in [0, 1], v running down the image, for a footprint
+	// of the given width in UV units. Width 0 filters bilinearly between the full size texels.
+	glm::vec3 Sample(const Pyramid& pyramid, float u, float v, float width);
+
+	void SetBudget(size_t bytes);
+	Statistics GetStatistics();
+	void ResetStatistics();
+
+private:
+	TextureCache() = default;
+
+	using Tile = std::array<uint32_t, TileTexels>;
+	// Shared, a tile evicted while threads still read it stays alive until they let go of it
+	using TileRef = std::shared_ptr<const Tile>;
+
+	struct Shard
+	{
+		std::mutex Mutex;
+		// Most recently used at the front
+		std::list<std::pair<uint64_t, TileRef>> Tiles;
+		std::unordered_map<uint64_t, std::list<std::pair<uint64_t, TileRef>>::iterator> Index;
+		uint64_t Hits = 0, Misses = 0;
+	};
+
+	// One of the tiles a thread read last
+	struct HotTile
+	{
+		uint64_t Index = UINT64_MAX;
+		uint64_t Generation = 0;
+		TileRef Texels;
+	};
+
+	glm::vec3 Bilinear(const Level& level, float u, float v);
+	// Reads count texels of one tile, at the given offsets within it
+	void ReadTexels(uint64_t tile, const uint32_t* offsets, uint32_t count, uint32_t* texels);
+	// The resident tile, loaded from the store first if it is not
+	TileRef FindTile(uint64_t tile);
+
+	void WriteTile(uint64_t tile, const Tile& texels);
+	void LoadTile(uint64_t tile, Tile& texels);
+
+	static uint32_t MortonOffset(uint32_t x, uint32_t y);
+
+private:
+	static constexpr uint32_t s_ShardCount = 16;
+	// Per thread, enough for the corners of a trilinear lookup to rarely evict each other
+	static constexpr uint32_t s_HotTileCount = 16;
+	// Hits on a thread's hot tiles are added to the statistics in batches of this many
+	static constexpr uint32_t s_HotHitBatch = 1024;
+
+	std::array<Shard, s_ShardCount> m_Shards;
+	std::atomic<size_t> m_Budget = 256ull * 1024 * 1024;
+	std::atomic<uint64_t> m_HotHits = 0;
+	// Counts the restarts of the store, after which tile numbers are handed out again and hot tiles are stale
+	std::atomic<uint64_t> m_Generation = 0;
+
+	// Backing store of every tile. Tiles of removed images are not reclaimed until no image is left.
+	// The mutex guards the store's bookkeeping and the in memory fallback, the file is read and
+	// written at fixed offsets without it.
+	std::mutex m_StoreMutex;
+	FILE* m_File = nullptr;
+	bool m_InMemory = false;
+	std::vector<uint32_t> m_MemoryStore;   // Used instead if no temporary file can be created
+	uint64_t m_TileCount = 0;
+	uint64_t m_LiveTiles = 0;
+	uint32_t m_LiveImages = 0;
+};
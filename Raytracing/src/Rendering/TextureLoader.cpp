@@ -0,0 +1,100 @@
+#include "rtpch.h"
+#include "Rendering/TextureLoader.h"
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+
+#include "Core/ThreadPool.h"
+#include "Rendering/Image.h"
+
+namespace {
+
+	struct LoaderState
+	{
+		std::mutex Mutex;
+		// Weak, an image is released with its last texture and decoded again when needed again
+		std::unordered_map<std::string, std::weak_ptr<TextureImage>> Images;
+		TextureLoader::Statistics Statistics;
+
+		// The group outlives the pool, whose workers finish the queued loads when it shuts down
+		ThreadPool::TaskGroup Pending;
+		ThreadPool Pool = ThreadPool(std::max(ThreadPool::HardwareThreads() - 1, 1u));
+	};
+
+	LoaderState& State()
+	{
+		static LoaderState state;
+		return state;
+	}
+
+	// The same file reached through different relative paths is loaded once
+	std::string FileKey(const std::string& path)
+	{
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+		return error ? path : canonical.string();
+	}
+
+}
+
+TextureImage::~TextureImage()
+{
+	TextureCache::Get().Remove(m_Pyramid);
+}
+
+Ref<TextureImage> TextureLoader::Load(const std::string& filename)
+{
+	LoaderState& state = State();
+	std::string key = FileKey("res/" + filename);
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	if (Ref<TextureImage> existing = state.Images[key].lock())
+	{
+		state.Statistics.Shared++;
+		return existing;
+	}
+
+	// Forget the files whose images are gone, so the map only holds the ones still in use
+	for (auto it = state.Images.begin(); it != state.Images.end();)
+		it = it->second.expired() ? state.Images.erase(it) : std::next(it);
+
+	// Shared between scenes, so never allocated from the arena of the scene that asked first
+	Ref<TextureImage> image = std::make_shared<TextureImage>();
+	state.Images[key] = image;
+	state.Statistics.Decoded++;
+
+	// The task keeps the image alive, in case every texture of it is gone before it ran
+	state.Pool.Run(state.Pending, [image, filename]()
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			{
+				RTImage decoded(filename);
+				if (decoded.GetHeight() > 0)
+					image->m_Pyramid = TextureCache::Get().Add(decoded.GetData(), decoded.GetWidth(), decoded.GetHeight());
+			}
+			image->m_Ready.store(true, std::memory_order_release);
+			image->m_Promise.set_value();
+
+			std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			LoaderState& state = State();
+			std::lock_guard<std::mutex> lock(state.Mutex);
+			state.Statistics.DecodeTime += elapsed.count();
+		});
+
+	return image;
+}
+
+void TextureLoader::WaitAll()
+{
+	LoaderState& state = State();
+	state.Pool.Wait(state.Pending);
+}
+
+TextureLoader::Statistics TextureLoader::GetStatistics()
+{
+	LoaderState& state = State();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	return state.Statistics;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <string>
+
+#include "Rendering/TextureCache.h"
+
+// One image file, decoded and stored in the TextureCache on the TextureLoader's threads. Every
+// ImageTexture of the file shares it, its tiles are released along with the last of them.
+class TextureImage
+{
+public:
+	~TextureImage();
+
+	// Blocks until the image is stored. Empty if the file could not be loaded.
+	const TextureCache::Pyramid& GetPyramid() const
+	{
+		if (!m_Ready.load(std::memory_order_acquire))
+			m_Loaded.wait();
+		return m_Pyramid;
+	}
+
+private:
+	TextureCache::Pyramid m_Pyramid;
+	std::atomic<bool> m_Ready = false;
+	std::promise<void> m_Promise;
+	std::shared_future<void> m_Loaded = m_Promise.get_future().share();
+
+	friend class TextureLoader;
+};
+
+// Decodes image files on a pool of background threads, so building scenes does not wait for
+// their textures. The render waits for whatever is still loading before its first pixel.
+class TextureLoader
+{
+public:
+	struct Statistics
+	{
+		uint32_t Decoded = 0;
+		uint32_t Shared = 0;      // Loads that found the file loaded or loading already
+		float DecodeTime = 0.0f;  // Milliseconds spent decoding and tiling, summed over the threads
+	};
+
+public:
+	// Image of a file in res/, decoded once for as long as anything refers to it. Returns at
+	// once, the decoding happens in the background. Thread safe.
+	static Ref<TextureImage> Load(const std::string& filename);
+
+	// Blocks until every load started so far has finished. The calling thread decodes as well.
+	static void WaitAll();
+
+	static Statistics GetStatistics();
+};
@@ -0,0 +1,56 @@
+#include "rtpch.h"
+#include "Rendering/TileScheduler.h"
+
+TileScheduler::TileScheduler(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t workerCount)
+{
+	tileSize = std::max(1u, tileSize);
+	workerCount = std::max(1u, workerCount);
+
+	std::vector<Tile> tiles;
+	for (uint32_t y = 0; y < height; y += tileSize)
+	{
+		for (uint32_t x = 0; x < width; x += tileSize)
+			tiles.push_back({ x, y, std::min(tileSize, width - x), std::min(tileSize, height - y) });
+	}
+	m_TileCount = tiles.size();
+
+	// Hand every worker a contiguous run of tiles, neighbouring tiles tend to cost about the same
+	// and touch the same parts of the scene.
+	m_Queues.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		Scope<WorkerQueue> queue = CreateScope<WorkerQueue>();
+		size_t begin = tiles.size() * i / workerCount;
+		size_t end = tiles.size() * (i + 1) / workerCount;
+		queue->Tiles.assign(tiles.begin() + begin, tiles.begin() + end);
+		m_Queues.push_back(std::move(queue));
+	}
+}
+
+bool TileScheduler::Next(uint32_t workerIndex, Tile& tile)
+{
+	WorkerQueue& own = *m_Queues[workerIndex % m_Queues.size()];
+	{
+		std::lock_guard<std::mutex> lock(own.Mutex);
+		if (!own.Tiles.empty())
+		{
+			tile = own.Tiles.front();
+			own.Tiles.pop_front();
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i < m_Queues.size(); i++)
+	{
+		WorkerQueue& victim = *m_Queues[(workerIndex + i) % m_Queues.size()];
+		std::lock_guard<std::mutex> lock(victim.Mutex);
+		if (!victim.Tiles.empty())
+		{
+			tile = victim.Tiles.back();
+			victim.Tiles.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
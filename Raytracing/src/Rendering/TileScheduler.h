@@ -0,0 +1,34 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct Tile
+{
+	uint32_t X, Y;
+	uint32_t Width, Height;
+};
+
+class TileScheduler
+{
+public:
+	TileScheduler(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t workerCount);
+
+	// Pops the next tile from the worker's own queue. Once that runs dry, the worker steals
+	// from the back of the other queues, so idle cores pick up what the busy ones left behind.
+	bool Next(uint32_t workerIndex, Tile& tile);
+
+	size_t TileCount() const { return m_TileCount; }
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex Mutex;
+		std::deque<Tile> Tiles;
+	};
+
+	std::vector<Scope<WorkerQueue>> m_Queues;
+	size_t m_TileCount = 0;
+};
@@ -12,6 +12,8 @@
 #include "Rendering/Renderer.h"
 #include "Rendering/Scene.h"
 
+#include "Math/BVH.h"
+
 class ExampleLayer : public Walnut::Layer
 {
 public:
@@ -20,8 +22,30 @@ public:
 		ImGui::SetNextWindowSize({ 200, 720 }, ImGuiCond_FirstUseEver);
 		ImGui::Begin("Settings");
 		ImGui::Text("Last render: %s", m_Renderer.GetRenderTime().c_str());
-		if (ImGui::Button("Render"))
-			m_Renderer.StartRender(m_ViewportWidth, m_ViewportHeight, m_Samples, m_MaxDepth, m_Scenes->Get(m_SelectedScene));
+		ImGui::Text("Samples: %u", m_Renderer.GetAccumulatedSamples());
+		// A running render keeps its buffers, so the image must not be resized underneath it.
+		if (ImGui::Button("Render") && m_Renderer.GetState() != Renderer::RenderState::Running)
+		{
+			RenderSettings settings;
+			settings.Width = m_ViewportWidth;
+			settings.Height = m_ViewportHeight;
+			settings.Samples = m_Samples;
+			settings.MaxDepth = m_MaxDepth;
+			settings.RouletteDepth = m_RouletteDepth;
+			settings.LightSampling = m_LightSampling;
+			settings.ThreadCount = (uint32_t)std::max(0, m_ThreadCount);
+			settings.Progressive = m_Progressive;
+			settings.TimeBudget = m_TimeBudget;
+			settings.Sampling = (SamplerType)m_Sampler;
+
+			if (!m_FinalImage)
+				m_FinalImage = std::make_shared<Walnut::Image>(settings.Width, settings.Height, Walnut::ImageFormat::RGBA);
+			else if (m_FinalImage->GetWidth() != settings.Width || m_FinalImage->GetHeight() != settings.Height)
+				m_FinalImage->Resize(settings.Width, settings.Height);
+
+			m_Renderer.StartRender(settings, m_Scenes->Get(m_SelectedScene));
+			m_UploadPending = true;
+		}
 		
 		if (ImGui::Button("Abort"))
 			m_Renderer.StopRender();
@@ -34,10 +58,48 @@ public:
 		ImGui::Text("Max Depth");
 		m_MaxDepth, depthChange = ImGui::InputInt("  ", &m_MaxDepth, 1, 2, 0);
 
+		ImGui::Text("Russian Roulette Depth");
+		ImGui::InputInt("     ", &m_RouletteDepth, 1, 2, 0);
+
+		ImGui::Text("Threads (0 = all cores)");
+		ImGui::InputInt("   ", &m_ThreadCount, 1, 2, 0);
+
+		ImGui::Checkbox("Light Sampling", &m_LightSampling);
+		ImGui::Checkbox("Progressive", &m_Progressive);
+		if (m_Progressive)
+		{
+			ImGui::Text("Time Budget (s, 0 = none)");
+			ImGui::InputFloat("    ", &m_TimeBudget, 1.0f, 10.0f, "%.1f");
+		}
+
+		const char* samplers[] = { Sampler::TypeName(SamplerType::Independent), Sampler::TypeName(SamplerType::Stratified),
+			Sampler::TypeName(SamplerType::Sobol), Sampler::TypeName(SamplerType::BlueNoise) };
+		ImGui::Combo("Sampler", &m_Sampler, samplers, IM_ARRAYSIZE(samplers));
+
 		if (m_Scenes) {
 			std::vector<const char*> sceneNames = m_Scenes->GetSceneNames();
 			ImGui::Combo("Scene", &m_SelectedScene, sceneNames.data(), (int)sceneNames.size());
 		}
+
+		// Switching the builder regenerates every scene, the build statistics are printed to stdout.
+		const char* buildMethods[] = { BVHNode::BuildMethodName(BVHBuildMethod::Median), BVHNode::BuildMethodName(BVHBuildMethod::SAH) };
+		int buildMethod = (int)BVHNode::GetDefaultBuildMethod();
+		if (ImGui::Combo("BVH", &buildMethod, buildMethods, IM_ARRAYSIZE(buildMethods)))
+		{
+			m_Renderer.StopRender();
+			BVHNode::SetDefaultBuildMethod((BVHBuildMethod)buildMethod);
+			m_Scenes.reset();
+		}
+
+		const char* layouts[] = { BVHNode::LayoutName(BVHLayout::Auto), BVHNode::LayoutName(BVHLayout::Binary),
+			BVHNode::LayoutName(BVHLayout::Wide4), BVHNode::LayoutName(BVHLayout::Wide8) };
+		int layout = (int)BVHNode::GetDefaultLayout();
+		if (ImGui::Combo("BVH Layout", &layout, layouts, IM_ARRAYSIZE(layouts)))
+		{
+			m_Renderer.StopRender();
+			BVHNode::SetDefaultLayout((BVHLayout)layout);
+			m_Scenes.reset();
+		}
 		ImGui::End();
 
 		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.0f, 0.0f));
@@ -55,19 +117,33 @@ public:
 
 		m_Renderer.Update();
 
-		std::shared_ptr<Walnut::Image> image = m_Renderer.GetFinalImage();
-		if (image)
-			ImGui::Image(image->GetDescriptorSet(),{ (float)image->GetWidth(), (float)image->GetHeight() });
+		// Keep uploading while the render runs, plus once more after it ended to pick up the last pixels.
+		if (m_FinalImage && m_UploadPending)
+		{
+			m_FinalImage->SetData(m_Renderer.GetImageData());
+			m_UploadPending = m_Renderer.GetState() == Renderer::RenderState::Running;
+		}
+
+		if (m_FinalImage)
+			ImGui::Image(m_FinalImage->GetDescriptorSet(),{ (float)m_FinalImage->GetWidth(), (float)m_FinalImage->GetHeight() });
 
 		ImGui::End();
 		ImGui::PopStyleVar();
 	}
 private:
 	Renderer m_Renderer;
+	std::shared_ptr<Walnut::Image> m_FinalImage;
+	bool m_UploadPending = false;
 	uint32_t m_ViewportWidth = 0, m_ViewportHeight = 0;
 
 	int m_Samples = 20;
 	int m_MaxDepth = 20;
+	int m_RouletteDepth = 3;
+	bool m_LightSampling = true;
+	int m_ThreadCount = 0;
+	bool m_Progressive = false;
+	float m_TimeBudget = 0.0f;
+	int m_Sampler = (int)SamplerType::Sobol;
 
 	int m_SelectedScene;
 	std::unique_ptr<SceneList> m_Scenes;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdlib>
 #include <limits>
 #include <iostream>
 #include <memory>
@@ -14,8 +15,20 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "Core/SceneArena.h"
+
 #define INFINITY std::numeric_limits<float>::infinity()
 
+// Marks the end of a switch that has a case for every enumerator. Debug builds abort if it is
+// reached anyway, the others let the compiler drop the fall through.
+#if defined(WL_DEBUG)
+	#define RT_UNREACHABLE() std::abort()
+#elif defined(_MSC_VER)
+	#define RT_UNREACHABLE() __assume(false)
+#else
+	#define RT_UNREACHABLE() __builtin_unreachable()
+#endif
+
 template<typename T>
 using Scope = std::unique_ptr<T>;
 
@@ -28,8 +41,11 @@ constexpr Scope<T> CreateScope(Args&& ... args)
 template<typename T>
 using Ref = std::shared_ptr<T>;
 
+// Objects created while a SceneArena is bound to the thread live in that arena
 template<typename T, typename ... Args>
 constexpr Ref<T> CreateRef(Args&& ... args) 
 {
+	if (SceneArena* arena = SceneArena::Current())
+		return std::allocate_shared<T>(SceneArena::Allocator<T>(arena), std::forward<Args>(args)...);
 	return std::make_shared<T>(std::forward<Args>(args)...);
 }
\ No newline at end of file
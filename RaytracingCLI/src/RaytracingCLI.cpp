@@ -0,0 +1,217 @@
+#include "rtpch.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "Math/BVH.h"
+#include "Objects/MeshLoader.h"
+#include "Rendering/ImageWriter.h"
+#include "Rendering/Renderer.h"
+#include "Rendering/Scene.h"
+#include "Rendering/TextureCache.h"
+#include "Rendering/TextureLoader.h"
+
+namespace {
+
+	struct CommandLineOptions
+	{
+		std::string Scene = "0";
+		std::string Mesh;
+		std::string Output = "render.png";
+		RenderSettings Settings;
+		bool ListScenes = false;
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: RaytracingCLI [options]\n"
+			<< "  --scene <name|index>   built-in scene to render (default 0)\n"
+			<< "  --list                 print the built-in scenes and exit\n"
+			<< "  --mesh <file>          render an .obj or .ply mesh instead of a built-in scene\n"
+			<< "  --width <n>            image width (default 1280)\n"
+			<< "  --height <n>           image height (default 720)\n"
+			<< "  --samples <n>          samples per pixel (default 20)\n"
+			<< "  --depth <n>            maximum bounces per path (default 20)\n"
+			<< "  --roulette-depth <n>   bounces before Russian roulette may end a path (default 3)\n"
+			<< "  --light-sampling <0|1> sample the lights directly at diffuse bounces (default 1)\n"
+			<< "  --packets <0|1>        trace camera rays in 8x8 packets (default 0)\n"
+			<< "  --wavefront <0|1>      render bounce by bounce over waves of paths, sorted by material (default 0)\n"
+			<< "  --static-dispatch <0|1> call materials and textures by type tag, 0 uses virtual calls (default 1)\n"
+			<< "  --threads <n>          render threads, 0 uses every hardware thread (default 0)\n"
+			<< "  --seed <n>             seed of the per pixel random streams (default 0)\n"
+			<< "  --sampler <type>       independent, stratified, sobol or bluenoise (default sobol)\n"
+			<< "  --scene-arena <0|1>    build the scene's objects into one arena (default 1)\n"
+			<< "  --texture-cache-mb <n> memory for resident texture tiles (default 256)\n"
+			<< "  --output <file>        .png, .ppm or .exr (default render.png)\n";
+	}
+
+	bool ParseArguments(int argc, char** argv, CommandLineOptions& options)
+	{
+		options.Settings.Width = 1280;
+		options.Settings.Height = 720;
+
+		for (int i = 1; i < argc; i++)
+		{
+			const char* argument = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+			if (std::strcmp(argument, "--list") == 0)
+			{
+				options.ListScenes = true;
+				continue;
+			}
+
+			if (value == nullptr)
+				return false;
+			i++;
+
+			try
+			{
+				if (std::strcmp(argument, "--scene") == 0)         options.Scene = value;
+				else if (std::strcmp(argument, "--mesh") == 0)     options.Mesh = value;
+				else if (std::strcmp(argument, "--output") == 0)   options.Output = value;
+				else if (std::strcmp(argument, "--width") == 0)    options.Settings.Width = (uint32_t)std::stoul(value);
+				else if (std::strcmp(argument, "--height") == 0)   options.Settings.Height = (uint32_t)std::stoul(value);
+				else if (std::strcmp(argument, "--samples") == 0)  options.Settings.Samples = std::stoi(value);
+				else if (std::strcmp(argument, "--depth") == 0)    options.Settings.MaxDepth = std::stoi(value);
+				else if (std::strcmp(argument, "--roulette-depth") == 0) options.Settings.RouletteDepth = std::stoi(value);
+				else if (std::strcmp(argument, "--light-sampling") == 0) options.Settings.LightSampling = std::stoi(value) != 0;
+				else if (std::strcmp(argument, "--packets") == 0)  options.Settings.PacketTracing = std::stoi(value) != 0;
+				else if (std::strcmp(argument, "--wavefront") == 0) options.Settings.Wavefront = std::stoi(value) != 0;
+				else if (std::strcmp(argument, "--static-dispatch") == 0) options.Settings.StaticDispatch = std::stoi(value) != 0;
+				else if (std::strcmp(argument, "--threads") == 0)  options.Settings.ThreadCount = (uint32_t)std::stoul(value);
+				else if (std::strcmp(argument, "--seed") == 0)     options.Settings.Seed = (uint32_t)std::stoul(value);
+				else if (std::strcmp(argument, "--scene-arena") == 0) SceneArena::SetEnabled(std::stoi(value) != 0);
+				else if (std::strcmp(argument, "--texture-cache-mb") == 0) TextureCache::Get().SetBudget(std::stoull(value) * 1024 * 1024);
+				else if (std::strcmp(argument, "--sampler") == 0)
+				{
+					if (!Sampler::FindType(value, options.Settings.Sampling))
+						throw std::invalid_argument(value);
+				}
+				else return false;
+			}
+			catch (const std::exception&)
+			{
+				std::cerr << "ERROR: Invalid value '" << value << "' for " << argument << ".\n";
+				return false;
+			}
+		}
+
+		return options.Settings.Width > 0 && options.Settings.Height > 0 && options.Settings.Samples > 0;
+	}
+
+	float MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+}
+
+int main(int argc, char** argv)
+{
+	CommandLineOptions options;
+	if (!ParseArguments(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::vector<SceneInfo>& scenes = SceneList::GetBuiltInScenes();
+	if (options.ListScenes)
+	{
+		for (size_t i = 0; i < scenes.size(); i++)
+			std::cout << i << ": " << scenes[i].Name << "\n";
+		return 0;
+	}
+
+	int sceneIndex = SceneList::FindBuiltInScene(options.Scene);
+	if (!options.Mesh.empty())
+	{
+		if (!MeshLoader::IsSupported(options.Mesh))
+		{
+			std::cerr << "ERROR: Unsupported mesh file '" << options.Mesh << "', use .obj or .ply.\n";
+			return 1;
+		}
+	}
+	else if (sceneIndex < 0)
+	{
+		std::cerr << "ERROR: Unknown scene '" << options.Scene << "', use --list to show the built-in scenes.\n";
+		return 1;
+	}
+
+	if (!ImageWriter::IsSupported(options.Output))
+	{
+		std::cerr << "ERROR: Unsupported output file '" << options.Output << "', use .png, .ppm or .exr.\n";
+		return 1;
+	}
+
+	const RenderSettings& settings = options.Settings;
+
+	std::chrono::steady_clock::time_point setupStart = std::chrono::steady_clock::now();
+	Scene scene;
+	if (options.Mesh.empty())
+		scene = scenes[sceneIndex].Create(settings.Width, settings.Height);
+	else if (!GenerateMeshScene(options.Mesh, settings.Width, settings.Height, scene))
+		return 1;
+	float setupTime = MillisecondsSince(setupStart);
+
+	// Textures decode in the background while the scene is built, whatever is left is waited for here
+	std::chrono::steady_clock::time_point textureStart = std::chrono::steady_clock::now();
+	TextureLoader::WaitAll();
+	float textureWait = MillisecondsSince(textureStart);
+
+	Renderer renderer;
+	std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+	renderer.StartRender(settings, &scene);
+	renderer.WaitForRender();
+	float renderTime = MillisecondsSince(renderStart);
+
+	std::chrono::steady_clock::time_point writeStart = std::chrono::steady_clock::now();
+	bool written = ImageWriter::Write(options.Output, settings.Width, settings.Height, renderer.GetImageData(),
+		renderer.GetAccumulationData(), renderer.GetAccumulatedSamples());
+	float writeTime = MillisecondsSince(writeStart);
+
+	double cameraSamples = (double)settings.Width * settings.Height * settings.Samples;
+	std::cout << "Scene:          " << scene.Name << "\n"
+		<< "Resolution:     " << settings.Width << "x" << settings.Height << ", " << settings.Samples << " spp, depth " << settings.MaxDepth << "\n"
+		<< "Sampler:        " << Sampler::TypeName(settings.Sampling) << "\n"
+		<< "Scene setup:    " << setupTime << " ms\n"
+		<< "Scene compile:  " << scene.CompileStats.BuildTime << " ms, " << scene.CompileStats.InputObjects << " objects, "
+		<< scene.CompileStats.FlattenedLists << " nested lists flattened, " << scene.CompileStats.MemoryBytes / (1024.0 * 1024.0) << " MB\n"
+		<< "Render:         " << renderTime << " ms\n"
+		<< "Samples/sec:    " << cameraSamples / (renderTime / 1000.0) << "\n"
+		<< "Image write:    " << writeTime << " ms\n";
+
+	if (scene.Arena)
+		std::cout << "Scene arena:    " << scene.Arena->BytesAllocated() / (1024.0 * 1024.0) << " MB in " << scene.Arena->BlockCount() << " blocks\n";
+
+	TextureLoader::Statistics loads = TextureLoader::GetStatistics();
+	if (loads.Decoded > 0)
+		std::cout << "Texture load:   " << loads.Decoded << " decoded in " << loads.DecodeTime << " ms, " << loads.Shared
+			<< " shared, waited " << textureWait << " ms\n";
+
+	TextureCache::Statistics textures = TextureCache::Get().GetStatistics();
+	if (textures.StoredBytes > 0)
+	{
+		uint64_t lookups = std::max<uint64_t>(textures.Hits + textures.Misses, 1);
+		std::cout << "Texture cache:  " << textures.ResidentBytes / (1024.0 * 1024.0) << " of " << textures.StoredBytes / (1024.0 * 1024.0)
+			<< " MB resident, budget " << textures.Budget / (1024.0 * 1024.0) << " MB, " << 100.0 * textures.Misses / lookups << "% tile misses\n";
+	}
+
+	if (settings.Wavefront)
+	{
+		WavefrontTimings timings = renderer.GetWavefrontTimings();
+		std::cout << "Wavefront:      generate " << timings.Generate * 1000.0 << " ms, extend " << timings.Extend * 1000.0
+			<< " ms, sort " << timings.Sort * 1000.0 << " ms, shade " << timings.Shade * 1000.0 << " ms\n";
+	}
+
+	std::chrono::steady_clock::time_point teardownStart = std::chrono::steady_clock::now();
+	scene = Scene();
+	std::cout << "Scene teardown: " << MillisecondsSince(teardownStart) << " ms\n";
+
+	if (!written)
+		return 1;
+
+	std::cout << "Wrote " << options.Output << std::endl;
+	return 0;
+}
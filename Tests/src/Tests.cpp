@@ -0,0 +1,116 @@
+#include "rtpch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "Math/BVH.h"
+#include "Objects/Material.h"
+#include "Objects/TriangleMesh.h"
+
+#define RT_CHECK(context, condition) \
+	do { if (!(condition)) { (context).Failures++; std::cerr << "ERROR: " << (context).Name << ": " << #condition \
+		<< " failed (" << __FILE__ << ":" << __LINE__ << ")\n"; } } while (false)
+
+// Regression checks for the renderer. Runs every test, or the ones whose name contains the
+// first argument, and exits with 1 if any check failed.
+namespace {
+
+	struct TestContext
+	{
+		const char* Name;
+		uint32_t Failures = 0;
+	};
+
+	// A ray that misses a triangle, or hits it outside the interval, leaves t and the weights alone,
+	// a closer hit found earlier in the same leaf is still held in them.
+	void TestTriangleMissKeepsHit(TestContext& context)
+	{
+		Ray ray(glm::vec3(0.2f, 0.2f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+		WatertightRay sheared(ray);
+
+		float t = 4.0f;
+		glm::vec3 barycentrics(0.25f, 0.25f, 0.5f);
+		glm::vec3 p0(-1.0f, -1.0f, -1.0f), p1(2.0f, -1.0f, -1.0f), p2(-1.0f, 2.0f, -1.0f);
+
+		RT_CHECK(context, !sheared.Intersect(p0, p1, p2, ray, Interval(0.001f, 4.0f), t, barycentrics));
+		RT_CHECK(context, !sheared.Intersect(p0, p0, p0, ray, Interval(0.001f, 4.0f), t, barycentrics));
+		RT_CHECK(context, t == 4.0f);
+		RT_CHECK(context, barycentrics == glm::vec3(0.25f, 0.25f, 0.5f));
+
+		RT_CHECK(context, sheared.Intersect(p0, p1, p2, ray, Interval(0.001f, 10.0f), t, barycentrics));
+		RT_CHECK(context, std::fabs(t - 6.0f) < 1e-5f);
+	}
+
+	// A triangle seen edge-on sends the whole SIMD batch of its leaf down the scalar path, where a
+	// farther triangle after the closest one used to overwrite the closest hit's distance. All three
+	// have the same bounds, so they end up in one leaf.
+	void TestDegenerateTriangleInLeaf(TestContext& context)
+	{
+		Ref<Material::Blank> material = CreateRef<Material::Lambertian>(glm::vec3(0.5f));
+		std::vector<glm::vec3> front = { { -1.0f, -1.0f, 1.0f }, { 2.0f, -1.0f, 1.0f }, { -1.0f, 2.0f, -1.0f } };
+		std::vector<glm::vec3> back = { { -1.0f, -1.0f, -1.0f }, { 2.0f, -1.0f, -1.0f }, { -1.0f, 2.0f, 1.0f } };
+		std::vector<glm::vec3> degenerate = { { 0.2f, 0.2f, 0.0f }, { -1.0f, -1.0f, -1.0f }, { 2.0f, 2.0f, 1.0f } };
+
+		// The hierarchy reorders the triangles, so every input order is tried
+		std::vector<const std::vector<glm::vec3>*> triangles = { &front, &degenerate, &back };
+		std::sort(triangles.begin(), triangles.end());
+		do
+		{
+			MeshData mesh;
+			for (const std::vector<glm::vec3>* triangle : triangles)
+			{
+				for (const glm::vec3& corner : *triangle)
+				{
+					mesh.Indices.push_back((uint32_t)mesh.Positions.size());
+					mesh.Positions.push_back(corner);
+				}
+			}
+
+			BVHNode bvh(mesh, material.get());
+			Ray ray(glm::vec3(0.2f, 0.2f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+			HitRecord record;
+			bool hit = bvh.Hit(ray, Interval(0.001f, std::numeric_limits<float>::infinity()), record);
+
+			RT_CHECK(context, hit);
+			RT_CHECK(context, std::fabs(record.Intersection - 4.8f) < 1e-5f);
+			RT_CHECK(context, std::fabs(record.Point.z - 0.2f) < 1e-5f);
+		} while (std::next_permutation(triangles.begin(), triangles.end()));
+	}
+
+	struct Test
+	{
+		const char* Name;
+		void (*Run)(TestContext& context);
+	};
+
+	const Test s_Tests[] = {
+		{ "TriangleMissKeepsHit", TestTriangleMissKeepsHit },
+		{ "DegenerateTriangleInLeaf", TestDegenerateTriangleInLeaf },
+	};
+
+}
+
+int main(int argc, char** argv)
+{
+	const char* filter = argc >= 2 ? argv[1] : "";
+	BVHNode::SetBuildLogging(false);
+
+	uint32_t failed = 0, run = 0;
+	for (const Test& test : s_Tests)
+	{
+		if (!std::strstr(test.Name, filter))
+			continue;
+
+		TestContext context;
+		context.Name = test.Name;
+		test.Run(context);
+
+		std::cout << (context.Failures == 0 ? "PASS " : "FAIL ") << test.Name << "\n";
+		failed += context.Failures == 0 ? 0 : 1;
+		run++;
+	}
+
+	std::cout << run - failed << "/" << run << " tests passed\n";
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,7 @@
+#!/bin/bash
+# Generates makefiles for the command line tools (RaytracingCLI, Benchmark, Tests), no display or Vulkan SDK needed.
+
+pushd "$(dirname "$0")/.." > /dev/null
+chmod +x vendor/bin/premake/Linux/premake5
+vendor/bin/premake/Linux/premake5 --file=Build-Headless.lua gmake2
+popd > /dev/null